@@ -15,10 +15,41 @@
 static uint8_t  p_us = 0;
 static uint16_t p_ms = 0;
 
+/* SysTick free-runs at HCLK/8 and is never reset, so it doubles as the
+ * system timebase. The interrupt extends it to 64 bits and u64TickBase
+ * holds the time the counter didn't see (standby). The base is kept in
+ * ticks of the 8MHz clock (1us), so reading it costs no divide; only the
+ * count of a boosted stretch (3 or 6 ticks/us) is scaled, with shifts,
+ * since the core has no divider and a 64-bit divide is a ~1000 cycle
+ * library call. */
+#define SYSTICK_STE     (1 << 0)
+#define SYSTICK_STIE    (1 << 1)
+#define SYSTICK_STRE    (1 << 3)
+#define SYSTICK_CNTIF   (1 << 0)
+
+static volatile uint32_t u32TickHigh = 0;
+static uint64_t u64TickBase = 0;
+
+void SysTick_Handler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+/*********************************************************************
+ * @fn      SysTick_Handler
+ *
+ * @brief   Counts SysTick wraps (every 2^32 ticks).
+ *
+ * @return  none
+ */
+void SysTick_Handler(void)
+{
+    SysTick->SR = 0;
+    u32TickHigh++;
+}
+
 /*********************************************************************
  * @fn      Delay_Init
  *
- * @brief   Initializes Delay Funcation.
+ * @brief   Initializes Delay Funcation and starts the free-running
+ *          SysTick timebase.
  *
  * @return  none
  */
@@ -26,6 +57,12 @@ void Delay_Init(void)
 {
     p_us = SystemCoreClock / 8000000;
     p_ms = (uint16_t)p_us * 1000;
+
+    SysTick->SR = 0;
+    SysTick->CMP = 0xFFFFFFFF;
+    SysTick->CNT = 0;
+    SysTick->CTLR = SYSTICK_STE | SYSTICK_STIE | SYSTICK_STRE;
+    NVIC_EnableIRQ(SysTicK_IRQn);
 }
 
 /*********************************************************************
@@ -39,17 +76,10 @@ void Delay_Init(void)
  */
 void Delay_Us(uint32_t n)
 {
-    uint32_t i;
-
-    SysTick->SR &= ~(1 << 0);
-    i = (uint32_t)n * p_us;
+    uint32_t start = SysTick->CNT;
+    uint32_t i = (uint32_t)n * p_us;
 
-    SysTick->CMP = i;
-    SysTick->CNT = 0;
-    SysTick->CTLR |=(1 << 0);
-
-    while((SysTick->SR & (1 << 0)) != (1 << 0));
-    SysTick->CTLR &= ~(1 << 0);
+    while((SysTick->CNT - start) < i);
 }
 
 /*********************************************************************
@@ -63,17 +93,97 @@ void Delay_Us(uint32_t n)
  */
 void Delay_Ms(uint32_t n)
 {
-    uint32_t i;
+    uint32_t start = SysTick->CNT;
+    uint32_t i = (uint32_t)n * p_ms;
 
-    SysTick->SR &= ~(1 << 0);
-    i = (uint32_t)n * p_ms;
+    while((SysTick->CNT - start) < i);
+}
 
-    SysTick->CMP = i;
-    SysTick->CNT = 0;
-    SysTick->CTLR |=(1 << 0);
+/*********************************************************************
+ * @fn      Tick_Scale
+ *
+ * @brief   Ticks at the current clock to microseconds; n / 3 by shifts
+ *          and adds (Hacker's Delight divu3), exact for any n.
+ *
+ * @param   n - SysTick count.
+ *
+ * @return  Microsecond number
+ */
+static uint32_t Tick_Scale(uint32_t n)
+{
+    uint32_t q, r;
 
-    while((SysTick->SR & (1 << 0)) != (1 << 0));
-    SysTick->CTLR &= ~(1 << 0);
+    if(p_us == 1)
+        return n;
+    q = (n >> 2) + (n >> 4);
+    q += (q >> 4);
+    q += (q >> 8);
+    q += (q >> 16);
+    r = n - (q + (q << 1));
+    q += ((r << 3) + (r << 1) + r) >> 5;
+    return (p_us == 6) ? (q >> 1) : q;
+}
+
+/*********************************************************************
+ * @fn      Tick_Micros
+ *
+ * @brief   Microseconds since Delay_Init, including time in standby.
+ *
+ * @return  64-bit microsecond count
+ */
+uint64_t Tick_Micros(void)
+{
+    uint32_t high, cnt;
+    uint64_t ticks;
+
+    do {
+        high = u32TickHigh;
+        cnt = SysTick->CNT;
+    } while(high != u32TickHigh);
+    if((SysTick->SR & SYSTICK_CNTIF) && cnt < 0x80000000) /* wrapped, interrupt not taken yet */
+        high++;
+    if(p_us == 1)
+        return u64TickBase + (((uint64_t)high << 32) | cnt);
+    /* boosted; a wrap takes 12 minutes at 48MHz, far longer than a boost */
+    ticks = u64TickBase + Tick_Scale(cnt);
+    while(high--)
+        ticks += Tick_Scale(0xFFFFFFFF);
+    return ticks;
+}
+
+/*********************************************************************
+ * @fn      Tick_Advance
+ *
+ * @brief   Adds time that passed while SysTick was stopped (standby).
+ *
+ * @param   n - Microsecond number.
+ *
+ * @return  None
+ */
+void Tick_Advance(uint32_t n)
+{
+    u64TickBase += n;
+}
+
+/*********************************************************************
+ * @fn      Delay_Retune
+ *
+ * @brief   Call after SystemCoreClock changes. The time counted so far
+ *          is moved into the base at the old rate and SysTick restarts
+ *          at the new one.
+ *
+ * @return  None
+ */
+void Delay_Retune(void)
+{
+    u64TickBase = Tick_Micros();
+    SysTick->CTLR = 0;
+    SysTick->SR = 0;
+    SysTick->CNT = 0;
+    u32TickHigh = 0;
+    p_us = SystemCoreClock / 8000000;
+    p_ms = (uint16_t)p_us * 1000;
+    SysTick->CTLR = SYSTICK_STE | SYSTICK_STIE | SYSTICK_STRE;
 }
 
 /*********************************************************************
@@ -31,6 +31,9 @@
 void Delay_Init(void);
 void Delay_Us(uint32_t n);
 void Delay_Ms(uint32_t n);
+uint64_t Tick_Micros(void);
+void Tick_Advance(uint32_t n);
+void Delay_Retune(void);
 void USART_Printf_Init(uint32_t baudrate);
 
 #ifdef __cplusplus
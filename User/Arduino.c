@@ -19,42 +19,75 @@
 //
 #include "debug.h"
 #include "Arduino.h"
+#include "power.h"
+#include "profile.h"
+#include "pwm.h"
 
 void delay(int i)
 {
 	Delay_Ms(i);
 }
+//
+// Time since power-up; SysTick free-runs and the time spent in
+// standby is added on wake, so these never go backwards
+//
+uint32_t micros(void)
+{
+	return (uint32_t)Tick_Micros();
+} /* micros() */
+
+//
+// The ms count is carried forward from the last call, so the usual case
+// is a 32-bit divide of the few us since then instead of a 64-bit
+// divide of the whole count (no divider on this core)
+//
+uint32_t millis(void)
+{
+static uint64_t u64Last; // us at the last whole ms
+static uint32_t u32Ms;
+uint64_t u64Now = Tick_Micros();
+uint64_t u64 = u64Now - u64Last;
+uint32_t u32;
+
+	while ((u32 = (uint32_t)(u64 >> 32)) != 0) { // over an hour since the last call
+		// 2^32us is 4294967ms + 296us, so no 64-bit divide is needed
+		u32Ms += u32 * 4294967;
+		u64Last += ((uint64_t)u32 << 32) - u32 * 296;
+		u64 = u64Now - u64Last;
+	}
+	if ((uint32_t)u64 >= 1000) {
+		u32 = (uint32_t)u64 / 1000;
+		u32Ms += u32;
+		u64Last += u32 * 1000;
+	}
+	return u32Ms;
+} /* millis() */
 // Arduino-like API defines and function wrappers for WCH MCUs
 
+// GPIO ports A, (B), C, D
+static GPIO_TypeDef * const pPorts[4] = {GPIOA, NULL, GPIOC, GPIOD};
+// CFGLR nibble for each pin mode (outputs at 50MHz); the output
+// register picks the pull-up or pull-down
+static const uint8_t u8PinCfg[] = {0x3, 0x4, 0x8, 0x8, 0x0};
+
+//
+// The registers are set directly; GPIO_Init() and its struct would
+// cost a few hundred bytes of the FLASH
+//
 void pinMode(uint8_t u8Pin, int iMode)
 {
-    GPIO_InitTypeDef GPIO_InitStructure = {0};
-    if (u8Pin < 0xa0 || u8Pin > 0xdf) return; // invalid pin number
-
-    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0 << (u8Pin & 0xf);
-    if (iMode == OUTPUT)
-    	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
-    else if (iMode == INPUT)
-    	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
-    else if (iMode == INPUT_PULLUP)
-    	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPU;
+int iPort = (u8Pin >> 4) - 0xa;
+int iShift = (u8Pin & 7) * 4;
+GPIO_TypeDef *pGPIO;
+
+    if (u8Pin < 0xa0 || u8Pin > 0xdf || pPorts[iPort] == NULL) return; // invalid pin number
+    pGPIO = pPorts[iPort];
+    RCC->APB2PCENR |= (RCC_APB2Periph_GPIOA << iPort);
+    pGPIO->CFGLR = (pGPIO->CFGLR & ~(0xfUL << iShift)) | ((uint32_t)u8PinCfg[iMode] << iShift);
+    if (iMode == INPUT_PULLUP)
+    	pGPIO->BSHR = 1 << (u8Pin & 7);
     else if (iMode == INPUT_PULLDOWN)
-    	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPD;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    switch (u8Pin & 0xf0) {
-    case 0xa0:
-    	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
-        GPIO_Init(GPIOA, &GPIO_InitStructure);
-    	break;
-    case 0xc0:
-    	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOC, ENABLE);
-        GPIO_Init(GPIOC, &GPIO_InitStructure);
-    	break;
-    case 0xd0:
-    	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOD, ENABLE);
-        GPIO_Init(GPIOD, &GPIO_InitStructure);
-    	break;
-    }
+    	pGPIO->BCR = 1 << (u8Pin & 7);
 } /* pinMode() */
 
 uint8_t digitalRead(uint8_t u8Pin)
@@ -93,36 +126,44 @@ void digitalWrite(uint8_t u8Pin, uint8_t u8Value)
 	}
 } /* digitalWrite() */
 
+static int iI2CSpeed, iSPISpeed, iSPIMode; // to set them again when the clock changes
+
+//
+// What I2C_Init() does for a 7-bit master with a 16/9 fast mode duty
+// cycle; PCLK1 is the core clock
+//
 void I2CSetSpeed(int iSpeed)
 {
-    I2C_InitTypeDef I2C_InitTSturcture={0};
-
-    I2C_InitTSturcture.I2C_ClockSpeed = iSpeed;
-    I2C_InitTSturcture.I2C_Mode = I2C_Mode_I2C;
-    I2C_InitTSturcture.I2C_DutyCycle = I2C_DutyCycle_16_9;
-    I2C_InitTSturcture.I2C_OwnAddress1 = 0x02; //address; sender's unimportant address
-    I2C_InitTSturcture.I2C_Ack = I2C_Ack_Enable;
-    I2C_InitTSturcture.I2C_AcknowledgedAddress = I2C_AcknowledgedAddress_7bit;
-    I2C_Init( I2C1, &I2C_InitTSturcture );
+uint32_t u32Clock = SystemCoreClock;
+uint16_t u16CCR;
+
+    iI2CSpeed = iSpeed;
+    I2C1->CTLR2 = (I2C1->CTLR2 & ~I2C_CTLR2_FREQ) | (uint16_t)(u32Clock / 1000000);
+    I2C1->CTLR1 &= ~I2C_CTLR1_PE;
+    if (iSpeed <= 100000) {
+    	u16CCR = (uint16_t)(u32Clock / (iSpeed << 1));
+    	if (u16CCR < 4) u16CCR = 4;
+    } else {
+    	u16CCR = (uint16_t)(u32Clock / (iSpeed * 25));
+    	if (u16CCR == 0) u16CCR = 1;
+    	u16CCR |= I2C_CKCFGR_FS | I2C_CKCFGR_DUTY;
+    }
+    I2C1->CKCFGR = u16CCR;
+    I2C1->CTLR1 |= I2C_CTLR1_PE;
+    I2C1->CTLR1 = (I2C1->CTLR1 & ~(I2C_CTLR1_SMBUS | I2C_CTLR1_SMBTYPE)) | I2C_CTLR1_ACK;
+    I2C1->OADDR1 = I2C_AcknowledgedAddress_7bit | 0x02; // sender's unimportant address
 } /* I2CSetSpeed() */
 
 void I2CInit(int iSpeed)
 {
-    GPIO_InitTypeDef GPIO_InitStructure={0};
-
     // Fixed to pins C1/C2 for now
     RCC_APB2PeriphClockCmd( RCC_APB2Periph_GPIOC | RCC_APB2Periph_AFIO, ENABLE );
     RCC_APB1PeriphClockCmd( RCC_APB1Periph_I2C1, ENABLE );
 
-    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_2;
-    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_OD;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_Init( GPIOC, &GPIO_InitStructure );
-
-    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_1;
-    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_OD;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_Init( GPIOC, &GPIO_InitStructure );
+    GPIOC->CFGLR |= (0xfUL << 4) | (0xfUL << 8); // alternate function open drain, 50MHz
+    // the OLED and sensor boards have pull-ups, so let them idle high
+    StandbyPinMode(0xc1, INPUT);
+    StandbyPinMode(0xc2, INPUT);
 
     I2CSetSpeed(iSpeed);
 
@@ -134,6 +175,7 @@ void I2CInit(int iSpeed)
 
 void I2CRead(uint8_t u8Addr, uint8_t *pData, int iLen)
 {
+    powerOn(POWER_I2C);
     I2C_GenerateSTART( I2C1, ENABLE );
     while( !I2C_CheckEvent( I2C1, I2C_EVENT_MASTER_MODE_SELECT ) );
 
@@ -152,12 +194,13 @@ void I2CRead(uint8_t u8Addr, uint8_t *pData, int iLen)
     }
 
     I2C_GenerateSTOP( I2C1, ENABLE );
-
+    powerOff(POWER_I2C);
 
 } /* I2CRead() */
 
 void I2CWrite(uint8_t u8Addr, uint8_t *pData, int iLen)
 {
+    powerOn(POWER_I2C);
     I2C_GenerateSTART( I2C1, ENABLE );
     while( !I2C_CheckEvent( I2C1, I2C_EVENT_MASTER_MODE_SELECT ) );
 
@@ -177,6 +220,7 @@ void I2CWrite(uint8_t u8Addr, uint8_t *pData, int iLen)
 
     while( !I2C_CheckEvent( I2C1, I2C_EVENT_MASTER_BYTE_TRANSMITTED ) );
     I2C_GenerateSTOP( I2C1, ENABLE );
+    powerOff(POWER_I2C);
 
 } /* I2CWrite() */
 
@@ -193,80 +237,256 @@ int I2CTest(uint8_t u8Addr)
 
 } /* I2CTest() */
 
-// Put CPU into standby mode for a multiple of 82ms tick increments
-// max ticks value is 63
-void Standby82ms(uint8_t iTicks)
+static volatile uint8_t bWokenEarly;
+//
+// Called from an interrupt which ends standby early (e.g. a button)
+//
+void StandbyWake(void)
 {
-    EXTI_InitTypeDef EXTI_InitStructure = {0};
-    GPIO_InitTypeDef GPIO_InitStructure = {0};
+	bWokenEarly = 1;
+} /* StandbyWake() */
 
-    // init external interrupts
-    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+//
+// Forget earlier wakes; call it before checking whatever the waking
+// interrupts signal, so one which comes after the check still ends
+// the next StandbyFor()
+//
+void StandbyArm(void)
+{
+	bWokenEarly = 0;
+} /* StandbyArm() */
+
+// How each pin is held during standby (a CFGLR nibble per pin);
+// the default is an input with a pull-down
+static uint32_t u32StandbyCfg[4] = {0x88888888, 0, 0x88888888, 0x88888888};
+// Pins which keep their configuration (outputs hold their level)
+static uint32_t u32StandbyKeep[4];
+// State saved before standby and written back on wake
+static uint32_t u32SavedCfg[4];
+static uint16_t u16SavedOut[4];
+static uint16_t u16SavedI2C[4]; // CTLR1, CTLR2, OADDR1, CKCFGR
+
+//
+// Set how a pin is held during standby:
+// OUTPUT keeps it as it is (an output holds its level)
+// INPUT floats (e.g. lines with external pull-ups)
+// INPUT_PULLUP keeps the pull-up, INPUT_PULLDOWN is the default
+// INPUT_ANALOG disconnects the input (e.g. a voltage divider)
+// Inputs with pull-ups (buttons) are always kept, so they can wake us
+//
+#ifndef DEBUG_MODE
+void StandbyPinMode(uint8_t u8Pin, int iMode)
+{
+int iPort = (u8Pin >> 4) - 0xa;
+int iShift = (u8Pin & 7) * 4;
+
+	if (u8Pin < 0xa0 || u8Pin > 0xdf || pPorts[iPort] == NULL) return;
+	u32StandbyKeep[iPort] &= ~(0xfUL << iShift);
+	u32StandbyCfg[iPort] &= ~(0xfUL << iShift);
+	if (iMode == OUTPUT || iMode == INPUT_PULLUP)
+		u32StandbyKeep[iPort] |= (0xfUL << iShift);
+	else if (iMode == INPUT)
+		u32StandbyCfg[iPort] |= (0x4UL << iShift); // CNF=01 floating
+	else if (iMode == INPUT_PULLDOWN)
+		u32StandbyCfg[iPort] |= (0x8UL << iShift); // CNF=10, ODR=0
+	// INPUT_ANALOG is 0
+} /* StandbyPinMode() */
+#endif // DEBUG_MODE
+
+//
+// Save the port and put its pins in their standby states
+//
+static void PortStandby(int iPort)
+{
+GPIO_TypeDef *pGPIO = pPorts[iPort];
+uint32_t u32Cfg = pGPIO->CFGLR, u32Keep = u32StandbyKeep[iPort];
+uint16_t u16Out = (uint16_t)pGPIO->OUTDR, u16Keep = 0;
+int i;
+
+	u32SavedCfg[iPort] = u32Cfg;
+	u16SavedOut[iPort] = u16Out;
+	for (i=0; i<8; i++) {
+		if (((u32Cfg >> (i*4)) & 0xf) == 0x8 && (u16Out & (1 << i))) // CNF=10, MODE=00, ODR=1 (pull-up)
+			u32Keep |= (0xfUL << (i*4));
+		if (u32Keep & (0xfUL << (i*4)))
+			u16Keep |= (1 << i);
+	}
+	pGPIO->OUTDR = u16Out & u16Keep; // the rest pull down (if they're pulled)
+	pGPIO->CFGLR = (u32Cfg & u32Keep) | (u32StandbyCfg[iPort] & ~u32Keep);
+} /* PortStandby() */
+
+static void PortRestore(int iPort)
+{
+	pPorts[iPort]->OUTDR = u16SavedOut[iPort];
+	pPorts[iPort]->CFGLR = u32SavedCfg[iPort];
+} /* PortRestore() */
+
+// AWU prescalers from the finest to the coarsest; the window is 6 bits,
+// so each one covers up to 63 of its ticks (~65ms to ~31s)
+typedef struct tagAWUPrescaler
+{
+	uint16_t u16Div; // LSI clocks per tick
+	uint8_t u8Reg;
+} AWUPRESCALER;
+
+static const AWUPRESCALER awuPrescalers[] = {
+	{128, PWR_AWU_Prescaler_128}, {256, PWR_AWU_Prescaler_256},
+	{512, PWR_AWU_Prescaler_512}, {1024, PWR_AWU_Prescaler_1024},
+	{2048, PWR_AWU_Prescaler_2048}, {4096, PWR_AWU_Prescaler_4096},
+	{10240, PWR_AWU_Prescaler_10240}, {61440, PWR_AWU_Prescaler_61440}};
+#define AWU_PRESCALERS (int)(sizeof(awuPrescalers) / sizeof(AWUPRESCALER))
+#define AWU_10240 6
+#define AWU_MAX_WINDOW 63
+
+static uint32_t u32AWUTickUs = AWU_TICK_US; // one /10240 tick
+
+//
+// Set the measured LSI frequency (see lsi.c)
+//
+void StandbySetLSI(uint32_t u32Hz)
+{
+	u32AWUTickUs = (uint32_t)((10240ULL * 1000000) / u32Hz);
+} /* StandbySetLSI() */
+
+//
+// Length of one tick of a prescaler (us)
+//
+static uint32_t AWUTickUs(int iPrescaler)
+{
+	return (u32AWUTickUs * (awuPrescalers[iPrescaler].u16Div >> 7)) / (10240 >> 7);
+} /* AWUTickUs() */
+
+//
+// Put the CPU into standby for u8Window ticks of a prescaler
+// The GPIO and I2C registers are saved and written back on wake, so
+// the pins and I2C are ready to use again right away
+// Returns the time slept (us)
+//
+static uint32_t StandbyTicks(int iPrescaler, uint8_t u8Window)
+{
+    uint32_t u32Slept;
+    int bI2C;
 
-    EXTI_InitStructure.EXTI_Line = EXTI_Line9;
-    EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Event;
-    EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;
-    EXTI_InitStructure.EXTI_LineCmd = ENABLE;
-    EXTI_Init(&EXTI_InitStructure);
+    // the AWU wakes us with a falling edge event on EXTI line 9
+    // (the registers are set directly, like the PWR ones below, to keep
+    // the peripheral library's versions out of the FLASH)
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+    EXTI->INTENR &= ~EXTI_Line9;
+    EXTI->EVENR |= EXTI_Line9;
+    EXTI->RTENR &= ~EXTI_Line9;
+    EXTI->FTENR |= EXTI_Line9;
 
-    // Init GPIOs
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOC | RCC_APB2Periph_GPIOD, ENABLE);
     RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
-    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_All;
-    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPD;
-
-    GPIO_Init(GPIOA, &GPIO_InitStructure);
-    GPIO_Init(GPIOC, &GPIO_InitStructure);
-    GPIO_Init(GPIOD, &GPIO_InitStructure);
+    bI2C = (RCC->APB1PCENR & RCC_APB1Periph_I2C1) != 0;
+    if (bI2C) {
+        u16SavedI2C[0] = I2C1->CTLR1;
+        u16SavedI2C[1] = I2C1->CTLR2;
+        u16SavedI2C[2] = I2C1->OADDR1;
+        u16SavedI2C[3] = I2C1->CKCFGR;
+    }
+    PortStandby(0);
+    PortStandby(2);
+    PortStandby(3);
 
     // init wake up timer and enter standby mode
     RCC_LSICmd(ENABLE);
     while(RCC_GetFlagStatus(RCC_FLAG_LSIRDY) == RESET);
-    PWR_AWU_SetPrescaler(PWR_AWU_Prescaler_10240);
-    PWR_AWU_SetWindowValue(iTicks);
-    PWR_AutoWakeUpCmd(ENABLE);
-    PWR_EnterSTANDBYMode(PWR_STANDBYEntry_WFE);
-
-    GPIO_DeInit(GPIOA);
-    GPIO_DeInit(GPIOC);
-    GPIO_DeInit(GPIOD);
+    PWR->AWUPSC = awuPrescalers[iPrescaler].u8Reg;
+    PWR->AWUWR = u8Window;
+    PWR->AWUCSR |= (1 << 1); // AWUEN
+    // with the interrupts off, a wake which came after the last check
+    // can't be missed; it's still pending, so standby ends at once
+    __disable_irq();
+    u32Slept = 0;
+    if (!bWokenEarly) {
+        PWR->CTLR |= PWR_CTLR_PDDS;
+        NVIC->SCTLR |= (1 << 2); // SLEEPDEEP
+        __WFE();
+        NVIC->SCTLR &= ~(1 << 2);
+        u32Slept = u8Window * AWUTickUs(iPrescaler);
+    }
+    PROFILE_BEGIN(PROF_WAKE);
+    PortRestore(0);
+    PortRestore(2);
+    PortRestore(3);
+    if (bI2C) { // PE has to be off to change the timing
+        I2C1->CTLR1 = 0;
+        I2C1->CTLR2 = u16SavedI2C[1];
+        I2C1->OADDR1 = u16SavedI2C[2];
+        I2C1->CKCFGR = u16SavedI2C[3];
+        I2C1->CTLR1 = u16SavedI2C[0];
+    }
+    __enable_irq(); // the waking interrupt runs now
+    PROFILE_END(PROF_WAKE);
+    // SysTick was stopped; the AWU has no counter to read, so if an
+    // interrupt woke us early, assume we slept half of the time
+    if (bWokenEarly)
+        u32Slept >>= 1;
+    Tick_Advance(u32Slept);
+    powerAdd(POWER_STANDBY, u32Slept);
+    return u32Slept;
+} /* StandbyTicks() */
 
+// Put CPU into standby mode for a multiple of 82ms tick increments
+// max ticks value is 63
+void Standby82ms(uint8_t iTicks)
+{
+	StandbyArm();
+	StandbyTicks(AWU_10240, iTicks);
 } /* Standby82ms() */
 
 //
-// Ramp an LED brightness with PWM from 0 to 50%
+// Stay in standby for up to u32Ms milliseconds. Each sleep uses the
+// finest prescaler whose window fits what's left; longer times are
+// chained, and the leftover less than ~1ms isn't slept. An interrupt
+// which calls StandbyWake() (e.g. a button) since the last StandbyArm()
+// ends it early, or keeps it from starting.
+// Returns the time actually slept (ms)
+//
+uint32_t StandbyFor(uint32_t u32Ms)
+{
+uint32_t u32SleptMs = 0, u32RemUs = 0, u32LeftUs, u32Ticks;
+int i;
+
+	while (!bWokenEarly && u32SleptMs < u32Ms) {
+		i = AWU_PRESCALERS-1;
+		u32Ticks = AWU_MAX_WINDOW;
+		if (u32Ms - u32SleptMs < (AWU_MAX_WINDOW * AWUTickUs(i)) / 1000) {
+			u32LeftUs = (u32Ms - u32SleptMs) * 1000;
+			for (i=0; i<AWU_PRESCALERS-1; i++) {
+				if (u32LeftUs / AWUTickUs(i) <= AWU_MAX_WINDOW)
+					break;
+			}
+			u32Ticks = u32LeftUs / AWUTickUs(i);
+			if (u32Ticks == 0) // less than the shortest tick left
+				break;
+		}
+		u32RemUs += StandbyTicks(i, (uint8_t)u32Ticks);
+		u32SleptMs += u32RemUs / 1000;
+		u32RemUs %= 1000;
+	}
+	return u32SleptMs;
+} /* StandbyFor() */
+
+// Brightness steps of the breathe ramp (0 to 50%, roughly
+// perceptually even)
+static const uint8_t u8Breathe[64] = {
+	0, 0, 1, 1, 2, 3, 5, 7, 9, 11, 13, 16, 19, 23, 26, 30,
+	34, 38, 43, 48, 53, 59, 64, 70, 77, 83, 90, 97, 104, 112, 120, 128,
+	128, 120, 112, 104, 97, 90, 83, 77, 70, 64, 59, 53, 48, 43, 38, 34,
+	30, 26, 23, 19, 16, 13, 11, 9, 7, 5, 3, 2, 1, 1, 0, 0
+};
+
+//
+// Ramp an LED brightness with PWM from 0 to 50% and back
 // The period represents the total up+down time in milliseconds
+// The timer and DMA do the work; the CPU sleeps until it's done.
 //
 void breatheLED(uint8_t u8Pin, int iPeriod)
 {
-	int i, j, iStep, iCount, iOnTime;
-
-	pinMode(u8Pin, OUTPUT);
-	// Use a pwm freq of 1000hz and 50 steps up then 50 steps down
-	iStep = 10000/iPeriod; // us per step
-	iCount = iPeriod / 20;
-	// ramp up
-	iOnTime = 0;
-	for (i=0; i<iCount; i++) {
-		for (j=0; j<20; j++) { // 20ms per step
-			digitalWrite(u8Pin, 1); // on period
-			Delay_Us(iOnTime);
-			digitalWrite(u8Pin, 0); // off period
-			Delay_Us(1000 - iOnTime);
-		} // for j
-		iOnTime += iStep;
-	} // for i
-	// ramp down
-	iOnTime = 500;
-	for (i=0; i<iCount; i++) {
-		for (j=0; j<20; j++) { // 20ms per step
-			digitalWrite(u8Pin, 1); // on period
-			Delay_Us(iOnTime);
-			digitalWrite(u8Pin, 0); // off period
-			Delay_Us(1000 - iOnTime);
-		} // for j
-		iOnTime -= iStep;
-	} // for i
+	pwmRamp(u8Pin, u8Breathe, sizeof(u8Breathe), iPeriod / (int)sizeof(u8Breathe));
+	pwmWait(u8Pin);
 } /* breatheLED() */
 
 void SPI_begin(int iSpeed, int iMode)
@@ -274,6 +494,8 @@ void SPI_begin(int iSpeed, int iMode)
     GPIO_InitTypeDef GPIO_InitStructure={0};
     SPI_InitTypeDef SPI_InitStructure={0};
 
+    iSPISpeed = iSpeed;
+    iSPIMode = iMode;
     RCC_APB2PeriphClockCmd( RCC_APB2Periph_GPIOC | RCC_APB2Periph_SPI1, ENABLE );
 
     GPIO_InitStructure.GPIO_Pin = GPIO_Pin_5;
@@ -317,6 +539,18 @@ void SPI_begin(int iSpeed, int iMode)
 
 } /* SPI_begin() */
 
+//
+// The I2C timing and SPI prescaler are derived from HCLK; set them
+// up again for the new SystemCoreClock (only if they're in use)
+//
+void PeriphRetune(void)
+{
+    if (RCC->APB1PCENR & RCC_APB1Periph_I2C1)
+        I2CSetSpeed(iI2CSpeed);
+    if (RCC->APB2PCENR & RCC_APB2Periph_SPI1)
+        SPI_begin(iSPISpeed, iSPIMode);
+} /* PeriphRetune() */
+
 // polling write
 void SPI_write(uint8_t *pData, int iLen)
 {
@@ -20,12 +20,15 @@
 #ifndef USER_ARDUINO_H_
 #define USER_ARDUINO_H_
 
+#include "config.h"
+
 // GPIO pin states
 enum {
 	OUTPUT = 0,
 	INPUT,
 	INPUT_PULLUP,
-	INPUT_PULLDOWN
+	INPUT_PULLDOWN,
+	INPUT_ANALOG
 };
 
 #define PROGMEM
@@ -35,6 +38,8 @@ enum {
 
 // Wrapper methods
 void delay(int i);
+uint32_t micros(void);
+uint32_t millis(void);
 //
 // Digital pin functions use a numbering scheme to make it easier to map the
 // pin number to a port name and number
@@ -56,10 +61,23 @@ void I2CSetSpeed(int iSpeed);
 // SPI1 (polling mode)
 void SPI_write(uint8_t *pData, int iLen);
 void SPI_begin(int iSpeed, int iMode);
+void PeriphRetune(void);
 
 
 // Random stuff
+// One AWU tick at PWR_AWU_Prescaler_10240 (nominal LSI; StandbySetLSI()
+// sets the measured one)
+#define AWU_TICK_US 82000
 void Standby82ms(uint8_t iTicks);
+uint32_t StandbyFor(uint32_t u32Ms);
+void StandbySetLSI(uint32_t u32Hz);
+#ifdef DEBUG_MODE
+#define StandbyPinMode(p, m) // debug builds don't use standby
+#else
+void StandbyPinMode(uint8_t u8Pin, int iMode);
+#endif
+void StandbyWake(void);
+void StandbyArm(void);
 void breatheLED(uint8_t u8Pin, int iPeriod);
 
 
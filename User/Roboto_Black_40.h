@@ -1,24 +1,9 @@
 // Created by http://oleddisplay.squix.ch/ Consider a donation
 // In case of problems make sure that you are using the font file with the correct version!
+// Trimmed to '0'-':' (the CO2 level and the times are all that use it)
 const uint8_t Roboto_Black_40Bitmaps[] = {
 
 	// Bitmap Data:
-	0x00, // ' '
-	0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0x7E,0x7E,0x7E,0x7E,0x7E,0x7E,0x7E,0x7E,0x7E,0x7E,0x7C,0x7C,0x7C,0x00,0x00,0x00,0x3C,0xFE,0xFE,0xFE,0xFE,0x3C, // '!'
-	0xF1,0xEF,0x1E,0xF1,0xEF,0x1E,0xF1,0xEF,0x1E,0xF1,0xEF,0x1E,0xF1,0xCE,0x1C,0xE1,0xC0, // '"'
-	0x00,0xF1,0xE0,0x01,0xE3,0xC0,0x03,0xC7,0x80,0x07,0x8F,0x00,0x1E,0x3C,0x00,0x3C,0x78,0x00,0x78,0xF0,0x00,0xF1,0xE0,0x3F,0xFF,0xFC,0x7F,0xFF,0xF8,0xFF,0xFF,0xF1,0xFF,0xFF,0xE0,0x3C,0x78,0x00,0x78,0xF0,0x00,0xF1,0xE0,0x01,0xE3,0xC0,0x07,0x87,0x01,0xFF,0xFF,0xF3,0xFF,0xFF,0xE7,0xFF,0xFF,0xCF,0xFF,0xFF,0x80,0xF1,0xE0,0x01,0xC3,0xC0,0x07,0x8F,0x00,0x0F,0x1E,0x00,0x1E,0x3C,0x00,0x3C,0x78,0x00,0x78,0xF0,0x01,0xE1,0xE0,0x00, // '#'
-	0x00,0x70,0x00,0x07,0x00,0x00,0x70,0x00,0x07,0x00,0x03,0xFC,0x00,0xFF,0xF0,0x1F,0xFF,0x83,0xFF,0xFC,0x7F,0xFF,0xC7,0xF0,0xFE,0x7E,0x0F,0xE7,0xE0,0x7E,0x7E,0x07,0xE7,0xE0,0x00,0x7F,0x00,0x07,0xF8,0x00,0x3F,0xF0,0x01,0xFF,0xC0,0x0F,0xFE,0x00,0x3F,0xF8,0x00,0xFF,0xC0,0x03,0xFC,0x00,0x0F,0xE0,0x00,0xFE,0xFC,0x07,0xEF,0xC0,0x7E,0xFE,0x0F,0xEF,0xF0,0xFE,0x7F,0xFF,0xE7,0xFF,0xFC,0x3F,0xFF,0x80,0xFF,0xF0,0x03,0xFC,0x00,0x0E,0x00,0x00,0xE0,0x00,0x0E,0x00,0x00,0xE0,0x00, // '$'
-	0x1F,0x80,0x00,0x07,0xFC,0x00,0x01,0xFF,0x80,0x00,0x7F,0xF8,0x10,0x0F,0x8F,0x07,0x81,0xE1,0xE0,0xF0,0x3C,0x3C,0x3C,0x07,0x87,0x8F,0x00,0xF8,0xF1,0xE0,0x1F,0xFE,0x78,0x01,0xFF,0xCF,0x00,0x1F,0xF3,0xC0,0x01,0xF8,0xF0,0x00,0x00,0x1E,0x00,0x00,0x07,0x80,0x00,0x01,0xF0,0x00,0x00,0x3C,0x7C,0x00,0x0F,0x3F,0xE0,0x01,0xEF,0xFE,0x00,0x79,0xFF,0xE0,0x1E,0x7C,0x7C,0x03,0xCF,0x87,0x80,0xF1,0xF0,0xF0,0x3E,0x3E,0x1E,0x07,0x87,0xC7,0xC1,0xE0,0x7F,0xF8,0x0C,0x0F,0xFE,0x00,0x00,0xFF,0x80,0x00,0x07,0xC0, // '%'
-	0x01,0xFC,0x00,0x00,0xFF,0x80,0x00,0xFF,0xF0,0x00,0x3F,0xFE,0x00,0x1F,0xFF,0xC0,0x07,0xE3,0xF0,0x01,0xF0,0x7C,0x00,0x7C,0x1F,0x00,0x1F,0x07,0xC0,0x07,0xE3,0xE0,0x01,0xFF,0xF8,0x00,0x3F,0xFC,0x00,0x0F,0xFE,0x00,0x01,0xFF,0x00,0x00,0xFF,0x83,0xF0,0x7F,0xF0,0xFC,0x3F,0xFE,0x3F,0x1F,0xFF,0x8F,0x87,0xE7,0xF7,0xE3,0xF8,0xFF,0xF8,0xFE,0x1F,0xFE,0x3F,0x83,0xFF,0x0F,0xE0,0xFF,0xC3,0xFC,0x3F,0xE0,0x7F,0xFF,0xF8,0x1F,0xFF,0xFF,0x03,0xFF,0xFF,0xE0,0x3F,0xFD,0xFC,0x03,0xF8,0x3F,0x80, // '&'
-	0xF7,0xBD,0xEF,0x7B,0xDE,0xF7,0xBC, // '''
-	0x00,0x40,0x1E,0x03,0xE0,0x7E,0x07,0xC0,0xF8,0x1F,0x01,0xF0,0x3E,0x03,0xE0,0x3E,0x07,0xC0,0x7C,0x07,0xC0,0x7C,0x07,0xC0,0xFC,0x0F,0xC0,0xFC,0x0F,0xC0,0xFC,0x0F,0xC0,0xFC,0x0F,0xC0,0x7C,0x07,0xC0,0x7C,0x07,0xC0,0x7C,0x03,0xE0,0x3E,0x03,0xE0,0x1F,0x01,0xF0,0x0F,0x80,0x7C,0x07,0xE0,0x3E,0x01,0xE0,0x04, // '('
-	0x40,0x0F,0x00,0xF8,0x0F,0xC0,0x7C,0x03,0xE0,0x1F,0x01,0xF0,0x0F,0x80,0xF8,0x0F,0xC0,0x7C,0x07,0xC0,0x7C,0x07,0xE0,0x7E,0x07,0xE0,0x7E,0x07,0xE0,0x7E,0x07,0xE0,0x7E,0x07,0xE0,0x7E,0x07,0xE0,0x7E,0x07,0xC0,0x7C,0x07,0xC0,0xFC,0x0F,0x80,0xF8,0x1F,0x01,0xF0,0x3E,0x07,0xE0,0xFC,0x0F,0x80,0xF0,0x04,0x00, // ')'
-	0x01,0xE0,0x00,0x3C,0x00,0x07,0x80,0x00,0xE0,0x04,0x1C,0x11,0xE3,0x8F,0x3F,0xF7,0xE7,0xFF,0xFC,0x3F,0xFE,0x40,0x7C,0x00,0x1F,0xC0,0x07,0xBC,0x01,0xF7,0xC0,0x7C,0x78,0x1F,0x0F,0x80,0xE0,0xE0,0x08,0x08,0x00, // '*'
-	0x01,0xF8,0x00,0x1F,0x80,0x01,0xF8,0x00,0x1F,0x80,0x01,0xF8,0x00,0x1F,0x80,0x01,0xF8,0x0F,0xFF,0xFE,0xFF,0xFF,0xEF,0xFF,0xFE,0xFF,0xFF,0xEF,0xFF,0xFE,0x01,0xF8,0x00,0x1F,0x80,0x01,0xF8,0x00,0x1F,0x80,0x01,0xF8,0x00,0x1F,0x80,0x01,0xF8,0x00,0x1F,0x80, // '+'
-	0x3E,0x3E,0x3E,0x3E,0x3E,0x3E,0x3E,0x3E,0x7C,0x7C,0xF8,0xF8,0x30, // ','
-	0xFF,0xF7,0xFF,0xBF,0xFD,0xFF,0xEF,0xFF,0x00, // '-'
-	0x3C,0x3F,0x3F,0x9F,0xE7,0xE1,0xE0, // '.'
-	0x00,0x3E,0x00,0x3C,0x00,0x7C,0x00,0x7C,0x00,0x78,0x00,0xF8,0x00,0xF8,0x00,0xF0,0x01,0xF0,0x01,0xF0,0x01,0xF0,0x01,0xE0,0x03,0xE0,0x03,0xE0,0x03,0xC0,0x07,0xC0,0x07,0xC0,0x07,0x80,0x0F,0x80,0x0F,0x80,0x0F,0x00,0x1F,0x00,0x1F,0x00,0x1E,0x00,0x3E,0x00,0x3E,0x00,0x3E,0x00,0x3C,0x00,0x7C,0x00,0x7C,0x00,0xF8,0x00, // '/'
 	0x03,0xF8,0x00,0xFF,0xE0,0x1F,0xFF,0x03,0xFF,0xF8,0x7F,0xFF,0xC7,0xF1,0xFC,0xFE,0x0F,0xEF,0xE0,0xFE,0xFC,0x07,0xEF,0xC0,0x7E,0xFC,0x07,0xEF,0xC0,0x7E,0xFC,0x07,0xEF,0xC0,0x7E,0xFC,0x07,0xEF,0xC0,0x7E,0xFC,0x07,0xEF,0xC0,0x7E,0xFC,0x07,0xEF,0xC0,0x7E,0xFC,0x07,0xEF,0xE0,0xFE,0xFE,0x0F,0xE7,0xF1,0xFC,0x7F,0xFF,0xC3,0xFF,0xF8,0x1F,0xFF,0x00,0xFF,0xE0,0x03,0xF8,0x00, // '0'
 	0x00,0x18,0x03,0xE0,0x7F,0x8F,0xFE,0xFF,0xFB,0xFF,0xEF,0xFF,0xBF,0x7E,0xC1,0xF8,0x07,0xE0,0x1F,0x80,0x7E,0x01,0xF8,0x07,0xE0,0x1F,0x80,0x7E,0x01,0xF8,0x07,0xE0,0x1F,0x80,0x7E,0x01,0xF8,0x07,0xE0,0x1F,0x80,0x7E,0x01,0xF8,0x07,0xE0,0x1F,0x80,0x7E,0x01,0xF8, // '1'
 	0x01,0xFC,0x00,0x3F,0xF8,0x07,0xFF,0xF0,0x7F,0xFF,0x83,0xFF,0xFE,0x3F,0x87,0xF1,0xF8,0x1F,0xDF,0xC0,0xFE,0xFE,0x07,0xF7,0xF0,0x3F,0x80,0x01,0xFC,0x00,0x1F,0xC0,0x00,0xFE,0x00,0x0F,0xE0,0x00,0xFF,0x00,0x0F,0xF0,0x00,0xFF,0x00,0x0F,0xF0,0x00,0x7F,0x00,0x07,0xF0,0x00,0x7F,0x00,0x07,0xF0,0x00,0x7F,0x80,0x07,0xF8,0x00,0x7F,0xFF,0xF3,0xFF,0xFF,0x9F,0xFF,0xFC,0xFF,0xFF,0xE7,0xFF,0xFF,0x00, // '2'
@@ -33,34 +18,18 @@ const uint8_t Roboto_Black_40Bitmaps[] = {
 };
 const GFXglyph Roboto_Black_40Glyphs[] PROGMEM = {
 // bitmapOffset, width, height, xAdvance, xOffset, yOffset
-	  {     0,   1,   1,  11,    0,    0 }, // ' '
-	  {     1,   8,  29,  12,    2,  -29 }, // '!'
-	  {    30,  12,  11,  14,    1,  -30 }, // '"'
-	  {    47,  23,  29,  24,    0,  -29 }, // '#'
-	  {   131,  20,  37,  24,    2,  -33 }, // '$'
-	  {   224,  27,  29,  31,    2,  -29 }, // '%'
-	  {   322,  26,  29,  28,    1,  -29 }, // '&'
-	  {   417,   5,  11,   7,    1,  -30 }, // '''
-	  {   424,  12,  40,  15,    2,  -31 }, // '('
-	  {   484,  12,  40,  15,    1,  -31 }, // ')'
-	  {   544,  19,  17,  20,    1,  -29 }, // '*'
-	  {   585,  20,  20,  22,    1,  -23 }, // '+'
-	  {   635,   8,  13,  12,    1,   -6 }, // ','
-	  {   648,  13,   5,  19,    3,  -15 }, // '-'
-	  {   657,   9,   6,  13,    2,   -6 }, // '.'
-	  {   664,  16,  31,  15,   -1,  -29 }, // '/'
-	  {   726,  20,  29,  24,    2,  -29 }, // '0'
-	  {   799,  14,  29,  24,    3,  -29 }, // '1'
-	  {   850,  21,  29,  24,    1,  -29 }, // '2'
-	  {   927,  22,  29,  24,    1,  -29 }, // '3'
-	  {  1007,  22,  29,  24,    1,  -29 }, // '4'
-	  {  1087,  21,  29,  24,    1,  -29 }, // '5'
-	  {  1164,  21,  29,  24,    2,  -29 }, // '6'
-	  {  1241,  22,  29,  24,    1,  -29 }, // '7'
-	  {  1321,  20,  29,  24,    2,  -29 }, // '8'
-	  {  1394,  20,  29,  24,    2,  -29 }, // '9'
-      {  1467,   9,  22,  13,    2,  -22 } // ':'
+	  {     0,  20,  29,  24,    2,  -29 }, // '0'
+	  {    73,  14,  29,  24,    3,  -29 }, // '1'
+	  {   124,  21,  29,  24,    1,  -29 }, // '2'
+	  {   201,  22,  29,  24,    1,  -29 }, // '3'
+	  {   281,  22,  29,  24,    1,  -29 }, // '4'
+	  {   361,  21,  29,  24,    1,  -29 }, // '5'
+	  {   438,  21,  29,  24,    2,  -29 }, // '6'
+	  {   515,  22,  29,  24,    1,  -29 }, // '7'
+	  {   595,  20,  29,  24,    2,  -29 }, // '8'
+	  {   668,  20,  29,  24,    2,  -29 }, // '9'
+      {   741,   9,  22,  13,    2,  -22 } // ':'
 };
 const GFXfont Roboto_Black_40 PROGMEM = {
-(uint8_t  *)Roboto_Black_40Bitmaps,(GFXglyph *)Roboto_Black_40Glyphs,0x20, 0x3a, 48};
+(uint8_t  *)Roboto_Black_40Bitmaps,(GFXglyph *)Roboto_Black_40Glyphs,0x30, 0x3a, 48};
 
@@ -0,0 +1,122 @@
+//
+// Adaptive CO2 sampling rate
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "scd41.h"
+#include "adapt.h"
+
+#ifdef USE_ADAPT
+#define ADAPT_FRAC 4
+
+static const uint8_t u8Interval[ADAPT_RATES] = {5, 30, 180}; // seconds
+static const uint8_t u8PowerMode[ADAPT_RATES] = {SCD_POWERMODE_NORMAL, SCD_POWERMODE_LOW, SCD_POWERMODE_ONESHOT};
+static ADAPT adapt;
+
+void adaptInit(int iRate)
+{
+	memset(&adapt, 0, sizeof(ADAPT));
+	adapt.iRate = iRate;
+} /* adaptInit() */
+
+// The edges of the display categories (see ShowCurrent)
+static const int iThresholds[] = {1000, 1500, 2000, 2500};
+
+static int NearThreshold(int iCO2)
+{
+int i, iDist;
+
+	for (i=0; i<(int)(sizeof(iThresholds)/sizeof(int)); i++) {
+		iDist = iCO2 - iThresholds[i];
+		if (iDist > -ADAPT_NEAR_PPM && iDist < ADAPT_NEAR_PPM)
+			return 1;
+	}
+	return 0;
+} /* NearThreshold() */
+
+//
+// Add a sample taken iSeconds after the previous one
+// Returns the rate to sample at from now on
+//
+int adaptAdd(int iCO2, int iSeconds)
+{
+int32_t i32Val = (int32_t)iCO2 << ADAPT_FRAC;
+int32_t i32Dist;
+int bJump;
+
+	if (adapt.iCount++ == 0) { // first one
+		adapt.i32Level = adapt.i32Anchor = i32Val;
+		return adapt.iRate;
+	}
+	i32Dist = i32Val - adapt.i32Level;
+	if (i32Dist < 0) i32Dist = -i32Dist;
+	bJump = (i32Dist > 3*adapt.i32Noise + (ADAPT_JUMP_PPM << ADAPT_FRAC));
+	// the slower the rate, the more each sample counts
+	if (bJump || iSeconds >= u8Interval[ADAPT_NORMAL])
+		adapt.i32Level += (i32Val - adapt.i32Level) >> 1;
+	else
+		adapt.i32Level += (i32Val - adapt.i32Level) >> 2;
+	if (!bJump) // a real change isn't noise
+		adapt.i32Noise += (i32Dist - adapt.i32Noise) >> 3;
+	adapt.iWindowSecs += iSeconds;
+	if (adapt.iWindowSecs >= ADAPT_WINDOW) {
+		adapt.iSlope = (int)((((adapt.i32Level - adapt.i32Anchor) * 60) / adapt.iWindowSecs) >> ADAPT_FRAC);
+		adapt.i32Anchor = adapt.i32Level;
+		adapt.iWindowSecs = 0;
+	}
+
+	if (bJump || NearThreshold(iCO2) || adapt.iSlope >= ADAPT_FAST_SLOPE || adapt.iSlope <= -ADAPT_FAST_SLOPE) {
+		adapt.iRate = ADAPT_FAST;
+		adapt.iSteadySecs = 0;
+	} else if (adapt.iSlope <= ADAPT_STEADY_SLOPE && adapt.iSlope >= -ADAPT_STEADY_SLOPE) {
+		adapt.iSteadySecs += iSeconds;
+		if (adapt.iSteadySecs >= ADAPT_STEADY_SECS && adapt.iRate < ADAPT_SLOW) {
+			adapt.iRate++; // back off one step at a time
+			adapt.iSteadySecs = 0;
+		}
+	} else { // drifting; not worth the fast rate, but don't sleep through it
+		if (adapt.iRate == ADAPT_SLOW)
+			adapt.iRate = ADAPT_NORMAL;
+		adapt.iSteadySecs = 0;
+	}
+	return adapt.iRate;
+} /* adaptAdd() */
+
+int adaptRate(void)
+{
+	return adapt.iRate;
+} /* adaptRate() */
+
+//
+// Seconds between samples at the current rate
+//
+int adaptInterval(void)
+{
+	return u8Interval[adapt.iRate];
+} /* adaptInterval() */
+
+//
+// SCD41 power mode for the current rate
+//
+int adaptPowerMode(void)
+{
+	return u8PowerMode[adapt.iRate];
+} /* adaptPowerMode() */
+#endif // USE_ADAPT
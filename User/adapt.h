@@ -0,0 +1,85 @@
+//
+// Adaptive CO2 sampling rate
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_ADAPT_H_
+#define USER_ADAPT_H_
+
+#include "config.h"
+#include "scd41.h"
+
+// The sample rate follows the air: while CO2 is steady, the SCD41 is
+// slowed down step by step to single shot measurements; as soon as it
+// jumps, trends up or down or sits near a threshold it goes back to
+// 5 second periodic measurements.
+// On a week of the host traces (host/sim_adapt) that costs the SCD41
+// 94-164 mAh a day against 360 for fixed 5 seconds and 77 for fixed
+// 30, and the level follows a threshold crossing 1.6-4.5 seconds late
+// on average (13-17 at 30 seconds), 147 at worst when it rises from
+// a single shot interval.
+enum
+{
+	ADAPT_FAST=0, // periodic, every 5 seconds
+	ADAPT_NORMAL, // low power periodic, every 30 seconds
+	ADAPT_SLOW, // single shot, every 3 minutes
+	ADAPT_RATES
+};
+
+// The trend is measured over at least ADAPT_WINDOW seconds of the
+// smoothed level, so the sensor noise at the fast rate isn't taken
+// for movement (ppm per minute)
+#define ADAPT_WINDOW 60
+#define ADAPT_FAST_SLOPE 20
+#define ADAPT_STEADY_SLOPE 5
+// A sample this far (plus 3x the noise) from the level is a jump
+#define ADAPT_JUMP_PPM 30
+// How close to a threshold counts as near it
+#define ADAPT_NEAR_PPM 50
+// How long it has to be steady before slowing down one step
+#define ADAPT_STEADY_SECS 180
+
+typedef struct tagAdapt
+{
+	int32_t i32Level; // smoothed CO2, Q4
+	int32_t i32Noise; // mean distance of the samples from the level, Q4
+	int32_t i32Anchor; // level at the start of the trend window, Q4
+	int iWindowSecs; // length of the trend window so far
+	int iSlope; // ppm per minute over the last window
+	int iSteadySecs;
+	int iRate;
+	int iCount;
+} ADAPT;
+
+#ifdef USE_ADAPT
+void adaptInit(int iRate);
+int adaptAdd(int iCO2, int iSeconds);
+int adaptRate(void);
+int adaptInterval(void);
+int adaptPowerMode(void);
+#else
+// the rate stays at ADAPT_NORMAL
+#define adaptInit(r)
+#define adaptAdd(c, s)
+#define adaptRate() ADAPT_NORMAL
+#define adaptInterval() 30
+#define adaptPowerMode() SCD_POWERMODE_LOW
+#endif
+
+#endif /* USER_ADAPT_H_ */
@@ -0,0 +1,186 @@
+//
+// Non-blocking alert pattern player
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "sched.h"
+#include "battery.h"
+#include "pwm.h"
+#include "alert.h"
+
+#define STEPS(s) s, sizeof(s)/sizeof(ALERTSTEP)
+
+// The original ShowAlert() patterns
+static const ALERTSTEP stepsVib[] = {{ALERT_OUT_MOTOR, 15}, {0, 82}};
+static const ALERTSTEP stepsLED[] = {{ALERT_OUT_GREEN, 30}, {ALERT_OUT_RED, 30}};
+static const ALERTSTEP stepsBoth[] = {{ALERT_OUT_MOTOR, 15}, {ALERT_OUT_GREEN, 40}, {ALERT_OUT_RED, 40}};
+// Double pulses for the short term limit
+static const ALERTSTEP stepsVib2[] = {{ALERT_OUT_MOTOR, 15}, {0, 15}, {ALERT_OUT_MOTOR, 15}, {0, 60}};
+static const ALERTSTEP stepsLED2[] = {{ALERT_OUT_RED, 20}, {0, 10}, {ALERT_OUT_RED, 20}, {0, 30}};
+static const ALERTSTEP stepsBoth2[] = {{ALERT_OUT_MOTOR | ALERT_OUT_RED, 15}, {0, 15}, {ALERT_OUT_MOTOR | ALERT_OUT_RED, 15}, {0, 60}};
+// A single nudge for a CO2 level change
+static const ALERTSTEP stepsVib1[] = {{ALERT_OUT_MOTOR, 20}, {0, 50}};
+static const ALERTSTEP stepsLED1[] = {{ALERT_OUT_RED, 30}, {0, 30}};
+static const ALERTSTEP stepsBoth1[] = {{ALERT_OUT_MOTOR | ALERT_OUT_RED, 20}, {0, 50}};
+
+static const ALERTPATTERN patterns[ALERT_EVENTS][ALERT_COUNT] = {
+	{{STEPS(stepsVib), 1}, {STEPS(stepsLED), 4}, {STEPS(stepsBoth), 1}}, // startup
+	{{STEPS(stepsVib), 3}, {STEPS(stepsLED), 4}, {STEPS(stepsBoth), 3}}, // timer
+	{{STEPS(stepsVib), 3}, {STEPS(stepsLED), 4}, {STEPS(stepsBoth), 3}}, // TWA
+	{{STEPS(stepsVib2), 4}, {STEPS(stepsLED2), 5}, {STEPS(stepsBoth2), 4}}, // STEL
+	{{STEPS(stepsVib1), 2}, {STEPS(stepsLED1), 3}, {STEPS(stepsBoth1), 2}} // level
+};
+static const uint8_t u8Pins[3] = {MOTOR_PIN, LED_GREEN, LED_RED}; // ALERT_OUT_* order
+static const uint8_t u8On = PWM_TOP;
+
+static const ALERTPATTERN *pPlaying; // NULL when idle
+static int iStep, iRepeatsLeft, iAlertTask = -1;
+static uint32_t u32End;
+
+//
+// Start the next step; returns its length (ms) or 0 when it's all done
+//
+static int alertNext(void)
+{
+const ALERTSTEP *pStep;
+int i, iMs;
+
+	if (pPlaying == NULL)
+		return 0;
+	if (iStep == pPlaying->u8Steps) {
+		iStep = 0;
+		if (--iRepeatsLeft <= 0) {
+			alertCancel(); // turns off what the last step left on
+			return 0;
+		}
+	}
+	pStep = &pPlaying->pSteps[iStep++];
+	iMs = pStep->u8Time * ALERT_TIME_MS;
+	for (i=0; i<3; i++) {
+		if (pStep->u8Out & (1 << i))
+			pwmRamp(u8Pins[i], &u8On, 1, iMs); // turns itself off
+		else
+			pwmCancel(u8Pins[i]); // the last step's output may still be on
+	}
+	return iMs;
+} /* alertNext() */
+
+static void AlertTask(void)
+{
+int iMs = alertNext();
+
+	if (iMs)
+		schedWake(iAlertTask, iMs);
+} /* AlertTask() */
+
+//
+// Add the player to the scheduler; call it after each schedInit()
+//
+void alertInit(void)
+{
+	alertCancel();
+	iAlertTask = schedAdd(AlertTask, 0, -1);
+} /* alertInit() */
+
+//
+// Play a pattern iRepeats times without waiting for it; it replaces
+// one which is already playing
+//
+void alertStart(const ALERTPATTERN *pPattern, int iRepeats)
+{
+int i, iMs = 0;
+
+	alertCancel();
+	if (iRepeats <= 0)
+		return;
+	for (i=0; i<pPattern->u8Steps; i++)
+		iMs += pPattern->pSteps[i].u8Time * ALERT_TIME_MS;
+	u32End = millis() + (uint32_t)iMs * iRepeats;
+	pPlaying = pPattern;
+	iStep = 0;
+	iRepeatsLeft = iRepeats;
+	if (iAlertTask >= 0)
+		schedWake(iAlertTask, 0);
+} /* alertStart() */
+
+//
+// Play the pattern for an event in the user's setting; it plays
+// fewer times as the battery drains (but at least once)
+//
+void alertPlay(int iEvent, int iSetting)
+{
+const ALERTPATTERN *pPattern = &patterns[iEvent][iSetting];
+int iRepeats = pPattern->u8Repeats - batteryPolicy()->u8AlertDrop;
+
+	alertStart(pPattern, (iRepeats < 1) ? 1 : iRepeats);
+} /* alertPlay() */
+
+//
+// Stop the alert (e.g. a button was pressed)
+// Returns non-zero if one was playing
+//
+int alertCancel(void)
+{
+int i;
+
+	if (pPlaying == NULL)
+		return 0;
+	pPlaying = NULL;
+	if (iAlertTask >= 0)
+		schedStop(iAlertTask);
+	for (i=0; i<3; i++)
+		pwmCancel(u8Pins[i]);
+	return 1;
+} /* alertCancel() */
+
+int alertBusy(void)
+{
+	return (pPlaying != NULL);
+} /* alertBusy() */
+
+//
+// Time until the alert is done (ms)
+//
+int alertTimeLeft(void)
+{
+int32_t i32Left = (int32_t)(u32End - millis());
+
+	if (pPlaying == NULL || i32Left < 0)
+		return 0;
+	return (int)i32Left;
+} /* alertTimeLeft() */
+
+//
+// Play the alert to the end when the scheduler isn't running
+// (e.g. at power up); the CPU sleeps through the steps with an output
+// on and waits out the pauses
+//
+void alertWait(void)
+{
+uint32_t u32Start;
+int iMs;
+
+	while ((iMs = alertNext()) != 0) {
+		u32Start = millis();
+		pwmWait(PWM_ANY);
+		while ((millis() - u32Start) < (uint32_t)iMs) {};
+	}
+} /* alertWait() */
@@ -0,0 +1,77 @@
+//
+// Non-blocking alert pattern player
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_ALERT_H_
+#define USER_ALERT_H_
+
+// An alert pattern is a short table of steps, each turning on some of
+// the outputs for a time; the table plays a number of times. The PWM
+// timers end each step in hardware and a scheduler task starts the
+// next one, so sampling and the UI carry on while it plays and the CPU
+// sleeps in between. Only one LED can be on in a step (they share
+// TIM1, which plays one ramp at a time).
+#define ALERT_OUT_MOTOR 1
+#define ALERT_OUT_GREEN 2
+#define ALERT_OUT_RED 4
+#define ALERT_TIME_MS 10 // units of u8Time
+
+// The alert setting (which outputs the user wants)
+enum
+{
+	ALERT_VIBRATION=0,
+	ALERT_LED,
+	ALERT_BOTH,
+	ALERT_COUNT
+};
+
+// What the alert is for; each one has a pattern per setting
+enum
+{
+	ALERT_EVENT_STARTUP=0,
+	ALERT_EVENT_TIMER, // countdown done
+	ALERT_EVENT_TWA, // 8 hour exposure limit exceeded
+	ALERT_EVENT_STEL, // 15 minute limit exceeded (more urgent)
+	ALERT_EVENT_LEVEL, // the CO2 rose to LEVEL_ALERT or above
+	ALERT_EVENTS
+};
+
+typedef struct tagAlertStep
+{
+	uint8_t u8Out; // ALERT_OUT_* bits (0 = pause)
+	uint8_t u8Time; // x ALERT_TIME_MS
+} ALERTSTEP;
+
+typedef struct tagAlertPattern
+{
+	const ALERTSTEP *pSteps;
+	uint8_t u8Steps;
+	uint8_t u8Repeats; // with a good battery
+} ALERTPATTERN;
+
+void alertInit(void);
+void alertPlay(int iEvent, int iSetting);
+void alertStart(const ALERTPATTERN *pPattern, int iRepeats);
+int alertCancel(void);
+int alertBusy(void);
+int alertTimeLeft(void);
+void alertWait(void);
+
+#endif /* USER_ALERT_H_ */
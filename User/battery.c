@@ -0,0 +1,178 @@
+//
+// Battery gauge and low battery policy
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "battery.h"
+
+static const BATTPOLICY policy[BATTERY_LEVELS] = {
+	{0, 0xff, 1, 0}, // OK
+	{1, 0x40, 1, 1}, // LOW: half as many samples, dimmer display
+	{2, 0x08, 0, 2}  // CRITICAL: quarter rate, display only on request
+};
+static volatile uint8_t u8Level; // the PVD interrupt can raise it
+
+#ifdef USE_BATTERY
+static int iBattMV, iVDDMV;
+static uint32_t u32LastCheck;
+static int bChecked;
+
+void PVD_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+//
+// Enable the PVD early warning
+//
+void batteryInit(void)
+{
+EXTI_InitTypeDef EXTI_InitStructure = {0};
+
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
+	PWR_PVDLevelConfig(BATTERY_PVD_LEVEL);
+	PWR_PVDCmd(ENABLE);
+	EXTI_InitStructure.EXTI_Line = EXTI_Line8; // PVD output
+	EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising; // VDD went below the level
+	EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+	EXTI_Init(&EXTI_InitStructure);
+	EXTI->EVENR |= EXTI_Line8; // wake up from standby too
+	NVIC_EnableIRQ(PVD_IRQn);
+	// a pull-down on the divider would waste power in standby
+	pinMode(BATT_DIV_PIN, INPUT_ANALOG);
+	StandbyPinMode(BATT_DIV_PIN, INPUT_ANALOG);
+} /* batteryInit() */
+
+/*********************************************************************
+ * @fn      PVD_IRQHandler
+ *
+ * @brief   VDD fell below the PVD level; go straight to critical.
+ *
+ * @return  none
+ */
+void PVD_IRQHandler(void)
+{
+	EXTI->INTFR = EXTI_Line8;
+	u8Level = BATTERY_CRITICAL;
+	StandbyWake();
+} /* PVD_IRQHandler() */
+
+static uint32_t ReadChannel(uint8_t u8Channel)
+{
+uint32_t u32Sum = 0;
+int i;
+
+	ADC_RegularChannelConfig(ADC1, u8Channel, 1, ADC_SampleTime_241Cycles); // the divider is high impedance
+	for (i=0; i<BATT_ADC_SAMPLES; i++) {
+		ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+		while (ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC) == RESET);
+		u32Sum += ADC_GetConversionValue(ADC1);
+	}
+	return u32Sum;
+} /* ReadChannel() */
+
+//
+// Measure VDD and the battery; the ADC is only clocked while reading
+// Returns the battery voltage in mV
+//
+int batteryRead(void)
+{
+ADC_InitTypeDef ADC_InitStructure = {0};
+uint32_t u32Ref, u32Batt;
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, ENABLE);
+	RCC_ADCCLKConfig(RCC_PCLK2_Div4);
+	pinMode(BATT_DIV_PIN, INPUT_ANALOG);
+
+	ADC_InitStructure.ADC_Mode = ADC_Mode_Independent;
+	ADC_InitStructure.ADC_ScanConvMode = DISABLE;
+	ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
+	ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+	ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
+	ADC_InitStructure.ADC_NbrOfChannel = 1;
+	ADC_Init(ADC1, &ADC_InitStructure);
+	ADC_Cmd(ADC1, ENABLE);
+	ADC_ResetCalibration(ADC1);
+	while (ADC_GetResetCalibrationStatus(ADC1));
+	ADC_StartCalibration(ADC1);
+	while (ADC_GetCalibrationStatus(ADC1));
+
+	u32Ref = ReadChannel(ADC_Channel_Vrefint);
+	u32Batt = ReadChannel(BATT_ADC_CHANNEL);
+
+	ADC_Cmd(ADC1, DISABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, DISABLE);
+
+	if (u32Ref == 0)
+		return iBattMV;
+	// VDD = Vref * 1023 / ref; the divider halves the battery voltage
+	iVDDMV = (int)((VREFINT_MV * 1023UL * BATT_ADC_SAMPLES) / u32Ref);
+	iBattMV = (int)((u32Batt * 2 * VREFINT_MV) / u32Ref);
+	return iBattMV;
+} /* batteryRead() */
+
+//
+// Re-read the battery every BATTERY_CHECK_MS and update the level
+//
+void batteryUpdate(void)
+{
+uint32_t u32Now = millis();
+int iLevel;
+
+	if (bChecked && (u32Now - u32LastCheck) < BATTERY_CHECK_MS)
+		return;
+	bChecked = 1;
+	u32LastCheck = u32Now;
+	batteryRead();
+	iLevel = u8Level;
+	// step down right away, but only step back up with some margin
+	if (iBattMV < BATTERY_CRITICAL_MV)
+		iLevel = BATTERY_CRITICAL;
+	else if (iBattMV < BATTERY_LOW_MV)
+		iLevel = (iLevel == BATTERY_CRITICAL && iBattMV < BATTERY_CRITICAL_MV + BATTERY_HYST_MV) ? BATTERY_CRITICAL : BATTERY_LOW;
+	else if (iBattMV >= BATTERY_LOW_MV + BATTERY_HYST_MV)
+		iLevel = BATTERY_OK;
+	else if (iLevel == BATTERY_CRITICAL) // just above the low threshold
+		iLevel = BATTERY_LOW;
+	if (PWR_GetFlagStatus(PWR_FLAG_PVDO)) // VDD is still below the PVD level
+		iLevel = BATTERY_CRITICAL;
+	u8Level = (uint8_t)iLevel;
+} /* batteryUpdate() */
+
+int batteryMV(void)
+{
+	return iBattMV;
+} /* batteryMV() */
+
+int batteryVDD(void)
+{
+	return iVDDMV;
+} /* batteryVDD() */
+#endif // USE_BATTERY
+
+int batteryLevel(void)
+{
+	return u8Level;
+} /* batteryLevel() */
+
+const BATTPOLICY *batteryPolicy(void)
+{
+	return &policy[u8Level];
+} /* batteryPolicy() */
@@ -0,0 +1,80 @@
+//
+// Battery gauge and low battery policy
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_BATTERY_H_
+#define USER_BATTERY_H_
+
+#include "config.h"
+
+// The LiPo feeds VDD through an AP2127K-3.3 LDO and also a 470K/470K
+// divider (BATT_DIV) to PD4 (ADC channel 7). The internal reference is
+// measured against VDD to find VDD, which then gives the divider voltage.
+// Both stay correct when the LDO drops out and VDD follows the battery.
+#define BATT_DIV_PIN 0xd4
+#define BATT_ADC_CHANNEL ADC_Channel_7
+#define VREFINT_MV 1200
+#define BATT_ADC_SAMPLES 4
+// How often the policy re-reads the battery
+#define BATTERY_CHECK_MS 60000
+
+// LiPo thresholds (mV); going back up needs BATTERY_HYST_MV more
+// (e.g. when it's being charged)
+#define BATTERY_LOW_MV 3600
+#define BATTERY_CRITICAL_MV 3450
+#define BATTERY_HYST_MV 50
+
+// The PVD watches VDD directly and interrupts as soon as it falls below
+// 3.1V (the battery is at ~3.35V with the LDO in dropout) without
+// waiting for the next reading
+#define BATTERY_PVD_LEVEL PWR_PVDLevel_3V1
+
+enum
+{
+	BATTERY_OK=0,
+	BATTERY_LOW,
+	BATTERY_CRITICAL,
+	BATTERY_LEVELS
+};
+
+// What the rest of the firmware does at each level
+typedef struct tagBattPolicy
+{
+	uint8_t u8IntervalShift; // sample intervals are multiplied by 1<<n
+	uint8_t u8Contrast; // OLED contrast
+	uint8_t bDisplay; // 0 = keep the display off unless a button is pressed
+	uint8_t u8AlertDrop; // the alert patterns play this many fewer times
+} BATTPOLICY;
+
+#ifdef USE_BATTERY
+void batteryInit(void);
+int batteryRead(void);
+void batteryUpdate(void);
+int batteryMV(void);
+int batteryVDD(void);
+#else
+// without the gauge the battery is always taken to be OK
+#define batteryInit()
+#define batteryUpdate()
+#endif // USE_BATTERY
+int batteryLevel(void);
+const BATTPOLICY *batteryPolicy(void);
+
+#endif /* USER_BATTERY_H_ */
@@ -0,0 +1,154 @@
+//
+// Interrupt driven push buttons
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "sched.h"
+#include "ring.h"
+#include "buttons.h"
+
+// The interrupt handler is the producer and the main loop the consumer
+static EVENT events[BUTTON_QUEUE_SIZE];
+static RING ring;
+static volatile uint8_t u8Stable; // debounced state
+static volatile uint32_t u32Edge[2]; // time of the last accepted edge (us)
+static volatile uint8_t u8LongSent; // long press already reported
+
+void EXTI7_0_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+static uint8_t ReadPins(void)
+{
+	return (uint8_t)((~GPIOD->INDR >> 2) & 3); // PD2/PD3, active low
+} /* ReadPins() */
+
+void buttonsInit(void)
+{
+	pinMode(BUTTON0_PIN, INPUT_PULLUP); // Standby82ms keeps these as they are
+	pinMode(BUTTON1_PIN, INPUT_PULLUP);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+	// set up directly; EXTI_Init() and GPIO_EXTILineConfig() cost 200+ bytes
+	AFIO->EXTICR |= (GPIO_PortSourceGPIOD << 4) | (GPIO_PortSourceGPIOD << 6); // EXTI2/3 on PD
+	EXTI->RTENR |= EXTI_Line2 | EXTI_Line3; // both edges
+	EXTI->FTENR |= EXTI_Line2 | EXTI_Line3;
+	EXTI->INTENR |= EXTI_Line2 | EXTI_Line3;
+	EXTI->EVENR |= EXTI_Line2 | EXTI_Line3; // and as events to end a WFE standby
+	u8Stable = ReadPins();
+	ringInit(&ring, events, BUTTON_QUEUE_SIZE);
+	NVIC_EnableIRQ(EXTI7_0_IRQn);
+} /* buttonsInit() */
+
+/*********************************************************************
+ * @fn      EXTI7_0_IRQHandler
+ *
+ * @brief   Debounces the button edges and queues the events.
+ *
+ * @return  none
+ */
+void EXTI7_0_IRQHandler(void)
+{
+uint32_t u32Now = micros();
+uint8_t u8Changed, u8Bit;
+int i;
+
+	EXTI->INTFR = EXTI_Line2 | EXTI_Line3;
+	u8Changed = ReadPins() ^ u8Stable;
+	for (i=0; i<2; i++) {
+		u8Bit = (uint8_t)(1 << i);
+		if (!(u8Changed & u8Bit) || (u32Now - u32Edge[i]) < BUTTON_DEBOUNCE_US)
+			continue; // no change or still bouncing
+		u32Edge[i] = u32Now;
+		u8Stable ^= u8Bit;
+		u8LongSent &= ~u8Bit;
+		ringPut(&ring, EVENT_BUTTON, (u8Stable & u8Bit) ? BUTTON_PRESS : BUTTON_RELEASE, u8Bit | (u8Stable << 8));
+	}
+	StandbyWake();
+	schedSignal();
+} /* EXTI7_0_IRQHandler() */
+
+//
+// Get the next button event; returns 0 if there are none
+// An edge which was ignored as a bounce (a very short tap) is picked up
+// here, as well as a button held for BUTTON_LONG_MS.
+//
+int buttonsRead(BUTTONEVENT *pEvent)
+{
+uint32_t u32Now;
+uint8_t u8Pins, u8Bit;
+int i, bFound = 0;
+EVENT ev;
+
+	if (ringGet(&ring, &ev)) {
+		pEvent->u8Type = ev.u8Code;
+		pEvent->u8Button = (uint8_t)ev.u16Value;
+		pEvent->u8State = (uint8_t)(ev.u16Value >> 8);
+		return 1;
+	}
+	NVIC_DisableIRQ(EXTI7_0_IRQn); // the handler also changes the state
+	u32Now = micros();
+	u8Pins = ReadPins();
+	for (i=0; i<2 && !bFound; i++) {
+		u8Bit = (uint8_t)(1 << i);
+		pEvent->u8Button = u8Bit;
+		if (((u8Pins ^ u8Stable) & u8Bit) && (u32Now - u32Edge[i]) >= BUTTON_DEBOUNCE_US) {
+			u32Edge[i] = u32Now;
+			u8Stable ^= u8Bit;
+			u8LongSent &= ~u8Bit;
+			pEvent->u8Type = (u8Stable & u8Bit) ? BUTTON_PRESS : BUTTON_RELEASE;
+			bFound = 1;
+		} else if ((u8Stable & u8Bit) && !(u8LongSent & u8Bit) && (u32Now - u32Edge[i]) >= BUTTON_LONG_MS*1000UL) {
+			u8LongSent |= u8Bit;
+			pEvent->u8Type = BUTTON_LONG;
+			bFound = 1;
+		}
+	}
+	pEvent->u8State = u8Stable;
+	NVIC_EnableIRQ(EXTI7_0_IRQn);
+	return bFound;
+} /* buttonsRead() */
+
+//
+// Debounced state of the buttons (bit 0 = button 0)
+//
+int buttonsState(void)
+{
+	return u8Stable;
+} /* buttonsState() */
+
+void buttonsFlush(void)
+{
+	ringFlush(&ring);
+} /* buttonsFlush() */
+
+//
+// Sleep until there might be a button event to read
+// While a button is held, wake up periodically to see a long press
+//
+void buttonsWait(void)
+{
+	if (u8Stable) {
+		Delay_Ms(20);
+		return;
+	}
+	__disable_irq(); // so the interrupt can't slip in before the WFI
+	if (ringCount(&ring) == 0)
+		__WFI(); // a pending interrupt still ends it
+	__enable_irq();
+} /* buttonsWait() */
@@ -0,0 +1,56 @@
+//
+// Interrupt driven push buttons
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_BUTTONS_H_
+#define USER_BUTTONS_H_
+
+// The two buttons are on PD2 and PD3 (active low). Both edges trigger
+// EXTI7_0, which also wakes the CPU from standby. The interrupt handler
+// debounces the edges and queues press/release events; long presses
+// are reported when the events are read.
+#define BUTTON0_PIN 0xd2
+#define BUTTON1_PIN 0xd3
+#define BUTTON_DEBOUNCE_US 20000
+#define BUTTON_LONG_MS 1000
+// must be a power of 2
+#define BUTTON_QUEUE_SIZE 8
+
+enum
+{
+	BUTTON_PRESS=0,
+	BUTTON_RELEASE,
+	BUTTON_LONG
+};
+
+typedef struct tagButtonEvent
+{
+	uint8_t u8Type;
+	uint8_t u8Button; // 1 = button 0, 2 = button 1
+	uint8_t u8State; // buttons down after the event
+} BUTTONEVENT;
+
+void buttonsInit(void);
+int buttonsRead(BUTTONEVENT *pEvent);
+int buttonsState(void);
+void buttonsFlush(void);
+void buttonsWait(void);
+
+#endif /* USER_BUTTONS_H_ */
@@ -0,0 +1,82 @@
+//
+// Core clock scaling
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "power.h"
+#include "clock.h"
+#include "pwm.h"
+
+static int iClock = CLOCK_8MHZ; // what SystemInit() sets up
+#ifdef USE_CLOCK_BOOST
+static const uint8_t u8PowerState[CLOCK_SPEEDS] = {POWER_COUNT, POWER_CPU24, POWER_CPU48};
+#endif
+
+//
+// Switch the core clock; returns the previous speed so that it
+// can be restored
+//
+int clockSet(int iSpeed)
+{
+#ifdef USE_CLOCK_BOOST
+int iOld = iClock;
+
+	if (iSpeed == iClock)
+		return iOld;
+	if (u8PowerState[iOld] != POWER_COUNT)
+		powerOff(u8PowerState[iOld]);
+	__disable_irq(); // micros() can't be used until SysTick is re-based
+	if (iOld == CLOCK_48MHZ) { // back to the HSI and stop the PLL
+		RCC->CFGR0 &= ~RCC_SW;
+		while ((RCC->CFGR0 & RCC_SWS) != 0) {};
+		RCC->CTLR &= ~RCC_PLLON;
+	}
+	if (iSpeed == CLOCK_48MHZ) {
+		// 1 wait state above 24MHz, set before speeding up
+		FLASH->ACTLR = (FLASH->ACTLR & ~FLASH_ACTLR_LATENCY) | FLASH_ACTLR_LATENCY_1;
+		RCC->CFGR0 = (RCC->CFGR0 & ~(RCC_HPRE | RCC_PLLSRC)) | RCC_HPRE_DIV1 | RCC_PLLSRC_HSI_Mul2;
+		RCC->CTLR |= RCC_PLLON;
+		while ((RCC->CTLR & RCC_PLLRDY) == 0) {};
+		RCC->CFGR0 = (RCC->CFGR0 & ~RCC_SW) | RCC_SW_PLL;
+		while ((RCC->CFGR0 & RCC_SWS) != 0x08) {};
+	} else {
+		RCC->CFGR0 = (RCC->CFGR0 & ~RCC_HPRE) | ((iSpeed == CLOCK_24MHZ) ? RCC_HPRE_DIV1 : RCC_HPRE_DIV3);
+		FLASH->ACTLR = (FLASH->ACTLR & ~FLASH_ACTLR_LATENCY) | FLASH_ACTLR_LATENCY_0;
+	}
+	iClock = iSpeed;
+	SystemCoreClockUpdate();
+	Delay_Retune();
+	__enable_irq();
+	PeriphRetune();
+	pwmRetune();
+	if (u8PowerState[iSpeed] != POWER_COUNT)
+		powerOn(u8PowerState[iSpeed]);
+	return iOld;
+#else
+	(void)iSpeed;
+	return iClock; // always stays at 8MHz
+#endif // USE_CLOCK_BOOST
+} /* clockSet() */
+
+int clockGet(void)
+{
+	return iClock;
+} /* clockGet() */
@@ -0,0 +1,55 @@
+//
+// Core clock scaling
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_CLOCK_H_
+#define USER_CLOCK_H_
+
+#include "config.h"
+
+// The core normally runs at 8MHz (HSI/3). Rendering and other compute
+// bursts can run at 24MHz (HSI) or 48MHz (HSI*2 PLL) and then drop back,
+// so the CPU gets back to sleep sooner. Every change re-bases the
+// SysTick timebase and sets up the delays, I2C and SPI again, which
+// takes a few us, so only switch around whole operations and never
+// while an I2C/SPI transfer is in progress or before going to standby.
+enum
+{
+	CLOCK_8MHZ=0,
+	CLOCK_24MHZ,
+	CLOCK_48MHZ,
+	CLOCK_SPEEDS
+};
+
+// Speed for drawing. A ShowCurrent frame is mostly I2C (846 bytes, 20.5ms
+// at 400kHz) and the core polls it at whatever speed it runs, so a boost
+// only shortens the drawing in between. host/rvsim (make profile) has
+// a frame at 32.3ms/66uC at 8MHz, 23.9ms/87uC at 24MHz and 22.1ms/121uC
+// at 48MHz with the power.h currents (39.1/28.5/26.3ms and 80/103/143uC
+// when the emoji is redrawn too), so it stays at 8MHz. The ShowCur
+// profile zone and the power screen give the same on the board.
+#define CLOCK_RENDER CLOCK_8MHZ
+// Speed for decoding the history/log for the graphs (no I2C in between)
+#define CLOCK_COMPUTE CLOCK_48MHZ
+
+int clockSet(int iSpeed);
+int clockGet(void);
+
+#endif /* USER_CLOCK_H_ */
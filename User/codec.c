@@ -0,0 +1,110 @@
+//
+// Delta + zig-zag + nibble varint codec for sample series
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <stdint.h>
+#include <string.h>
+#include "codec.h"
+
+//
+// Start a new buffer (and a new keyframe)
+//
+void codecInit(CODEC *pCodec, uint8_t *pData, int iBytes)
+{
+	pCodec->pData = pData;
+	pCodec->iSize = iBytes * 2;
+	pCodec->iPos = 0;
+	memset(pCodec->iLast, 0, sizeof(pCodec->iLast));
+} /* codecInit() */
+
+// number of nibbles needed for a zig-zag value
+static int codecLen(uint32_t u32)
+{
+int iLen = 1;
+
+	while (u32 >= 8) {
+		u32 >>= 3;
+		iLen++;
+	}
+	return iLen;
+} /* codecLen() */
+
+static void codecPutNibble(CODEC *pCodec, uint8_t u8)
+{
+uint8_t *d = &pCodec->pData[pCodec->iPos >> 1];
+
+	if (pCodec->iPos & 1)
+		*d = (*d & 0x0f) | (u8 << 4);
+	else
+		*d = (*d & 0xf0) | u8;
+	pCodec->iPos++;
+} /* codecPutNibble() */
+
+//
+// Append one sample; returns 0 (and writes nothing) if it doesn't fit
+//
+int codecEncode(CODEC *pCodec, const int *pValues)
+{
+int i, iLen = 0;
+uint32_t u32Zig[CODEC_CHANNELS];
+
+	for (i=0; i<CODEC_CHANNELS; i++) {
+		int iDelta = pValues[i] - pCodec->iLast[i];
+		u32Zig[i] = ((uint32_t)iDelta << 1) ^ (uint32_t)(iDelta >> 31);
+		iLen += codecLen(u32Zig[i]);
+	}
+	if (pCodec->iPos + iLen > pCodec->iSize)
+		return 0; // buffer full
+	for (i=0; i<CODEC_CHANNELS; i++) {
+		uint32_t u32 = u32Zig[i];
+		while (u32 >= 8) {
+			codecPutNibble(pCodec, 8 | (u32 & 7));
+			u32 >>= 3;
+		}
+		codecPutNibble(pCodec, (uint8_t)u32);
+		pCodec->iLast[i] = pValues[i];
+	}
+	return 1;
+} /* codecEncode() */
+
+//
+// Read the next sample; returns 0 at the end of the buffer
+// Only reads from pData, so it can decode directly from FLASH
+//
+int codecDecode(CODEC *pCodec, int *pValues)
+{
+int i, iShift;
+uint32_t u32, u32Nibble;
+
+	for (i=0; i<CODEC_CHANNELS; i++) {
+		u32 = 0;
+		iShift = 0;
+		do {
+			if (pCodec->iPos >= pCodec->iSize)
+				return 0;
+			u32Nibble = pCodec->pData[pCodec->iPos >> 1];
+			if (pCodec->iPos & 1) u32Nibble >>= 4;
+			pCodec->iPos++;
+			u32 |= (u32Nibble & 7) << iShift;
+			iShift += 3;
+		} while (u32Nibble & 8);
+		pCodec->iLast[i] += (int)(u32 >> 1) ^ -(int)(u32 & 1);
+		pValues[i] = pCodec->iLast[i];
+	}
+	return 1;
+} /* codecDecode() */
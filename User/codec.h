@@ -0,0 +1,50 @@
+//
+// Delta + zig-zag + nibble varint codec for sample series
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef USER_CODEC_H_
+#define USER_CODEC_H_
+
+//
+// Each sample is CODEC_CHANNELS values (CO2, temperature, humidity).
+// Every value is stored as the zig-zag encoded difference from the previous
+// one, packed into nibbles of 3 data bits + 1 continuation bit:
+// changes of -4..3 take 1 nibble, -32..31 take 2, -256..255 take 3.
+// Each buffer starts from zero, so its first sample is a keyframe and
+// a buffer can be decoded without reading any that came before it.
+// Typical 160 second averages change by a few ppm / tenths of a degree,
+// so a sample takes ~2 bytes instead of 6 for the raw 16-bit values
+// (host/bench_codec, keyframes included: 1.85-2.03 for the blocks of
+// the simulated rooms, 2.1 for their raw 5 second samples).
+//
+#define CODEC_CHANNELS 3
+
+typedef struct tagCodec
+{
+	uint8_t *pData; // packed nibbles, low nibble first
+	int iSize; // size of the buffer in nibbles
+	int iPos; // current nibble
+	int iLast[CODEC_CHANNELS]; // previous values
+} CODEC;
+
+void codecInit(CODEC *pCodec, uint8_t *pData, int iBytes);
+int codecEncode(CODEC *pCodec, const int *pValues);
+int codecDecode(CODEC *pCodec, int *pValues);
+
+#endif /* USER_CODEC_H_ */
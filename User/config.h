@@ -0,0 +1,67 @@
+//
+// Build options
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_CONFIG_H_
+#define USER_CONFIG_H_
+
+// Standby disconnects the debugger; debug builds busy-wait instead and
+// leave the standby code out (about 1.3K)
+#define DEBUG_MODE
+
+// Optional features
+// The code gets the 16K of FLASH less the settings page (16320 bytes),
+// and less the 960 of log pages with USE_FLASHLOG; Ld/Link.ld stops the
+// link if it doesn't fit. llvm-size of the RV32EC build has the default
+// at 16000 bytes without DEBUG_MODE, which leaves no room for any of them,
+// and at 14656 with it, which leaves 1664 bytes for the smaller ones.
+// The sizes are what each one adds to the build without DEBUG_MODE
+// (GCC's output is ~3% smaller); USE_FLASHLOG, USE_STATS and USE_POWER
+// bring in USE_HISTORY as well.
+//#define USE_HISTORY // stats screen and the 1 hour/12 hour/7 day graphs (2668, 736 of RAM)
+//#define USE_FLASHLOG // history blocks logged to FLASH + log graph (1792 + the log pages, 144 of RAM)
+//#define USE_STATS // std deviation, p50 and p95 on the stats screen (1608, 136 of RAM)
+//#define USE_EXPOSURE // 8 hour TWA and 15 minute STEL alarms (1048, 136 of RAM)
+//#define USE_POWER // power state accounting and the power screen (1548, 200 of RAM)
+//#define USE_BATTERY // battery gauge and low battery policy (1076, 16 of RAM)
+//#define USE_ADAPT // low power sample rate follows the CO2 (596, 32 of RAM)
+//#define USE_CLOCK_BOOST // 24/48MHz for drawing and the graphs (1076, 8 of RAM)
+//#define USE_LSI_CAL // LSI calibration for the standby timing (1756, 8 of RAM; none with DEBUG_MODE)
+//#define USE_PWM // timer PWM + DMA ramps for the LEDs and motor (2928)
+//#define USE_LABEL_FONT // Roboto for the temperature and humidity, not 8x8 (1416)
+//#define USE_STEALTH // stealth mode (the level as vibration pulses) (816)
+//#define USE_CALIBRATE // forced recalibration in fresh air (1076)
+//#define USE_TIMER // timer mode and the timer over the CO2 display (1140, 28 of RAM)
+//#define USE_HAPTIC // stealth mode encodings besides pulses (544 over USE_STEALTH)
+
+// The stats screen is also the way to the log graph and the stats and
+// power figures
+#if defined(USE_FLASHLOG) || defined(USE_STATS) || defined(USE_POWER)
+#ifndef USE_HISTORY
+#define USE_HISTORY
+#endif
+#endif
+// and the encodings are for stealth mode
+#if defined(USE_HAPTIC) && !defined(USE_STEALTH)
+#define USE_STEALTH
+#endif
+// The zone profiler (PROFILE) is switched on in profile.h
+
+#endif /* USER_CONFIG_H_ */
@@ -0,0 +1,129 @@
+//
+// Time weighted CO2 exposure (8 hour TWA and 15 minute STEL)
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <stdint.h>
+#include <string.h>
+#include "exposure.h"
+
+#ifdef USE_EXPOSURE
+// The accumulators live in RAM, which the CH32V003 keeps through standby.
+// The callers pass the real elapsed time including the time spent in
+// standby, so sleeping between samples doesn't skew the averages.
+static uint16_t u16STEL[STEL_BUCKETS], u16TWA[TWA_BUCKETS];
+static EXPWINDOW stel, twa;
+static int iLastStatus;
+
+static void windowInit(EXPWINDOW *pWin, uint16_t *pBuckets, int iBuckets, int iSeconds)
+{
+	memset(pWin, 0, sizeof(EXPWINDOW));
+	pWin->pBuckets = pBuckets;
+	pWin->iBuckets = iBuckets;
+	pWin->iBucketSeconds = iSeconds;
+} /* windowInit() */
+
+//
+// Add iCO2 for iSeconds, closing buckets as they fill
+//
+static void windowAdd(EXPWINDOW *pWin, int iCO2, int iSeconds)
+{
+int iChunk;
+uint16_t *pBucket;
+
+	while (iSeconds > 0) {
+		iChunk = pWin->iBucketSeconds - pWin->iSeconds;
+		if (iChunk > iSeconds) iChunk = iSeconds;
+		pWin->u32Sum += (uint32_t)iCO2 * iChunk;
+		pWin->iSeconds += iChunk;
+		iSeconds -= iChunk;
+		if (pWin->iSeconds == pWin->iBucketSeconds) { // bucket is full
+			pBucket = &pWin->pBuckets[pWin->iHead];
+			if (pWin->iCount == pWin->iBuckets)
+				pWin->u32Total -= *pBucket; // oldest one leaves the window
+			else
+				pWin->iCount++;
+			*pBucket = (uint16_t)(pWin->u32Sum / pWin->iBucketSeconds);
+			pWin->u32Total += *pBucket;
+			if (++pWin->iHead == pWin->iBuckets) pWin->iHead = 0;
+			pWin->u32Sum = 0;
+			pWin->iSeconds = 0;
+		}
+	}
+} /* windowAdd() */
+
+//
+// Time weighted average over the window (or as much of it as we have)
+// The partial bucket is included, so the oldest bucket still counts
+// until the partial one replaces it.
+//
+static int windowAverage(EXPWINDOW *pWin)
+{
+uint32_t u32Seconds = (uint32_t)pWin->iCount * pWin->iBucketSeconds + pWin->iSeconds;
+
+	if (u32Seconds == 0)
+		return 0;
+	return (int)(((uint64_t)pWin->u32Total * pWin->iBucketSeconds + pWin->u32Sum) / u32Seconds);
+} /* windowAverage() */
+
+void exposureInit(void)
+{
+	windowInit(&stel, u16STEL, STEL_BUCKETS, STEL_BUCKET_SECONDS);
+	windowInit(&twa, u16TWA, TWA_BUCKETS, TWA_BUCKET_SECONDS);
+	iLastStatus = 0;
+} /* exposureInit() */
+
+//
+// Add a CO2 sample; iSeconds is the time since the previous sample
+//
+void exposureAdd(int iCO2, int iSeconds)
+{
+	windowAdd(&stel, iCO2, iSeconds);
+	windowAdd(&twa, iCO2, iSeconds);
+} /* exposureAdd() */
+
+int exposureSTEL(void)
+{
+	return windowAverage(&stel);
+} /* exposureSTEL() */
+
+int exposureTWA(void)
+{
+	return windowAverage(&twa);
+} /* exposureTWA() */
+
+int exposureStatus(void)
+{
+int i = 0;
+
+	if (exposureTWA() > EXPOSURE_TWA_LIMIT) i |= EXPOSURE_TWA;
+	if (exposureSTEL() > EXPOSURE_STEL_LIMIT) i |= EXPOSURE_STEL;
+	return i;
+} /* exposureStatus() */
+
+//
+// Returns non-zero once when a limit is first exceeded
+//
+int exposureNewAlarm(void)
+{
+int i = exposureStatus();
+int iNew = i & ~iLastStatus;
+
+	iLastStatus = i;
+	return iNew;
+} /* exposureNewAlarm() */
+#endif // USE_EXPOSURE
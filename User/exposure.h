@@ -0,0 +1,60 @@
+//
+// Time weighted CO2 exposure (8 hour TWA and 15 minute STEL)
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef USER_EXPOSURE_H_
+#define USER_EXPOSURE_H_
+
+#include "config.h"
+
+// Occupational limits for CO2 (OSHA PEL / ACGIH TLV)
+#define EXPOSURE_TWA_LIMIT 5000
+#define EXPOSURE_STEL_LIMIT 30000
+
+// Each sample is weighted by the time since the previous one, so the
+// averages are correct in any mode. The windows roll in fixed buckets
+// which each keep their mean; the bucket being filled keeps ppm*seconds.
+// STEL = 15 x 1 minute buckets, TWA = 16 x 30 minute buckets
+#define STEL_BUCKETS 15
+#define STEL_BUCKET_SECONDS 60
+#define TWA_BUCKETS 16
+#define TWA_BUCKET_SECONDS 1800
+
+// exposureStatus() flags
+#define EXPOSURE_TWA 1
+#define EXPOSURE_STEL 2
+
+typedef struct tagWindow
+{
+	uint16_t *pBuckets; // mean ppm of each completed bucket
+	int iBuckets, iBucketSeconds;
+	int iHead, iCount;
+	uint32_t u32Total; // sum of the completed bucket means
+	uint32_t u32Sum; // ppm*seconds of the bucket being filled
+	int iSeconds; // and its length so far
+} EXPWINDOW;
+
+void exposureInit(void);
+void exposureAdd(int iCO2, int iSeconds);
+int exposureSTEL(void);
+int exposureTWA(void);
+int exposureStatus(void);
+int exposureNewAlarm(void);
+
+#endif /* USER_EXPOSURE_H_ */
@@ -0,0 +1,285 @@
+//
+// Append-only sample log in spare FLASH pages
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <stdint.h>
+#include <string.h>
+#include "debug.h"
+#include "flashlog.h"
+
+#ifdef USE_FLASHLOG
+_Static_assert(sizeof(LOGPAGE) == LOG_PAGE_SIZE, "LOGPAGE must fill exactly one FLASH page");
+_Static_assert(LOG_START >= FLASH_BASE, "Log extends past the start of FLASH");
+// where the code has to end, for Ld/Link.ld
+#define STR2(x) #x
+#define STR(x) STR2(x)
+__asm__(".global __log_start\n.equ __log_start, " STR(LOG_START));
+
+static LOGPAGE page; // the page being filled
+static CODEC codec; // encoder for the page being filled
+static uint32_t u32NextSeq; // sequence number of the next page to write
+static int iPages; // number of valid pages in FLASH
+
+#define LOG_PAGE_ADDR(seq) (LOG_START + ((seq) % LOG_PAGES) * LOG_PAGE_SIZE)
+
+//
+// CRC-16/CCITT (poly 0x1021); bitwise to save FLASH space
+//
+uint16_t flashlogCRC16(const uint8_t *pData, int iLen)
+{
+uint16_t u16CRC = 0xffff;
+int i;
+
+	while (iLen--) {
+		u16CRC ^= (uint16_t)(*pData++) << 8;
+		for (i=0; i<8; i++) {
+			if (u16CRC & 0x8000)
+				u16CRC = (u16CRC << 1) ^ 0x1021;
+			else
+				u16CRC <<= 1;
+		}
+	}
+	return u16CRC;
+} /* flashlogCRC16() */
+
+//
+// Check a page in place (FLASH is memory mapped)
+//
+static int flashlogValid(const LOGPAGE *pPage)
+{
+	if (pPage->u16Count == 0 || pPage->u16Count > LOG_MAX_SAMPLES)
+		return 0;
+	return (flashlogCRC16((const uint8_t *)pPage, sizeof(LOGPAGE)-2) == pPage->u16CRC);
+} /* flashlogValid() */
+
+//
+// A page is usable if its CRC matches and it sits where its sequence
+// number says it should
+//
+static int flashlogPageOK(int iPage)
+{
+const LOGPAGE *pPage = (const LOGPAGE *)(LOG_START + iPage*LOG_PAGE_SIZE);
+
+	return flashlogValid(pPage) && (pPage->u32Seq % LOG_PAGES) == (uint32_t)iPage;
+} /* flashlogPageOK() */
+
+static void flashlogNewPage(void)
+{
+	memset(&page, 0, sizeof(page));
+	codecInit(&codec, page.u8Data, LOG_DATA_SIZE);
+} /* flashlogNewPage() */
+
+//
+// Find the newest valid page and continue the sequence after it
+// Pages are written in index order, so the FLASH holds a rotated sorted
+// list: pages 0..k-1 have sequence numbers seq0..seq0+k-1 and whatever
+// follows is either blank, the one page torn by a power loss, or older.
+// A binary search for k checks ~log2(LOG_PAGES)+3 pages instead of all of
+// them. host/bench_boot puts the worst case at the cost of 10 page checks
+// for a 1K log, 16 for 4K and 17 for 8K (about 0.4ms each at 8MHz),
+// against 16, 64 and 128 for a linear scan.
+//
+void flashlogInit(void)
+{
+int iLow, iHigh, iMid;
+uint32_t u32Seq0;
+const LOGPAGE *pPage;
+
+	flashlogNewPage();
+	if (!flashlogPageOK(0)) {
+		// either the log is empty or page 0 was torn while being
+		// rewritten, in which case the last page is the newest
+		if (flashlogPageOK(LOG_PAGES-1)) {
+			pPage = (const LOGPAGE *)(LOG_START + (LOG_PAGES-1)*LOG_PAGE_SIZE);
+			u32NextSeq = pPage->u32Seq + 1;
+			iPages = LOG_PAGES-1;
+		} else {
+			u32NextSeq = 0;
+			iPages = 0;
+		}
+		return;
+	}
+	u32Seq0 = ((const LOGPAGE *)LOG_START)->u32Seq;
+	// find the first page which doesn't continue the sequence from page 0
+	iLow = 1; iHigh = LOG_PAGES;
+	while (iLow < iHigh) {
+		iMid = (iLow + iHigh) >> 1;
+		pPage = (const LOGPAGE *)(LOG_START + iMid*LOG_PAGE_SIZE);
+		if (flashlogPageOK(iMid) && pPage->u32Seq == u32Seq0 + iMid)
+			iLow = iMid + 1;
+		else
+			iHigh = iMid;
+	}
+	u32NextSeq = u32Seq0 + iLow;
+	if (iLow == LOG_PAGES || !flashlogPageOK(LOG_PAGES-1)) {
+		iPages = iLow; // first time around (or exactly full)
+	} else { // wrapped; older pages follow, minus one if it was torn
+		iPages = LOG_PAGES - (flashlogPageOK(iLow) ? 0 : 1);
+	}
+} /* flashlogInit() */
+
+//
+// Erase the oldest page and program the buffered one in its place
+//
+static void flashlogWritePage(void)
+{
+int i;
+uint32_t u32Addr = LOG_PAGE_ADDR(u32NextSeq);
+uint32_t *s = (uint32_t *)&page;
+
+	page.u32Seq = u32NextSeq;
+	page.u16CRC = flashlogCRC16((const uint8_t *)&page, sizeof(LOGPAGE)-2);
+    FLASH_Unlock_Fast();
+    FLASH_ErasePage_Fast(u32Addr);
+    FLASH_BufReset();
+    for (i=0; i<LOG_PAGE_SIZE/4; i++) {
+	    FLASH_BufLoad(u32Addr+(4*i), s[i]);
+    }
+    FLASH_ProgramPage_Fast(u32Addr);
+    FLASH_Lock_Fast();
+    u32NextSeq++;
+    if (iPages < LOG_PAGES) iPages++;
+} /* flashlogWritePage() */
+
+void flashlogAdd(int iCO2, int iTemp, int iHumid)
+{
+int iValues[CODEC_CHANNELS];
+
+	iValues[0] = iCO2;
+	iValues[1] = iTemp;
+	iValues[2] = iHumid;
+	if (!codecEncode(&codec, iValues)) { // page is full, start a new one
+		flashlogWritePage();
+		flashlogNewPage();
+		codecEncode(&codec, iValues); // keyframe
+	}
+	page.u16Count++;
+} /* flashlogAdd() */
+
+//
+// Write the page being filled now instead of when it's full, so that a
+// power loss can't take it; the next sample starts a new page. It costs
+// a page erase, so it's only done when leaving a mode and when the
+// battery becomes critical.
+//
+void flashlogFlush(void)
+{
+	if (page.u16Count == 0)
+		return;
+	flashlogWritePage();
+	flashlogNewPage();
+} /* flashlogFlush() */
+
+int flashlogCount(void)
+{
+	return iPages;
+} /* flashlogCount() */
+
+//
+// Return a pointer directly into FLASH for the page written iAge pages ago
+// (0 = newest) or NULL if there isn't a valid one
+//
+const LOGPAGE *flashlogGetPage(int iAge)
+{
+const LOGPAGE *pPage;
+
+	if (iAge < 0 || iAge >= iPages)
+		return NULL;
+	pPage = (const LOGPAGE *)LOG_PAGE_ADDR(u32NextSeq - 1 - iAge);
+	return (flashlogValid(pPage)) ? pPage : NULL;
+} /* flashlogGetPage() */
+
+//
+// Prepare to decode the samples of a page directly from FLASH
+//
+void flashlogOpenPage(const LOGPAGE *pPage, CODEC *pCodec)
+{
+	codecInit(pCodec, (uint8_t *)pPage->u8Data, LOG_DATA_SIZE);
+} /* flashlogOpenPage() */
+
+//
+// Total number of samples in the log, including the page not yet written
+//
+int flashlogSampleCount(void)
+{
+int i, iCount = page.u16Count;
+const LOGPAGE *pPage;
+
+	for (i=0; i<iPages; i++) {
+		pPage = flashlogGetPage(i);
+		if (pPage) iCount += pPage->u16Count;
+	}
+	return iCount;
+} /* flashlogSampleCount() */
+
+//
+// Get the sample logged iAge samples ago (0 = newest); returns 0 if there
+// isn't one that old. The page is found by its count and decoded in place
+// from its keyframe.
+//
+int flashlogGetSample(int iAge, int *pValues)
+{
+int i, iCount;
+const LOGPAGE *pPage = &page; // the newest samples are still in RAM
+CODEC c;
+
+	if (iAge < 0)
+		return 0;
+	i = 0;
+	while (iAge >= pPage->u16Count) {
+		iAge -= pPage->u16Count;
+		pPage = flashlogGetPage(i++);
+		if (pPage == NULL)
+			return 0;
+	}
+	flashlogOpenPage(pPage, &c);
+	for (iCount = pPage->u16Count - iAge; iCount > 0; iCount--)
+		codecDecode(&c, pValues);
+	return 1;
+} /* flashlogGetSample() */
+
+//
+// Position a cursor before the oldest sample in the log
+//
+void flashlogRewind(LOGCURSOR *pCursor)
+{
+	pCursor->iAge = iPages;
+	pCursor->iLeft = 0;
+} /* flashlogRewind() */
+
+//
+// Read the next (newer) sample; returns 0 after the newest one
+//
+int flashlogNext(LOGCURSOR *pCursor, int *pValues)
+{
+const LOGPAGE *pPage;
+
+	while (pCursor->iLeft == 0) { // move to the next page
+		if (pCursor->iAge < 0)
+			return 0; // that was the last one
+		pCursor->iAge--;
+		pPage = (pCursor->iAge < 0) ? &page : flashlogGetPage(pCursor->iAge);
+		if (pPage) {
+			flashlogOpenPage(pPage, &pCursor->codec);
+			pCursor->iLeft = pPage->u16Count;
+		}
+	}
+	pCursor->iLeft--;
+	return codecDecode(&pCursor->codec, pValues);
+} /* flashlogNext() */
+#endif // USE_FLASHLOG
@@ -0,0 +1,88 @@
+//
+// Append-only sample log in spare FLASH pages
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef USER_FLASHLOG_H_
+#define USER_FLASHLOG_H_
+
+#include "config.h"
+#include "codec.h"
+
+// The CH32V003 can erase and fast-program FLASH in 64-byte pages.
+// The settings use the last page (0x08003fc0) and the log takes the
+// LOG_PAGES pages below it, 15 (0x08003c00) by default. Ld/Link.ld
+// stops the link if the code runs into them, so increase LOG_PAGES if
+// the code leaves more space free (the host boot benchmark gives it on
+// the command line). Without USE_FLASHLOG the code may use those pages.
+#define LOG_PAGE_SIZE 64
+#define LOG_END 0x08003fc0
+#ifndef LOG_PAGES
+#define LOG_PAGES 15
+#endif
+#define LOG_START (LOG_END - (LOG_PAGES * LOG_PAGE_SIZE))
+
+// Each page holds a batch of history blocks packed with the delta codec.
+// Every page starts with a keyframe, so any page can be decoded on its own.
+// Pages are written in sequence number order and the page index is always
+// u32Seq % LOG_PAGES, so the oldest page is the one erased next and every
+// page sees the same wear. At the 5 second continuous rate a block comes
+// every 160 seconds. A page holds at most LOG_MAX_SAMPLES (37) blocks
+// (99 minutes, so the 15 pages go round every ~25 hours); after the
+// keyframe, typical blocks take 3-4 nibbles; the rooms simulated by
+// host/sim_flashlog fit 27-30 blocks a page (~75 minutes, ~19 hours a
+// round). That erases each page ~1.3 times a day, ~20 years at 10K
+// erase cycles. Even if every value changed by 32 or more (9 nibbles a
+// block, 12 blocks a page, 8 hours a round), it's ~9 years.
+// The page being filled is only in RAM: flashlogFlush() writes it when a
+// mode is left and when the battery becomes critical. Any other power
+// loss takes up to a page of blocks (~99 minutes at the 5 second rate),
+// plus the < HISTORY_BLOCK samples not yet averaged into a block.
+#define LOG_DATA_SIZE 56
+// Every sample needs at least one nibble per channel
+#define LOG_MAX_SAMPLES ((LOG_DATA_SIZE*2)/CODEC_CHANNELS)
+
+typedef struct tagLogPage
+{
+	uint32_t u32Seq; // page sequence number
+	uint16_t u16Count; // number of samples
+	uint8_t u8Data[LOG_DATA_SIZE]; // codec data (CO2, temp*10, humidity*10)
+	uint16_t u16CRC; // CRC-16 of everything above
+} LOGPAGE;
+
+// Walks the log from oldest to newest sample without copying any pages
+typedef struct tagLogCursor
+{
+	int iAge; // age of the current page (-1 = page still in RAM)
+	int iLeft; // samples left in it
+	CODEC codec;
+} LOGCURSOR;
+
+void flashlogInit(void);
+void flashlogAdd(int iCO2, int iTemp, int iHumid);
+void flashlogFlush(void);
+int flashlogCount(void);
+const LOGPAGE *flashlogGetPage(int iAge);
+void flashlogOpenPage(const LOGPAGE *pPage, CODEC *pCodec);
+int flashlogSampleCount(void);
+int flashlogGetSample(int iAge, int *pValues);
+void flashlogRewind(LOGCURSOR *pCursor);
+int flashlogNext(LOGCURSOR *pCursor, int *pValues);
+uint16_t flashlogCRC16(const uint8_t *pData, int iLen);
+
+#endif /* USER_FLASHLOG_H_ */
@@ -0,0 +1,106 @@
+//
+// Stealth mode haptic encodings
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "alert.h"
+#include "haptic.h"
+
+static ALERTSTEP steps[HAPTIC_BITS * 2];
+static ALERTPATTERN pattern = {steps, 0, 1};
+#ifdef USE_HAPTIC
+static int iEncoding, iLastLevel, iLastCO2;
+static uint32_t u32LastFull;
+#endif
+
+void hapticInit(int iNewEncoding)
+{
+#ifdef USE_HAPTIC
+	iEncoding = iNewEncoding;
+	iLastLevel = 0; // the first report always gives the level
+	iLastCO2 = 0;
+	u32LastFull = millis();
+#else
+	(void)iNewEncoding; // it's always HAPTIC_PULSES
+#endif
+} /* hapticInit() */
+
+static void hapticAdd(int iTime)
+{
+ALERTSTEP *pStep = &steps[pattern.u8Steps];
+
+	pStep[0].u8Out = ALERT_OUT_MOTOR;
+	pStep[0].u8Time = (uint8_t)iTime;
+	pStep[1].u8Out = 0;
+	pStep[1].u8Time = HAPTIC_GAP;
+	pattern.u8Steps += 2;
+} /* hapticAdd() */
+
+//
+// Report the level in the current encoding; the pulses play while the
+// caller goes on. Returns the motor on time (ms)
+//
+int hapticReport(int iLevel, int iCO2)
+{
+#ifdef USE_HAPTIC
+int i, iRepeats = 1, iMotorMs = 0;
+int bFull = (iLastLevel == 0 || (millis() - u32LastFull) >= HAPTIC_REMIND_MS);
+
+	pattern.u8Steps = 0;
+	if (iEncoding == HAPTIC_CHANGE && iLevel != iLastLevel)
+		bFull = 1;
+	if (iEncoding == HAPTIC_PULSES || iEncoding == HAPTIC_BINARY)
+		bFull = 1;
+	if (bFull) {
+		if (iEncoding == HAPTIC_BINARY) {
+			for (i=HAPTIC_BITS-1; i>=0; i--)
+				hapticAdd((iLevel & (1 << i)) ? HAPTIC_LONG : HAPTIC_SHORT);
+		} else {
+			hapticAdd(HAPTIC_PULSE);
+			iRepeats = iLevel;
+		}
+		u32LastFull = millis();
+		iLastLevel = iLevel;
+		iLastCO2 = iCO2;
+	} else if (iEncoding == HAPTIC_TREND) {
+		// a slow drift adds up until it's reported
+		if (iCO2 - iLastCO2 >= HAPTIC_TREND_PPM)
+			hapticAdd(HAPTIC_LONG);
+		else if (iLastCO2 - iCO2 >= HAPTIC_TREND_PPM)
+			hapticAdd(HAPTIC_SHORT);
+		if (pattern.u8Steps)
+			iLastCO2 = iCO2;
+		iLastLevel = iLevel;
+	}
+	if (pattern.u8Steps == 0) // nothing to say
+		return 0;
+	for (i=0; i<pattern.u8Steps; i+=2)
+		iMotorMs += steps[i].u8Time * ALERT_TIME_MS;
+	alertStart(&pattern, iRepeats);
+	return iMotorMs * iRepeats;
+#else
+	(void)iCO2;
+	pattern.u8Steps = 0;
+	hapticAdd(HAPTIC_PULSE);
+	alertStart(&pattern, iLevel);
+	return HAPTIC_PULSE * ALERT_TIME_MS * iLevel;
+#endif // USE_HAPTIC
+} /* hapticReport() */
@@ -0,0 +1,64 @@
+//
+// Stealth mode haptic encodings
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_HAPTIC_H_
+#define USER_HAPTIC_H_
+
+#include "config.h"
+
+// Stealth mode reports the CO2 level (1-6) with the motor, which draws
+// more current than anything else on the board. The original encoding
+// gives N pulses, so a bad room costs the most. The others (only built
+// in with USE_HAPTIC):
+// BINARY - always 3 pulses, short = 0 / long = 1, MSB first
+// CHANGE - the pulses, but only when the level changed (or every
+//          HAPTIC_REMIND_MS so that it's clear it's still running)
+// TREND  - one long pulse if the CO2 went up by HAPTIC_TREND_PPM since
+//          the last report, one short one if it went down, nothing if
+//          it's steady; the level itself is given every HAPTIC_REMIND_MS
+// With a report every 30 seconds, host/sim_sched (a day, make sim) has
+// the motor running 20.0-28.5 seconds an hour with PULSES, 31.0-32.7
+// with BINARY (its 3 pulses are longer than the 1-2 of a good room) and
+// 0.7-1.3 with CHANGE or TREND. That is 334-544uAh an hour for PULSES
+// and BINARY and 12-21uAh for the others, against ~15mA for the rest
+// of the board.
+enum
+{
+	HAPTIC_PULSES=0,
+	HAPTIC_BINARY,
+	HAPTIC_CHANGE,
+	HAPTIC_TREND,
+	HAPTIC_COUNT
+};
+
+// Pulse lengths (units of ALERT_TIME_MS); the motor needs ~50ms to spin up
+#define HAPTIC_PULSE 10
+#define HAPTIC_SHORT 5
+#define HAPTIC_LONG 15
+#define HAPTIC_GAP 40
+#define HAPTIC_BITS 3
+#define HAPTIC_REMIND_MS 900000
+#define HAPTIC_TREND_PPM 100
+
+void hapticInit(int iEncoding);
+int hapticReport(int iLevel, int iCO2);
+
+#endif /* USER_HAPTIC_H_ */
@@ -0,0 +1,318 @@
+//
+// CO2 / temperature / humidity history
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <stdint.h>
+#include <string.h>
+#include "history.h"
+#include "codec.h"
+#include "flashlog.h"
+#include "stats.h"
+
+#ifdef USE_HISTORY
+
+#define STR2(x) #x
+#define STR(x) STR2(x)
+
+// bucket being filled for one tier, in tier units (at most 60 * 255)
+typedef struct tagTierAcc
+{
+	uint16_t u16Sum;
+	uint8_t u8Count;
+	uint8_t u8Min, u8Max;
+} TIERACC;
+
+typedef struct tagHistory
+{
+	TIERPOINT points[TIER_POINTS]; // circular list for each tier
+	uint8_t u8Head[TIER_COUNT]; // next point to write
+	uint8_t u8Count[TIER_COUNT]; // number of valid points
+	uint8_t u8Seconds; // time in the current 1 minute bucket
+#ifdef USE_FLASHLOG
+	uint8_t u8BlockCount;
+#endif
+	TIERACC acc[TIER_COUNT];
+#ifdef USE_FLASHLOG
+	uint32_t u32BlockSum; // full resolution sums of the current block
+	int32_t i32TempSum, i32HumidSum;
+#endif
+	int iSamples; // total samples since startup
+	uint32_t u32Seconds; // and the time they cover
+	int32_t i32StatCount; // samples in the stats sums
+	STAT stats[STAT_COUNT];
+} HISTORY;
+
+static HISTORY hist;
+static const uint8_t u8TierStart[TIER_COUNT] = {0, TIER_0_POINTS, TIER_0_POINTS+TIER_1_POINTS};
+static const uint8_t u8TierSize[TIER_COUNT] = {TIER_0_POINTS, TIER_1_POINTS, TIER_2_POINTS};
+static const uint8_t u8TierSpan[TIER_COUNT] = {0, TIER_1_SPAN, TIER_2_SPAN};
+
+// Report the footprint at build time and refuse to build if it won't fit
+// (the 216 tier points are 648 bytes of it)
+#ifdef USE_FLASHLOG
+#define HISTORY_BYTES 736
+#else
+#define HISTORY_BYTES 724
+#endif
+#pragma message ("History RAM: sizeof(HISTORY) = " STR(HISTORY_BYTES) " bytes")
+_Static_assert(sizeof(HISTORY) == HISTORY_BYTES, "HISTORY changed size, update HISTORY_BYTES");
+_Static_assert(sizeof(HISTORY) <= HISTORY_RAM_LIMIT, "History does not fit in RAM");
+
+static void statInit(STAT *pStat)
+{
+	pStat->iMin = 0x7fffffff;
+	pStat->iMax = -0x7fffffff;
+	pStat->i32Sum = 0;
+} /* statInit() */
+
+static void statAdd(STAT *pStat, int iVal)
+{
+	// min and max are independent; the first sample sets both
+	if (iVal < pStat->iMin) pStat->iMin = iVal;
+	if (iVal > pStat->iMax) pStat->iMax = iVal;
+	pStat->i32Sum += iVal;
+} /* statAdd() */
+
+static void accReset(TIERACC *pAcc)
+{
+	pAcc->u16Sum = 0;
+	pAcc->u8Count = 0;
+	pAcc->u8Min = 0xff;
+	pAcc->u8Max = 0;
+} /* accReset() */
+
+static void accAdd(TIERACC *pAcc, int iMin, int iMax, int iMean)
+{
+	if (iMin < pAcc->u8Min) pAcc->u8Min = (uint8_t)iMin;
+	if (iMax > pAcc->u8Max) pAcc->u8Max = (uint8_t)iMax;
+	pAcc->u16Sum += iMean;
+	pAcc->u8Count++;
+} /* accAdd() */
+
+void historyInit(void)
+{
+int i;
+
+	memset(&hist, 0, sizeof(hist));
+	for (i=0; i<STAT_COUNT; i++)
+		statInit(&hist.stats[i]);
+	for (i=0; i<TIER_COUNT; i++)
+		accReset(&hist.acc[i]);
+#ifdef USE_STATS
+	statsInit();
+#endif
+} /* historyInit() */
+
+static int co2ToTier(uint32_t u32)
+{
+	u32 = (u32 + (1 << (HISTORY_CO2_SHIFT-1))) >> HISTORY_CO2_SHIFT;
+	return (u32 > 255) ? 255 : (int)u32; // saturate
+} /* co2ToTier() */
+
+//
+// Close the current bucket of a tier; store it and pass it up to the next
+//
+static void historyCloseBucket(int iTier)
+{
+TIERACC *pAcc = &hist.acc[iTier];
+TIERPOINT *pPoint;
+
+	if (pAcc->u8Count == 0) // nothing was collected
+		return;
+	pPoint = &hist.points[u8TierStart[iTier] + hist.u8Head[iTier]];
+	pPoint->u8Min = pAcc->u8Min;
+	pPoint->u8Max = pAcc->u8Max;
+	// buckets of the tiers below all cover the same time, so their mean
+	// is the mean over this bucket
+	pPoint->u8Mean = (uint8_t)((pAcc->u16Sum + (pAcc->u8Count >> 1)) / pAcc->u8Count);
+	if (++hist.u8Head[iTier] >= u8TierSize[iTier]) hist.u8Head[iTier] = 0; // wrap
+	if (hist.u8Count[iTier] < u8TierSize[iTier]) hist.u8Count[iTier]++;
+	accReset(pAcc);
+	if (iTier < TIER_COUNT-1) { // roll it up into the next tier
+		pAcc = &hist.acc[iTier+1];
+		accAdd(pAcc, pPoint->u8Min, pPoint->u8Max, pPoint->u8Mean);
+		if (pAcc->u8Count == u8TierSpan[iTier+1])
+			historyCloseBucket(iTier+1);
+	}
+} /* historyCloseBucket() */
+
+//
+// Add a sample to the collected statistics
+// iSeconds is the time since the previous sample
+// Every HISTORY_BLOCK samples, the full resolution averages are written
+// to the FLASH log
+//
+void historyAddSample(int iCO2, int iTemp, int iHumid, int iSeconds)
+{
+int i, iChunk, iTier;
+
+	statAdd(&hist.stats[STAT_CO2], iCO2);
+	statAdd(&hist.stats[STAT_TEMP], iTemp);
+	statAdd(&hist.stats[STAT_HUMID], iHumid);
+	if (++hist.i32StatCount >= STAT_MAX_COUNT) { // keep the means, lose some weight
+		for (i=0; i<STAT_COUNT; i++)
+			hist.stats[i].i32Sum >>= 1;
+		hist.i32StatCount >>= 1;
+	}
+#ifdef USE_STATS
+	statsAdd(iCO2); // mean/variance/percentiles
+#endif
+	hist.iSamples++;
+	hist.u32Seconds += iSeconds;
+	// the sample stands for the whole time since the previous one, so a
+	// long interval fills (and closes) a 1 minute bucket for each minute
+	iTier = co2ToTier(iCO2);
+	while (iSeconds > 0) {
+		iChunk = TIER_0_SECONDS - hist.u8Seconds;
+		if (iChunk > iSeconds) iChunk = iSeconds;
+		accAdd(&hist.acc[TIER_1MIN], iTier, iTier, iTier);
+		hist.u8Seconds += iChunk;
+		iSeconds -= iChunk;
+		if (hist.u8Seconds == TIER_0_SECONDS) { // bucket is full
+			historyCloseBucket(TIER_1MIN);
+			hist.u8Seconds = 0;
+		}
+	}
+#ifdef USE_FLASHLOG
+	hist.u32BlockSum += iCO2;
+	hist.i32TempSum += iTemp;
+	hist.i32HumidSum += iHumid;
+	if (++hist.u8BlockCount == HISTORY_BLOCK) {
+		// average all 32 samples with rounding
+		flashlogAdd((int)((hist.u32BlockSum + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT),
+				(hist.i32TempSum + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT,
+				(hist.i32HumidSum + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT);
+		hist.u32BlockSum = 0;
+		hist.i32TempSum = hist.i32HumidSum = 0;
+		hist.u8BlockCount = 0;
+	}
+#endif // USE_FLASHLOG
+} /* historyAddSample() */
+
+//
+// Number of CO2 values available to historyGetCO2(); the full resolution
+// block averages in the FLASH log or else the 1 minute tier
+//
+int historyCount(void)
+{
+#ifdef USE_FLASHLOG
+	return flashlogSampleCount();
+#else
+	return hist.u8Count[TIER_1MIN];
+#endif
+} /* historyCount() */
+
+int historySamples(void)
+{
+	return hist.iSamples;
+} /* historySamples() */
+
+uint32_t historySeconds(void)
+{
+	return hist.u32Seconds;
+} /* historySeconds() */
+
+#ifdef USE_FLASHLOG
+//
+// Get the CO2, temperature and humidity block averages from iAge
+// entries ago (0 = most recent); returns 0 if there isn't one that old
+//
+int historyGetSample(int iAge, int *pValues)
+{
+	return flashlogGetSample(iAge, pValues);
+} /* historyGetSample() */
+
+#endif // USE_FLASHLOG
+
+//
+// Return the CO2 level (ppm) of the block average (or 1 minute mean
+// without the FLASH log) iAge entries ago (0 = most recent) or -1 if
+// there isn't one that old
+//
+int historyGetCO2(int iAge)
+{
+#ifdef USE_FLASHLOG
+int iValues[CODEC_CHANNELS];
+
+	if (!historyGetSample(iAge, iValues))
+		return -1;
+	return iValues[0];
+#else
+TIERPOINT pt;
+
+	if (!historyGetPoint(TIER_1MIN, iAge, &pt))
+		return -1;
+	return pt.u8Mean << HISTORY_CO2_SHIFT;
+#endif
+} /* historyGetCO2() */
+
+//
+// Pick the finest tier which covers a time window
+// 1 hour or less = 1 minute buckets (<= 60 points)
+// up to 12 hours = 10 minute buckets (<= 72 points)
+// longer = 2 hour buckets (<= 84 points for 7 days)
+//
+int historyGetTier(int iMinutes)
+{
+	if (iMinutes <= TIER_0_POINTS)
+		return TIER_1MIN;
+	if (iMinutes <= TIER_1_POINTS*TIER_1_SPAN)
+		return TIER_10MIN;
+	return TIER_2HOUR;
+} /* historyGetTier() */
+
+int historyTierCount(int iTier)
+{
+	return hist.u8Count[iTier];
+} /* historyTierCount() */
+
+//
+// Get the tier point iAge buckets ago (0 = most recent closed bucket)
+// returns 0 if there isn't one that old
+//
+int historyGetPoint(int iTier, int iAge, TIERPOINT *pPoint)
+{
+int i;
+
+	if (iAge < 0 || iAge >= hist.u8Count[iTier])
+		return 0;
+	i = hist.u8Head[iTier] - 1 - iAge;
+	if (i < 0) i += u8TierSize[iTier];
+	*pPoint = hist.points[u8TierStart[iTier] + i];
+	return 1;
+} /* historyGetPoint() */
+
+int historyGetMin(int iStat)
+{
+	return (hist.i32StatCount) ? hist.stats[iStat].iMin : 0;
+} /* historyGetMin() */
+
+int historyGetMax(int iStat)
+{
+	return (hist.i32StatCount) ? hist.stats[iStat].iMax : 0;
+} /* historyGetMax() */
+
+int historyGetMean(int iStat)
+{
+STAT *pStat = &hist.stats[iStat];
+
+	if (hist.i32StatCount == 0)
+		return 0;
+	return (int)(pStat->i32Sum / hist.i32StatCount);
+} /* historyGetMean() */
+#endif // USE_HISTORY
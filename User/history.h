@@ -0,0 +1,100 @@
+//
+// CO2 / temperature / humidity history
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef USER_HISTORY_H_
+#define USER_HISTORY_H_
+
+#include "config.h"
+
+// The full resolution history is the average of HISTORY_BLOCK samples
+// (160 seconds at the 5 second continuous rate) kept in the FLASH log
+#define HISTORY_BLOCK 32
+#define HISTORY_BLOCK_SHIFT 5
+
+// For graphs, CO2 is also rolled up into 3 tiers of min/max/mean buckets.
+// Each tier closes a bucket after TIER_n_SPAN buckets of the tier below,
+// so the higher tiers are built incrementally and never recomputed.
+// Tier points store CO2 in 8 bits with 16ppm resolution (0-4080ppm), so
+// the 216 of them take 648 bytes of RAM.
+enum
+{
+	TIER_1MIN=0,
+	TIER_10MIN,
+	TIER_2HOUR,
+	TIER_COUNT
+};
+#define TIER_0_SECONDS 60
+#define TIER_1_SPAN 10
+#define TIER_2_SPAN 12
+// 1 hour of minutes, 12 hours of 10 minutes and 7 days of 2 hours
+#define TIER_0_POINTS 60
+#define TIER_1_POINTS 72
+#define TIER_2_POINTS 84
+#define TIER_POINTS (TIER_0_POINTS + TIER_1_POINTS + TIER_2_POINTS)
+#define HISTORY_CO2_SHIFT 4
+// Most of the 2K of RAM is spoken for by the stack, OLED cache and
+// sensor variables; the history must fit in what's left
+#define HISTORY_RAM_LIMIT 768
+// The running sums are halved when the count reaches this value so
+// that 40000ppm samples can't overflow 32 bits
+#define STAT_MAX_COUNT 32768
+
+typedef struct tagTierPoint
+{
+	uint8_t u8Min, u8Max, u8Mean; // CO2 >> HISTORY_CO2_SHIFT
+} TIERPOINT;
+
+// min/max/mean tracker; the sample count is shared by all of them
+typedef struct tagStat
+{
+	int iMin, iMax;
+	int32_t i32Sum; // running sum for the mean
+} STAT;
+
+enum
+{
+	STAT_CO2=0,
+	STAT_TEMP,
+	STAT_HUMID,
+	STAT_COUNT
+};
+
+#ifdef USE_HISTORY
+void historyInit(void);
+void historyAddSample(int iCO2, int iTemp, int iHumid, int iSeconds);
+#else
+#define historyInit()
+#define historyAddSample(c, t, h, s) // only the current values are shown
+#endif
+int historySamples(void);
+uint32_t historySeconds(void);
+int historyGetTier(int iMinutes);
+int historyTierCount(int iTier);
+int historyGetPoint(int iTier, int iAge, TIERPOINT *pPoint);
+int historyCount(void);
+int historyGetCO2(int iAge);
+#ifdef USE_FLASHLOG
+int historyGetSample(int iAge, int *pValues);
+#endif
+int historyGetMin(int iStat);
+int historyGetMax(int iStat);
+int historyGetMean(int iStat);
+
+#endif /* USER_HISTORY_H_ */
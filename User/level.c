@@ -0,0 +1,102 @@
+//
+// CO2 level classifier with hysteresis
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "level.h"
+
+static int iThresholds[LEVEL_THRESHOLDS], iHystPPM;
+static int iLevel = -1; // not known yet
+
+void levelDefaults(int *pThresholds, int *pHyst)
+{
+int i;
+
+	for (i=0; i<LEVEL_THRESHOLDS; i++)
+		pThresholds[i] = (i+1) * LEVEL_DEFAULT_PPM;
+	*pHyst = LEVEL_HYST_PPM;
+} /* levelDefaults() */
+
+//
+// Check settings read from FLASH; the thresholds must go up by more
+// than the band so that each level can be left again
+//
+int levelValid(const int *pThresholds, int iHyst)
+{
+int i, iLast = 0;
+
+	if (iHyst < 0 || iHyst > LEVEL_MAX_HYST_PPM)
+		return 0;
+	for (i=0; i<LEVEL_THRESHOLDS; i++) {
+		if (pThresholds[i] <= iLast + iHyst || pThresholds[i] > LEVEL_MAX_PPM)
+			return 0;
+		iLast = pThresholds[i];
+	}
+	return 1;
+} /* levelValid() */
+
+void levelInit(const int *pThresholds, int iHyst)
+{
+int i;
+
+	for (i=0; i<LEVEL_THRESHOLDS; i++)
+		iThresholds[i] = pThresholds[i];
+	iHystPPM = iHyst;
+	iLevel = -1;
+} /* levelInit() */
+
+//
+// The level of a single reading, without the hysteresis
+//
+int levelClassify(int iCO2)
+{
+int i;
+
+	for (i=0; i<LEVEL_THRESHOLDS && iCO2 >= iThresholds[i]; i++) {};
+	return i;
+} /* levelClassify() */
+
+//
+// Add a reading; returns 1 if the level went up, -1 if it went down
+// and 0 if it stayed the same (the first reading just sets it)
+//
+int levelUpdate(int iCO2)
+{
+int iOld = iLevel;
+
+	if (iLevel < 0) {
+		iLevel = levelClassify(iCO2);
+		return 0;
+	}
+	while (iLevel < LEVEL_THRESHOLDS && iCO2 >= iThresholds[iLevel])
+		iLevel++;
+	while (iLevel > 0 && iCO2 < iThresholds[iLevel-1] - iHystPPM)
+		iLevel--;
+	if (iLevel == iOld)
+		return 0;
+	return (iLevel > iOld) ? 1 : -1;
+} /* levelUpdate() */
+
+//
+// Current level (0 - LEVEL_COUNT-1) or -1 before the first reading
+//
+int levelGet(void)
+{
+	return iLevel;
+} /* levelGet() */
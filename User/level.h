@@ -0,0 +1,47 @@
+//
+// CO2 level classifier with hysteresis
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_LEVEL_H_
+#define USER_LEVEL_H_
+
+// The CO2 reading is sorted into levels (0-5) which the emoji, the
+// stealth pulses and the level alert share. Going up a level needs the
+// reading to reach the threshold; going back down needs it to fall
+// LEVEL_HYST_PPM below it, so a reading which hovers on a threshold
+// doesn't flip the level on every sample. The thresholds and the band
+// are kept with the settings in FLASH.
+#define LEVEL_THRESHOLDS 5
+#define LEVEL_COUNT (LEVEL_THRESHOLDS + 1)
+#define LEVEL_DEFAULT_PPM 500 // thresholds at 500, 1000 ... 2500
+#define LEVEL_HYST_PPM 50
+#define LEVEL_MAX_HYST_PPM 250
+#define LEVEL_MAX_PPM 40000 // SCD4x range
+// Rising into this level or higher plays an alert (1500ppm)
+#define LEVEL_ALERT 3
+
+void levelDefaults(int *pThresholds, int *pHyst);
+int levelValid(const int *pThresholds, int iHyst);
+void levelInit(const int *pThresholds, int iHyst);
+int levelClassify(int iCO2);
+int levelUpdate(int iCO2);
+int levelGet(void);
+
+#endif /* USER_LEVEL_H_ */
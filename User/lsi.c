@@ -0,0 +1,131 @@
+//
+// LSI calibration
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "lsi.h"
+#include "pwm.h"
+
+#ifdef USE_LSI_CAL
+static uint32_t u32LSIHz = LSI_NOMINAL_HZ;
+static uint32_t u32LastCal;
+static int bCalibrated;
+
+//
+// Wait for the next capture; returns 0 if the LSI edge didn't come
+// before the deadline
+//
+static int lsiWaitCapture(uint32_t u32Start)
+{
+	while (TIM_GetFlagStatus(TIM1, TIM_FLAG_CC1) == RESET) {
+		if ((micros() - u32Start) > LSI_CAL_TIMEOUT_US)
+			return 0;
+	}
+	return 1;
+} /* lsiWaitCapture() */
+
+//
+// Measure the LSI frequency against HCLK and pass it on to the
+// standby code. Takes ~4ms; TIM1 is reset afterwards, so it must not
+// be used for PWM at the time. If the LSI doesn't start or an edge
+// is missed, the last good frequency (at first the nominal one) stays.
+// Returns non-zero if the measurement was good.
+//
+int lsiCalibrate(void)
+{
+TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure = {0};
+TIM_ICInitTypeDef TIM_ICInitStructure = {0};
+uint32_t u32Counts = 0, u32Hz, u32Start = micros();
+uint16_t u16Last, u16Now;
+int i;
+
+	if (pwmActive()) // TIM1 is busy with the LEDs
+		return 0;
+	RCC_LSICmd(ENABLE);
+	while (RCC_GetFlagStatus(RCC_FLAG_LSIRDY) == RESET) {
+		if ((micros() - u32Start) > LSI_CAL_TIMEOUT_US)
+			return 0;
+	}
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO | RCC_APB2Periph_TIM1, ENABLE);
+	GPIO_PinRemapConfig(GPIO_Remap_LSI_CAL, ENABLE); // LSI -> TIM1 CH1
+
+	TIM_TimeBaseStructure.TIM_Period = 0xffff;
+	TIM_TimeBaseStructure.TIM_Prescaler = 0; // count HCLK
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM1, &TIM_TimeBaseStructure);
+	TIM_ICInitStructure.TIM_Channel = TIM_Channel_1;
+	TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+	TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+	TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV8;
+	TIM_ICInit(TIM1, &TIM_ICInitStructure);
+	TIM_Cmd(TIM1, ENABLE);
+
+	// the first capture is the starting point; the 16-bit differences
+	// are fine since 8 LSI clocks are far fewer than 65536 HCLKs
+	u32Start = micros();
+	TIM_ClearFlag(TIM1, TIM_FLAG_CC1);
+	i = -1;
+	if (lsiWaitCapture(u32Start)) {
+		u16Last = TIM_GetCapture1(TIM1);
+		for (i=0; i<LSI_CAL_CAPTURES; i++) {
+			if (!lsiWaitCapture(u32Start))
+				break;
+			u16Now = TIM_GetCapture1(TIM1); // clears the flag
+			u32Counts += (uint16_t)(u16Now - u16Last);
+			u16Last = u16Now;
+		}
+	}
+
+	TIM_Cmd(TIM1, DISABLE);
+	GPIO_PinRemapConfig(GPIO_Remap_LSI_CAL, DISABLE);
+	RCC_APB2PeriphResetCmd(RCC_APB2Periph_TIM1, ENABLE);
+	RCC_APB2PeriphResetCmd(RCC_APB2Periph_TIM1, DISABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, DISABLE);
+
+	if (i != LSI_CAL_CAPTURES || u32Counts == 0)
+		return 0; // timed out
+	u32Hz = (uint32_t)(((uint64_t)SystemCoreClock * (LSI_CAL_CAPTURES * 8)) / u32Counts);
+	if (u32Hz < LSI_MIN_HZ || u32Hz > LSI_MAX_HZ)
+		return 0; // something went wrong; keep the last good one
+	u32LSIHz = u32Hz;
+	StandbySetLSI(u32LSIHz);
+	return 1;
+} /* lsiCalibrate() */
+
+//
+// Calibrate if it's never been done or it's been LSI_CAL_MS
+//
+void lsiUpdate(void)
+{
+uint32_t u32Now = millis();
+
+	if (bCalibrated && (u32Now - u32LastCal) < LSI_CAL_MS)
+		return;
+	bCalibrated = 1;
+	u32LastCal = u32Now;
+	lsiCalibrate();
+} /* lsiUpdate() */
+
+uint32_t lsiFrequency(void)
+{
+	return u32LSIHz;
+} /* lsiFrequency() */
+#endif // USE_LSI_CAL
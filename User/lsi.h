@@ -0,0 +1,55 @@
+//
+// LSI calibration
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_LSI_H_
+#define USER_LSI_H_
+
+#include "config.h"
+
+// The AWU (standby) timing comes from the LSI RC oscillator, which is
+// only good to several percent and drifts with temperature. With the
+// LSI_CAL remap, the LSI drives the TIM1 CH1 input, so its period can be
+// measured against the HSI (trimmed to ~1%) by capturing every 8th LSI
+// edge with TIM1 counting HCLK. The measured frequency sets the standby
+// time accounting and the prescaler choice in StandbyFor(). TIM1 also
+// drives the LEDs, so it's only done while no PWM output is on.
+// On the host (host/sim_lsi), an LSI 8% off makes the clock lose or gain
+// ~2 hours a day; calibrated, it's off by the HSI error alone (+/-1% is
+// ~14 minutes a day), even with the LSI swinging 3% with the temperature.
+#define LSI_NOMINAL_HZ 124878 // gives the 82ms AWU tick at /10240
+#define LSI_CAL_CAPTURES 64 // x8 edges = ~4ms at 128KHz
+#define LSI_CAL_MS 900000 // calibrate again every 15 minutes
+// Give up if the LSI doesn't start or the edges stop for this long
+// (the captures take ~5ms at LSI_MIN_HZ)
+#define LSI_CAL_TIMEOUT_US 10000
+// Results outside of this range are taken to be bad
+#define LSI_MIN_HZ 100000
+#define LSI_MAX_HZ 150000
+
+#ifdef USE_LSI_CAL
+int lsiCalibrate(void);
+void lsiUpdate(void);
+uint32_t lsiFrequency(void);
+#else
+#define lsiUpdate() // the standby timing uses LSI_NOMINAL_HZ
+#endif // USE_LSI_CAL
+
+#endif /* USER_LSI_H_ */
@@ -20,26 +20,48 @@
 #include <stdint.h>
 #include <string.h>
 #include "debug.h"
+#include "config.h"
 #include "scd41.h"
 #include "Arduino.h"
 #include "oled.h"
 #include "Roboto_Black_40.h"
+#ifdef USE_LABEL_FONT
 #include "Roboto_Black_13.h"
+#endif
 #include "co2_emojis.h"
+#include "history.h"
+#include "flashlog.h"
+#include "stats.h"
+#include "exposure.h"
+#include "sched.h"
+#include "profile.h"
+#include "buttons.h"
+#include "power.h"
+#include "battery.h"
+#include "adapt.h"
+#include "clock.h"
+#include "pwm.h"
+#include "alert.h"
+#include "haptic.h"
+#include "level.h"
 
-// end of 16k FLASH is at 0x08004000
-#define FLASH_START 0x08003c00
+// the last page of the 16k FLASH (the FLASH log is below it)
+#define FLASH_START 0x08003fc0
 
 #define DC_PIN 0xd3
 #define CS_PIN 0xd2
 #define RST_PIN 0xd4
-#define BUTTON0_PIN 0xd2
-#define BUTTON1_PIN 0xd3
-#define LED_GREEN 0xc3
-#define LED_RED 0xc4
-#define MOTOR_PIN 0xc5
 
-#define DEBUG_MODE
+// Standby disconnects the debugger, so only busy-wait in debug mode
+#ifdef DEBUG_MODE
+#define SCHED_STANDBY 0
+#else
+#define SCHED_STANDBY 1
+#endif
+// A second button pressed this soon after the first counts as both
+#define BUTTON_BOTH_MS 60
+// WaitButton() return value for a button held down
+#define BUTTONS_LONG 4
 
 typedef struct tagState
 {
@@ -47,6 +69,9 @@ typedef struct tagState
 	int iAlert;
 	int iFreq;
 	int iPeriod;
+	int iHaptic; // stealth mode encoding
+	int iThresholds[LEVEL_THRESHOLDS]; // CO2 level boundaries (ppm)
+	int iHyst; // and how far below one the level drops back
 } STATE;
 
 enum
@@ -54,49 +79,79 @@ enum
 	MODE_CONTINUOUS=0,
 	MODE_LOW_POWER,
 //	MODE_ON_DEMAND,
+#ifdef USE_STEALTH
 	MODE_STEALTH,
+#endif
+#ifdef USE_CALIBRATE
 	MODE_CALIBRATE,
+#endif
+#ifdef USE_TIMER
 	MODE_TIMER,
+#endif
 	MODE_COUNT
 };
-
-enum
-{
-	ALERT_VIBRATION=0,
-	ALERT_LED,
-	ALERT_BOTH,
-	ALERT_COUNT
-};
+// the modes left out never match state.iMode
+#ifndef USE_STEALTH
+#define MODE_STEALTH -1
+#endif
+#ifndef USE_CALIBRATE
+#define MODE_CALIBRATE -1
+#endif
 
 enum
 {
 	MENU_START=0,
 	MENU_MODE,
+#ifdef USE_STEALTH
 	MENU_FREQ,
+#endif
 	MENU_ALERT,
+#ifdef USE_HAPTIC
+	MENU_HAPTIC,
+#endif
+#ifdef USE_TIMER
 	MENU_TIME,
+#endif
 	MENU_COUNT
 };
 
-int GetButtons(void);
-void ShowAlert(void);
+int ButtonPress(void);
+int WaitButton(void);
+void I2CWake(int iSpeed);
 void ShowTime(int iSecs);
+void TimeString(char *szTemp, int iSecs);
 void BlinkLED(uint8_t u8LED, int iDuration);
 
-const char *szMode[] = {"Continuous", "Low Power ", /*"On Demand ", */ "Stealth   ", "Calibrate ", "Timer     "};
+// in MODE_* order
+const char *szMode[] = {"Continuous", "Low Power ", /*"On Demand ", */
+#ifdef USE_STEALTH
+	"Stealth   ",
+#endif
+#ifdef USE_CALIBRATE
+	"Calibrate ",
+#endif
+#ifdef USE_TIMER
+	"Timer     ",
+#endif
+	};
+_Static_assert(sizeof(szMode)/sizeof(szMode[0]) == MODE_COUNT, "a mode without a name");
 const char *szAlert[] = {"Vibration", "LEDs     ", "Vib+LEDs "};
+#ifdef USE_HAPTIC
+const char *szHaptic[] = {"Pulses", "Binary", "Change", "Trend "};
+#endif
+#ifdef USE_HISTORY
+const char *szGraph[] = {"1 hour", "12 hours", "7 days", "Log"};
+// ShowGraph() pages: the tiers and then the FLASH log
+#ifdef USE_FLASHLOG
+#define GRAPH_COUNT (TIER_COUNT + 1)
+#else
+#define GRAPH_COUNT TIER_COUNT
+#endif
+const int iGraphMinutes[] = {60, 12*60, 7*24*60};
+#endif // USE_HISTORY
 STATE state;
 
 static int iSample = 0; // number of CO2 samples captured
-#ifdef FUTURE
-#define MAX_SAMPLES 540
-static uint8_t ucLast32[32]; // holds top 8 bits of last 32 samples
-static uint8_t ucSamples[MAX_SAMPLES]; // 24h worth of samples (80 seconds each)
-static int iHead = 0, iTail = 0; // circular list of samples
-static int iMaxCO2 = 0, iMinCO2 = 5000;
-static int iMaxTemp = 0, iMinTemp = 1000;
-static uint8_t ucMaxHumid = 0, ucMinHumid = 100;
-#endif // FUTURE
 
 // Convert a number into a zero-terminated string
 int i2str(char *pDest, int iVal)
@@ -104,6 +159,7 @@ int i2str(char *pDest, int iVal)
 	char *d = pDest;
 	int i, iPlaceVal = 10000;
 	int iDigits = 0;
+	PROFILE_BEGIN(PROF_I2STR);
 
 	if (iVal < 0) {
 		iDigits++;
@@ -124,6 +180,7 @@ int i2str(char *pDest, int iVal)
 	if (d == pDest) // must be zero
 		*d++ = '0';
 	*d++ = 0; // terminator
+	PROFILE_END(PROF_I2STR);
 	return (int)(d - pDest - 1); // string length
 } /* i2str() */
 
@@ -150,62 +207,61 @@ uint32_t *d = (uint32_t *)&state;
 	for (i=0; i<sizeof(state)/4; i++) {
 		d[i] = *(uint32_t *)(FLASH_START + (4 * i));
 	}
-	if (state.iPeriod < 5 || state.iPeriod > 60) {
-	// Data is not valid, set default values
+	if (state.iPeriod < 5 || state.iPeriod > 60 || state.iMode < 0 || (unsigned)state.iAlert > 2) {
+	// Data is not valid (or a FLASH log page, which used to be here), set default values
         state.iMode = MODE_CONTINUOUS;
         state.iAlert = 0; // vibration only
         state.iFreq = 30; // stealth mode update time (30 seconds)
         state.iPeriod = 5; // wake up period in minutes
+        state.iHaptic = HAPTIC_PULSES;
         WriteFlash(); // write the default values in FLASH
 	}
+	if (state.iMode >= MODE_COUNT) // saved by a build with more modes
+		state.iMode = MODE_CONTINUOUS;
+	if (state.iHaptic < 0 || state.iHaptic >= HAPTIC_COUNT) // saved by an older version
+		state.iHaptic = HAPTIC_PULSES;
+	if (!levelValid(state.iThresholds, state.iHyst))
+		levelDefaults(state.iThresholds, &state.iHyst);
 } /* ReadFlash() */
 
-#ifdef FUTURE
 //
-// Add a sample to the collected statistics
-//
-void AddSample(int i)
-{
-	if (_iCO2 > iMaxCO2) iMaxCO2 = _iCO2;
-	if (_iCO2 < iMinCO2) iMinCO2 = _iCO2;
-	ucLast32[i & 31] = (uint8_t)(_iCO2>>5); // keep top 8 bits
-	if ((i & 31) == 0) {
-		int iAvg = 0;
-		// take average and store it
-		for (int j=0; j<31; j++)
-			iAvg += ucLast32[j];
-		ucSamples[iHead++] = (uint8_t)(iAvg>>5);
-		if (iHead >= MAX_SAMPLES) iHead -= MAX_SAMPLES; // wrap
-	}
-	if (_iTemperature > iMaxTemp)
-		iMaxTemp = _iTemperature;
-	else if (_iTemperature < iMinTemp)
-		iMinTemp = _iTemperature;
-	if ((_iHumidity/10) > ucMaxHumid)
-		ucMaxHumid = (uint8_t)(_iHumidity/10);
-	else if ((_iHumidity/10) < ucMinHumid)
-		ucMinHumid = (uint8_t)(_iHumidity/10);
+// Add the latest sample to the history and exposure tracking
+// iSeconds is the nominal time since the previous sample; the measured
+// time is used instead unless there was a gap (e.g. the menu)
+//
+void AddSample(int iSeconds)
+{
+static uint32_t u32LastSample;
+#ifdef USE_FLASHLOG
+static int iLastBattery;
+#endif
+uint32_t u32Now = millis();
+int iElapsed = (int)((u32Now - u32LastSample + 500) / 1000);
+int i;
+
+	batteryUpdate(); // the policy follows the battery as it drains
+#ifdef USE_FLASHLOG
+	i = batteryLevel();
+	if (i == BATTERY_CRITICAL && iLastBattery != BATTERY_CRITICAL)
+		flashlogFlush(); // save the log page before the battery gives out
+	iLastBattery = i;
+#endif
+	if (u32LastSample != 0 && iElapsed > 0 && iElapsed <= iSeconds*2)
+		iSeconds = iElapsed;
+	u32LastSample = u32Now;
+	historyAddSample(_iCO2, _iTemperature, _iHumidity, iSeconds);
+	i = 0;
+#ifdef USE_EXPOSURE
+	exposureAdd(_iCO2, iSeconds);
+	i = exposureNewAlarm(); // an exposure limit was just exceeded
+#endif
+	if (i)
+		alertPlay((i & EXPOSURE_STEL) ? ALERT_EVENT_STEL : ALERT_EVENT_TWA, state.iAlert);
+	// stealth mode gives the level anyway
+	else if (levelUpdate(_iCO2) > 0 && levelGet() >= LEVEL_ALERT && state.iMode != MODE_STEALTH)
+		alertPlay(ALERT_EVENT_LEVEL, state.iAlert);
 } /* AddSample() */
-#endif // FUTURE
 
-void EXTI7_0_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
-
-/*********************************************************************
- * @fn      EXTI0_IRQHandler
- *
- * @brief   This function handles EXTI0 Handler.
- *
- * @return  none
- */
-void EXTI7_0_IRQHandler(void)
-{
-  if(EXTI_GetITStatus(EXTI_Line0)!=RESET)
-  {
-//    printf("EXTI0 Wake_up\r\n");
-	  oledFill(0);
-    EXTI_ClearITPendingBit(EXTI_Line0);     /* Clear Flag */
-  }
-}
 
 void Option_Byte_CFG(void)
 {
@@ -215,54 +271,275 @@ void Option_Byte_CFG(void)
     FLASH_Lock();
 }
 
-#ifdef FUTURE
+static int iEmojiShown = -1; // the one on the display (-1 = none)
+
+//
+// Clear the display; the CO2 screen has to be drawn in full next time
+//
+static void ClearScreen(void)
+{
+	oledFill(0);
+	iEmojiShown = -1;
+} /* ClearScreen() */
+
+#ifdef USE_HISTORY
+static int iGraphTier, iGraphAge;
+
+#ifdef USE_FLASHLOG
+static LOGCURSOR logCursor;
+
+//
+// GRAPHREAD source for the FLASH log; the samples are decoded in place
+//
+static int ReadLog(int bRewind, int *pMin, int *pMax)
+{
+int iValues[CODEC_CHANNELS];
+
+	if (bRewind) {
+		flashlogRewind(&logCursor);
+		return 0;
+	}
+	if (!flashlogNext(&logCursor, iValues))
+		return 0;
+	*pMin = *pMax = iValues[0];
+	return 1;
+} /* ReadLog() */
+#endif // USE_FLASHLOG
+
+//
+// GRAPHREAD source for one of the history tiers, oldest point first
+//
+static int ReadTier(int bRewind, int *pMin, int *pMax)
+{
+TIERPOINT pt;
+
+	if (bRewind) {
+		iGraphAge = historyTierCount(iGraphTier);
+		return 0;
+	}
+	if (!historyGetPoint(iGraphTier, --iGraphAge, &pt))
+		return 0;
+	*pMin = pt.u8Min << HISTORY_CO2_SHIFT;
+	*pMax = pt.u8Max << HISTORY_CO2_SHIFT;
+	return 1;
+} /* ReadTier() */
+
+//
+// Draw a full screen CO2 graph with its range on the top line
+//
+void DrawGraph(const char *szTitle, int iCount, GRAPHREAD *pfnRead)
+{
+char szTemp[16];
+int iMin, iMax, iLow = 0x7fffffff, iHigh = 0;
+int iClock;
+
+	ClearScreen();
+	oledWriteString(0, 0, szTitle, FONT_6x8, 0);
+	if (iCount == 0) {
+		oledWriteString(0, 24, "No data yet", FONT_8x8, 0);
+		return;
+	}
+	iClock = clockSet(CLOCK_COMPUTE); // each page of the graph reads all of the data
+	// find the range first so the graph can be scaled to fit
+	(*pfnRead)(1, NULL, NULL);
+	while ((*pfnRead)(0, &iMin, &iMax)) {
+		if (iMin < iLow) iLow = iMin;
+		if (iMax > iHigh) iHigh = iMax;
+	}
+	i2str(szTemp, iLow);
+	oledWriteString(-1, 0, " ", FONT_6x8, 0);
+	oledWriteString(-1, 0, szTemp, FONT_6x8, 0);
+	oledWriteString(-1, 0, "-", FONT_6x8, 0);
+	i2str(szTemp, iHigh);
+	oledWriteString(-1, 0, szTemp, FONT_6x8, 0);
+	oledDrawGraph(8, 56, iCount, iLow, iHigh, pfnRead);
+	clockSet(iClock);
+} /* DrawGraph() */
+#endif // USE_HISTORY
+
+#ifdef PROFILE
+//
+// Show a time in microseconds in at most 5 digits
+//
+static void ShowMicros(int x, int y, uint32_t u32)
+{
+char szTemp[8];
+
+	if (u32 >= 100000) { // switch to ms
+		i2str(szTemp, (int)(u32 / 1000));
+		oledWriteString(x, y, szTemp, FONT_6x8, 0);
+		oledWriteString(-1, y, "m", FONT_6x8, 0);
+	} else {
+		i2str(szTemp, (int)u32);
+		oledWriteString(x, y, szTemp, FONT_6x8, 0);
+	}
+} /* ShowMicros() */
+
+//
+// Show the count, average and maximum time (us) of each profiled zone
+//
+void ShowProfile(void)
+{
+char szTemp[16];
+const PROFZONE *pZone;
+int i, y;
+
+	ClearScreen();
+	oledWriteString(0, 0, "Zone    Cnt  Avg  Max", FONT_6x8, 0);
+	for (i=0; i<PROF_COUNT; i++) {
+		pZone = profileGet(i);
+		y = 16 + i*8;
+		oledWriteString(0, y, szProfZone[i], FONT_6x8, 0);
+		i2str(szTemp, (int)pZone->u32Count);
+		oledWriteString(42, y, szTemp, FONT_6x8, 0);
+		if (pZone->u32Count) {
+			ShowMicros(72, y, pZone->u32Total / pZone->u32Count);
+			ShowMicros(102, y, pZone->u32Max);
+		}
+	}
+} /* ShowProfile() */
+#endif // PROFILE
+
+#ifdef USE_POWER
+//
+// Show a value in at most 5 characters (thousands get a k)
+//
+static void ShowValue(int x, int y, uint32_t u32)
+{
+char szTemp[8];
+
+	if (u32 >= 10000) {
+		i2str(szTemp, (int)(u32 / 1000));
+		oledWriteString(x, y, szTemp, FONT_6x8, 0);
+		oledWriteString(-1, y, "k", FONT_6x8, 0);
+	} else {
+		i2str(szTemp, (int)u32);
+		oledWriteString(x, y, szTemp, FONT_6x8, 0);
+	}
+} /* ShowValue() */
+
+//
+// Show the charge used in each power state since power up,
+// the average current and the projected battery life
+//
+void ShowPower(void)
+{
+char szTemp[16];
+int i, x, y;
+
+	ClearScreen();
+	oledWriteString(0, 0, "Power uAh ", FONT_6x8, 0);
+	i2str(szTemp, (int)(millis() / 60000));
+	oledWriteString(-1, 0, szTemp, FONT_6x8, 0);
+	oledWriteString(-1, 0, " min", FONT_6x8, 0);
+	for (i=0; i<POWER_COUNT; i++) {
+		x = (i & 1) * 64;
+		y = 8 + (i >> 1)*8;
+		oledWriteString(x, y, szPowerState[i], FONT_6x8, 0);
+		ShowValue(x+30, y, powerCharge(i));
+	}
+	oledWriteString(0, 48, "Avg uA", FONT_6x8, 0);
+	ShowValue(42, 48, powerAverage());
+	oledWriteString(0, 56, "Life h", FONT_6x8, 0);
+	ShowValue(42, 56, powerLifeHours());
+#ifdef USE_BATTERY
+	batteryRead();
+	oledWriteString(72, 48, "Bat", FONT_6x8, 0);
+	ShowValue(96, 48, (uint32_t)batteryMV());
+	oledWriteString(72, 56, "VDD", FONT_6x8, 0);
+	ShowValue(96, 56, (uint32_t)batteryVDD());
+#endif
+} /* ShowPower() */
+#endif // USE_POWER
+
+#ifdef USE_HISTORY
+//
+// Show the collected statistics, then each button press shows the
+// next graph: 1 hour, 12 hours, 7 days and the full FLASH log,
+// followed by the power usage
+//
 void ShowGraph(void)
 {
 	char szTemp[32];
 	int i;
 
 	I2CInit(400000);
-	oledFill(0);
+	ClearScreen();
 
-	i2str(szTemp, iHead*32);
+	i2str(szTemp, historySamples());
     oledWriteString(0,0, szTemp, FONT_8x8, 0);
     oledWriteString(-1, 0, " Samples", FONT_8x8, 0);
-    i = (iHead*32*5)/60; // number of minutes
+    i = (int)(historySeconds()/60); // number of minutes
     oledWriteString(0,8, "(", FONT_8x8, 0);
 	i2str(szTemp, i);
     oledWriteString(-1,8, szTemp, FONT_8x8, 0);
     oledWriteString(-1,8, " minutes)", FONT_8x8, 0);
-	oledWriteString(0,16,"CO2 level:",FONT_12x16, 0);
+	oledWriteString(0,16,"Avg ",FONT_12x16, 0);
 	oledWriteString(0,32,"Min:",FONT_8x8, 0);
 	oledWriteString(0,40,"Max:",FONT_8x8, 0);
 	oledWriteString(0,48,"Temp min/max: ",FONT_6x8, 0);
 	oledWriteString(0,56,"Humi min/max: ", FONT_6x8, 0);
 
-	i2str(szTemp, iMinCO2);
+	i2str(szTemp, historyGetMean(STAT_CO2));
+    oledWriteString(-1, 16, szTemp, FONT_12x16, 0);
+#ifdef USE_STATS
+    oledWriteString(104, 16, "sd", FONT_6x8, 0);
+    i2str(szTemp, statsStdDev());
+    oledWriteString(104, 24, szTemp, FONT_6x8, 0);
+    oledWriteString(80, 32, "p50 ", FONT_6x8, 0);
+    i2str(szTemp, statsP50());
+    oledWriteString(-1, 32, szTemp, FONT_6x8, 0);
+    oledWriteString(80, 40, "p95 ", FONT_6x8, 0);
+    i2str(szTemp, statsP95());
+    oledWriteString(-1, 40, szTemp, FONT_6x8, 0);
+#endif
+	i2str(szTemp, historyGetMin(STAT_CO2));
     oledWriteString(40, 32, szTemp, FONT_8x8, 0);
-    i2str(szTemp, iMaxCO2);
+    i2str(szTemp, historyGetMax(STAT_CO2));
     oledWriteString(40, 40, szTemp, FONT_8x8, 0);
 
-	i2str(szTemp, iMinTemp/10); // whole part
+	i2str(szTemp, historyGetMin(STAT_TEMP)/10); // whole part
     oledWriteString(84, 48, szTemp, FONT_6x8, 0);
     oledWriteString(-1, 48, "/", FONT_6x8, 0);
-    i2str(szTemp, iMaxTemp/10);
+    i2str(szTemp, historyGetMax(STAT_TEMP)/10);
     oledWriteString(-1, 48, szTemp, FONT_6x8, 0);
     oledWriteString(-1, 48, "C", FONT_6x8, 0);
 
-    i2str(szTemp, ucMinHumid);
+    i2str(szTemp, historyGetMin(STAT_HUMID)/10);
     oledWriteString(84, 56, szTemp, FONT_6x8, 0);
     oledWriteString(-1, 56, "/", FONT_6x8, 0);
-    i2str(szTemp, ucMaxHumid);
+    i2str(szTemp, historyGetMax(STAT_HUMID)/10);
     oledWriteString(-1, 56, szTemp, FONT_6x8, 0);
     oledWriteString(-1, 56, "%", FONT_6x8, 0);
 
-    while (digitalRead(BUTTON0_PIN) == 0) {}; // wait for button to release
-	while (digitalRead(BUTTON0_PIN) == 1) {}; // wait for button to press
-	oledFill(0);
-	while (digitalRead(BUTTON0_PIN) == 0) {}; // wait for button to release to exit
+    for (i=0; i<GRAPH_COUNT; i++) {
+        if (WaitButton() == BUTTONS_LONG) // holding a button skips the rest
+        	break;
+        if (i < TIER_COUNT) {
+        	iGraphTier = historyGetTier(iGraphMinutes[i]);
+        	DrawGraph(szGraph[i], historyTierCount(iGraphTier), ReadTier);
+        }
+#ifdef USE_FLASHLOG
+        else {
+        	DrawGraph(szGraph[i], flashlogSampleCount(), ReadLog);
+        }
+#endif
+    }
+    if (i == GRAPH_COUNT) { // didn't skip out
+#ifdef USE_POWER
+    	WaitButton();
+    	ShowPower();
+#endif
+#ifdef PROFILE
+    	WaitButton();
+    	ShowProfile();
+#endif
+    	WaitButton(); // wait for one more press to exit
+    }
+	ClearScreen();
 } /* ShowGraph() */
-#endif // FUTURE
+#endif // USE_HISTORY
+
 //
 // Display the current conditions on the OLED
 //
@@ -270,6 +547,8 @@ void ShowCurrent(void)
 {
 int i, x;
 char szTemp[32];
+int iClock = clockSet(CLOCK_RENDER);
+	PROFILE_BEGIN(PROF_SHOWCURRENT);
 
 	I2CSetSpeed(400000); // OLED can handle 400k
 	i = i2str(szTemp, (int)_iCO2);
@@ -278,9 +557,11 @@ char szTemp[32];
 	if (i < 4) {
 	   oledWriteString(x+24, 0, "  ", FONT_12x16, 0); // make sure old data is erased if going from 4 to 3 digits
 	   oledWriteString(x, 16, "   ", FONT_12x16, 0);
+	   iEmojiShown = -1; // that erased part of it
 	}
 	oledWriteString(x, 0, "CO2", FONT_8x8, 0);
 	oledWriteString(x, 8, "ppm", FONT_8x8, 0);
+#ifdef USE_LABEL_FONT
     oledWriteStringCustom(&Roboto_Black_13, 0, 45, (char *)"Temp", 1);
     oledWriteStringCustom(&Roboto_Black_13, 0, 63, (char *)"Humidity", 1);
     i2str(szTemp, _iTemperature/10); // whole part
@@ -292,91 +573,176 @@ char szTemp[32];
     i2str(szTemp, _iHumidity/10); // throw away fraction since it's not accurate
     oledWriteStringCustom(&Roboto_Black_13, 64, 63, szTemp, 1);
     oledWriteStringCustom(&Roboto_Black_13, -1, -1, "%", 1);
+#else
+    oledWriteString(0, 40, "Temp ", FONT_8x8, 0);
+    i2str(szTemp, _iTemperature/10); // whole part
+    oledWriteString(-1, 40, szTemp, FONT_8x8, 0);
+    oledWriteString(-1, 40, ".", FONT_8x8, 0);
+    i2str(szTemp, _iTemperature % 10); // fraction
+    oledWriteString(-1, 40, szTemp, FONT_8x8, 0);
+    oledWriteString(-1, 40, "C ", FONT_8x8, 0);
+    oledWriteString(0, 56, "Humidity ", FONT_8x8, 0);
+    i2str(szTemp, _iHumidity/10); // throw away fraction since it's not accurate
+    oledWriteString(-1, 56, szTemp, FONT_8x8, 0);
+    oledWriteString(-1, 56, "% ", FONT_8x8, 0);
+#endif
     // Display an emoji indicating the CO2 level
-    // There are 5 which go from happy to angry, so divide the values into
-    // 5 categories: 0-999, 1000-1499, 1500-1999, 2000-2499, 2500+
-    x = (_iCO2 - 500)/500;
-    if (x < 0) x = 0;
-    else if (x > 4) x = 4;
-    oledDrawSprite(96, 16, 31, 32, (uint8_t *)&co2_emojis[x * 4], 20, 1);
+    // There are 5 which go from happy to angry; the first one covers the
+    // two lowest levels (0-999 with the default thresholds). It's only
+    // redrawn when the level changes.
+    x = levelGet();
+    if (x < 0) x = levelClassify(_iCO2); // no samples collected yet
+    x = (x > 0) ? x - 1 : 0;
+    if (x > 4) x = 4;
+    if (x != iEmojiShown) {
+        oledDrawSprite(96, 16, 31, 32, (uint8_t *)&co2_emojis[x * 4], 20, 1);
+        iEmojiShown = x;
+    }
+#ifdef USE_EXPOSURE
+    // Flag an exceeded 8 hour TWA or 15 minute STEL limit
+    x = exposureStatus();
+    oledWriteString(104, 56, (x & EXPOSURE_STEL) ? "STL" : (x & EXPOSURE_TWA) ? "TWA" : "   ", FONT_6x8, (x != 0));
+#endif
+    PROFILE_END(PROF_SHOWCURRENT);
+    clockSet(iClock);
 } /* ShowCurrent() */
 
+static PT ptMode; // only one mode runs at a time
+#ifdef USE_TIMER
+static int iTimerSecs, iTimerDisplay, bTimerEnding, bTimerOverlay;
+static uint32_t u32TimerEnd;
+static PT ptTimer;
+
+//
+// Timer countdown, once per second
+// The time left comes from the deadline, so late ticks don't add up.
+// As an overlay on the CO2 display it's a small mm:ss in the corner.
+//
+static void TimerTick(void)
+{
+int32_t i32Left = (int32_t)(u32TimerEnd - millis());
+char szTemp[8];
+
+	iTimerSecs = (i32Left <= 0) ? 0 : (int)((i32Left + 999) / 1000);
+	I2CWake(400000);
+	if (bTimerOverlay) {
+		TimeString(szTemp, iTimerSecs);
+		oledWriteString(98, 48, szTemp, FONT_6x8, 0);
+		return;
+	}
+	ShowTime(iTimerSecs);
+	if (iTimerSecs <= 10 && !bTimerEnding) { // turn on the display for the last 10 seconds
+		bTimerEnding = 1;
+		if (iTimerDisplay == 0) {
+			oledPower(1);
+		}
+		iTimerDisplay = 11;
+	}
+	if (iTimerDisplay) {
+		iTimerDisplay--;
+		if (iTimerDisplay == 0) {
+			oledPower(0); // turn off the display
+		}
+	}
+	BlinkLED((iTimerSecs & 1) ? LED_GREEN : LED_RED, 10);
+} /* TimerTick() */
+
+//
+// Count down state.iPeriod minutes, then alert
+//
+static PT_THREAD(TimerThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	u32TimerEnd = millis() + state.iPeriod * 60000UL;
+	bTimerEnding = 0;
+	while (1) {
+		TimerTick();
+		if (iTimerSecs == 0) // time's up
+			break;
+		PT_SLEEP(pt, 1000);
+	}
+	alertPlay(ALERT_EVENT_TIMER, state.iAlert);
+	while (alertBusy()) // let it finish before leaving timer mode
+		PT_SLEEP(pt, alertTimeLeft());
+	if (bTimerOverlay)
+		oledWriteString(98, 48, "     ", FONT_6x8, 0);
+	else
+		schedExit();
+	PT_END(pt);
+} /* TimerThread() */
+
+static void TimerButtons(void)
+{
+int j = ButtonPress();
+
+	if (j == 3) { // both buttons cancels timer mode
+		schedExit();
+	} else if (j && iTimerDisplay == 0) { // a single button press turns on the display
+		iTimerDisplay = 5;
+		I2CWake(400000);
+		oledPower(1);
+	}
+} /* TimerButtons() */
+
 void RunTimer(void)
 {
-  int i, j, iTicks = 5;
-  oledFill(0);
+  ClearScreen();
 //  oledContrast(20);
   oledWriteString(0,0, "Timer Mode", FONT_12x16, 0);
-  for (i=state.iPeriod*60; i>=0; i--) { // count down seconds
-	  ShowTime(i);
-//	  Standby82ms(10); // sleep about 820ms
-	  j = GetButtons();
-	  if (j == 3) { // both buttons cancels timer mode
-		  return;
-	  }
-	  if (j && iTicks == 0) { // a single button press turns on the display
-		  iTicks = 5;
-		  oledPower(1);
-	  }
-	  if (i == 10) { // turn on the display for the last 10 seconds
-		  if (iTicks == 0) {
-			  oledPower(1);
-		  }
-		  iTicks = 11;
-	  }
-	  if (iTicks) {
-		  iTicks--;
-		  if (iTicks == 0) {
-			  oledPower(0); // turn off the display
-		  }
-	  }
-	  BlinkLED((i & 1) ? LED_GREEN : LED_RED, 10);
-	  Delay_Ms(990);
-  }
-  ShowAlert();
+  iTimerDisplay = 5;
+  bTimerOverlay = 0;
+  schedInit(SCHED_STANDBY);
+  alertInit();
+  schedAddThread(TimerThread, &ptTimer, 0);
+  schedOnSignal(TimerButtons);
+  schedRun();
 } /* RunTimer() */
+#endif // USE_TIMER
 
 void RunMenu(void)
 {
 int iSelItem = 0;
 int y, bDone = 0;
+#if defined(USE_STEALTH) || defined(USE_TIMER)
 char szTemp[16];
+#endif
 STATE oldstate = state;
 
 	   oledInit(0x3c, 400000);
-	   oledFill(0);
+	   ClearScreen();
 	   oledContrast(150);
 	   oledWriteString(4,0,"Pocket CO2", FONT_12x16, 0);
 //	   oledWriteString(0,16,"================", FONT_8x8, 0);
 	   while (!bDone) {
 		   // draw the menu items and highlight the currently selected one
-		   y = 24;
+		   y = 16;
 		   oledWriteString(0,y,"Start", FONT_8x8, (iSelItem == MENU_START));
 		   y += 8;
 		   oledWriteString(0,y, "Mode", FONT_8x8, (iSelItem == MENU_MODE));
 		   oledWriteString(40,y, szMode[state.iMode], FONT_8x8, 0);
+#ifdef USE_STEALTH
 		   y += 8;
 		   oledWriteString(0,y,"Update", FONT_8x8, (iSelItem == MENU_FREQ));
   		   i2str(szTemp, state.iFreq);
     	   oledWriteString(56,y, szTemp, FONT_8x8, 0);
     	   oledWriteString(-1,y, " secs", FONT_8x8, 0);
+#endif
 		   y += 8;
 		   oledWriteString(0,y,"Alert", FONT_8x8, (iSelItem == MENU_ALERT));
 		   oledWriteString(48,y,szAlert[state.iAlert], FONT_8x8, 0);
+#ifdef USE_HAPTIC
+		   y += 8;
+		   oledWriteString(0,y,"Pulses", FONT_8x8, (iSelItem == MENU_HAPTIC));
+		   oledWriteString(56,y,szHaptic[state.iHaptic], FONT_8x8, 0);
+#endif
+#ifdef USE_TIMER
 		   y += 8;
 		   oledWriteString(0,y,"Timer", FONT_8x8, (iSelItem == MENU_TIME));
 		   i2str(szTemp, state.iPeriod); // time in minutes
 		   oledWriteString(48, y, szTemp, FONT_8x8, 0);
 		   oledWriteString(-1,y, " Mins ", FONT_8x8, 0); // erase old value
-		   // wait for button releases
-		   while (GetButtons() != 0) {
-			   Delay_Ms(20);
-		   }
-		   // wait for a button press
-		   while (GetButtons() == 0) {
-			   Delay_Ms(20);
-		   }
-		   y = GetButtons();
+#endif
+		   y = WaitButton();
 		   if (y & 1) { // button 0
 		      iSelItem++;
 		      if (iSelItem == MENU_COUNT) iSelItem = 0;
@@ -391,18 +757,28 @@ STATE oldstate = state;
 				   state.iMode++;
 				   if (state.iMode >= MODE_COUNT) state.iMode = 0;
 				   break;
+#ifdef USE_STEALTH
 			   case MENU_FREQ: // stealth update frequency
 				   state.iFreq += 15;
 				   if (state.iFreq > 60) state.iFreq = 15;
 				   break;
+#endif
 			   case MENU_ALERT: // alert type
 				   state.iAlert++;
 				   if (state.iAlert >= ALERT_COUNT) state.iAlert = 0;
 				   break;
+#ifdef USE_HAPTIC
+			   case MENU_HAPTIC: // stealth mode encoding
+				   state.iHaptic++;
+				   if (state.iHaptic >= HAPTIC_COUNT) state.iHaptic = 0;
+				   break;
+#endif
+#ifdef USE_TIMER
 			   case MENU_TIME: // time period
 				   state.iPeriod += 5;
 				   if (state.iPeriod > 60) state.iPeriod = 5;
 				   break;
+#endif
 			   }
 			   continue;
 		   }
@@ -413,187 +789,273 @@ STATE oldstate = state;
 	   }
 } /* RunMenu() */
 
+static const uint8_t u8FullOn = PWM_TOP;
+
+//
+// Light an LED for N milliseconds
+// A timer ends the pulse; the CPU sleeps meanwhile
+//
 void BlinkLED(uint8_t u8LED, int iDuration)
 {
-	pinMode(u8LED, OUTPUT);
-    digitalWrite(u8LED, 1);
-    Delay_Ms(iDuration);
-    digitalWrite(u8LED, 0);
+	pwmRamp(u8LED, &u8FullOn, 1, iDuration);
+	pwmWait(u8LED);
 } /* BlinkLED() */
 
 //
-// Run the vibration motor
-// for N milliseconds
-// 50ms is a practical minimum
+// Format a time in seconds as mm:ss
 //
-void Vibrate(int iDuration)
+void TimeString(char *szTemp, int iSecs)
 {
-	pinMode(MOTOR_PIN, OUTPUT);
-	digitalWrite(MOTOR_PIN, 1);
-	Delay_Ms(iDuration);
-	digitalWrite(MOTOR_PIN, 0);
-} /* Vibrate() */
+int iMins = iSecs / 60;
 
-void ShowAlert(void)
-{
-int i;
-
-	switch (state.iAlert)
-	{
-	case ALERT_VIBRATION:
-		for (i=0; i<3; i++) {
-		    Vibrate(150);
-		//    Standby82ms(10);
-		    Delay_Ms(820);
-		  }
-		break;
-	case ALERT_LED:
-		for (i=0; i<4; i++) {
-		    BlinkLED(LED_GREEN, 300);
-		    BlinkLED(LED_RED, 300);
-		  }
-		break;
-	case ALERT_BOTH:
-		for (i=0; i<3; i++) {
-		    Vibrate(150);
-		    BlinkLED(LED_GREEN, 400);
-		    BlinkLED(LED_RED, 400);
-		  }
-		break;
-	}
-} /* ShowAlert() */
-
-void ShowTime(int iSecs)
-{
-	char szTemp[8];
-    szTemp[0] = '0';
-	szTemp[1] = (iSecs/60)+'0';
+	szTemp[0] = (iMins / 10) + '0';
+	szTemp[1] = (iMins % 10) + '0';
 	szTemp[2] = ':';
 	szTemp[3] = ((iSecs % 60) / 10) + '0';
 	szTemp[4] = (iSecs % 10) + '0';
 	szTemp[5] = 0;
+} /* TimeString() */
+
+void ShowTime(int iSecs)
+{
+	char szTemp[8];
+	TimeString(szTemp, iSecs);
 	oledWriteStringCustom(&Roboto_Black_40, 10, 56, szTemp, 1);
 //	oledWriteString(34,24,szTemp, FONT_12x16, 0);
 } /* ShowTime() */
 
-int GetButtons(void)
+//
+// Collect the presses of a button event; if the other button goes down
+// within BUTTON_BOTH_MS, it's treated as both pressed together
+//
+static int CollectPress(int iButtons)
 {
-	int i = 0;
-	pinMode(BUTTON0_PIN, INPUT_PULLUP); // re-enable gpio in case it got disabled by standby mode
-	pinMode(BUTTON1_PIN, INPUT_PULLUP);
-	if (digitalRead(BUTTON0_PIN) == 0) i|=1;
-	if (digitalRead(BUTTON1_PIN) == 0) i|=2;
-	return i;
+BUTTONEVENT ev;
 
-} /* GetButtons() */
+	Delay_Ms(BUTTON_BOTH_MS);
+	while (buttonsRead(&ev)) {
+		if (ev.u8Type == BUTTON_PRESS) iButtons |= ev.u8Button;
+	}
+	return iButtons | buttonsState();
+} /* CollectPress() */
 
-void RunLowPower(void)
+//
+// Return the buttons pressed since the last call (0 if none)
+// Releases and long presses are ignored; a press while an alert is
+// playing only silences it
+//
+int ButtonPress(void)
 {
-	int i, iUITick = 20, iSampleTick = 0;
-	int bWasSuspended = 0;
+BUTTONEVENT ev;
+int i;
 
-    I2CSetSpeed(50000);
-    scd41_start(SCD_POWERMODE_LOW); // start low power mode (available on SCD40 & SCD41)
+	while (buttonsRead(&ev)) {
+		if (ev.u8Type == BUTTON_PRESS) {
+			i = CollectPress(ev.u8Button);
+			return alertCancel() ? 0 : i;
+		}
+	}
+	return 0;
+} /* ButtonPress() */
+
+//
+// Sleep until a button is pressed and return which ones (1-3)
+// or BUTTONS_LONG if one is held down
+//
+int WaitButton(void)
+{
+BUTTONEVENT ev;
 
+	buttonsFlush(); // forget anything pressed before we asked
 	while (1) {
-		if ((iSampleTick & 7) == 0) { // blink LED once every 2 seconds to show we're running
-			  BlinkLED(LED_GREEN, 2);
-		}
-		i = GetButtons();
-		if (i == 3) { // both buttons pressed, return to menu
-			if (bWasSuspended == 1) {
-				I2CInit(50000);
-			}
-			scd41_stop(); // stop collecting samples
-			return;
-		} else if (i && iUITick == 0) { // one button pressed, show the current data
-			if (bWasSuspended == 1) {
-				I2CInit(400000);
-				bWasSuspended = 0;
-			}
-		   oledPower(1);
-		   ShowCurrent(); // display the current conditions on the OLED
-		   iUITick = 20; // number of 250ms periods before turning off the display
+		while (buttonsRead(&ev)) {
+			if (ev.u8Type == BUTTON_PRESS)
+				return CollectPress(ev.u8Button);
+			if (ev.u8Type == BUTTON_LONG)
+				return BUTTONS_LONG;
 		}
-#ifdef DEBUG_MODE
-		Delay_Ms(250);
-#else
-	Standby82ms(3); // conserve power (1.8mA running, 10uA standby)
-	bWasSuspended = 1;
-#endif
-		iSampleTick++;
-		if (iSampleTick == 120) { // 30 seconds have passed
-			if (bWasSuspended == 1) {
-				I2CInit(50000);
-				bWasSuspended = 0;
-			} else {
-				I2CSetSpeed(50000);
-			}
-	       scd41_getSample();
-	       iSampleTick = 0; // restart the 30 second timer for the next sample
+		buttonsWait();
+	}
+} /* WaitButton() */
+
+//
+// Set the I2C speed for the next device; Standby82ms() restores
+// the I2C pins and registers, so nothing else needs to be set up
+//
+void I2CWake(int iSpeed)
+{
+	I2CSetSpeed(iSpeed);
+} /* I2CWake() */
+
+static int iDisplayTask, bDisplayOn;
+
+//
+// Sample interval (seconds); longer when the battery is low
+//
+static int LowPowerInterval(void)
+{
+	return adaptInterval() << batteryPolicy()->u8IntervalShift;
+} /* LowPowerInterval() */
+
+static void LowPowerSample(void)
+{
+int iMode = adaptPowerMode();
+int iSeconds = LowPowerInterval();
+
+	I2CWake(50000);
+	if (scd41_getSample() != SCD_SUCCESS)
+		return;
+	AddSample(iSeconds);
+	adaptAdd(_iCO2, iSeconds);
+	if (adaptPowerMode() != iMode) { // switch the sensor to the new rate
+		if (iMode != SCD_POWERMODE_ONESHOT)
+			scd41_stop();
+		scd41_start(adaptPowerMode());
+	}
+} /* LowPowerSample() */
+
+static uint32_t u32LowPowerNext;
+static int32_t i32LowPowerLeft;
+
+static PT_THREAD(LowPowerThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	while (1) {
+		u32LowPowerNext = millis() + LowPowerInterval() * 1000UL;
+		if (adaptPowerMode() == SCD_POWERMODE_ONESHOT)
+			u32LowPowerNext -= 5000; // the measurement takes 5 seconds
+		while ((i32LowPowerLeft = (int32_t)(u32LowPowerNext - millis())) > 0) {
+			BlinkLED(LED_GREEN, 2); // show that we're running
+			PT_SLEEP(pt, (i32LowPowerLeft < 2000) ? i32LowPowerLeft : 2000);
 		}
-		if (iUITick > 0) {
-			iUITick--;
-			if (iUITick == 0) { // shut off the display after 5 seconds
-				if (bWasSuspended) {
-					I2CInit(400000);
-					bWasSuspended = 0;
-				} else {
-					I2CSetSpeed(400000);
-				}
-				oledPower(0);
-			}
+		if (adaptPowerMode() == SCD_POWERMODE_ONESHOT) {
+			I2CWake(50000);
+			scd41_measure();
+			PT_SLEEP(pt, 5000);
 		}
+		LowPowerSample();
+	}
+	PT_END(pt);
+} /* LowPowerThread() */
+
+static void DisplayOff(void)
+{
+	I2CWake(400000);
+	oledPower(0);
+	bDisplayOn = 0;
+} /* DisplayOff() */
+
+//
+// Show the current data on a display which is kept off (low power mode,
+// or a nearly empty battery) and turn it off again after 5 seconds
+//
+static void DisplayOnRequest(void)
+{
+	I2CWake(400000);
+	oledPower(1);
+	oledContrast(batteryPolicy()->u8Contrast);
+	ShowCurrent(); // display the current conditions on the OLED
+	bDisplayOn = 1;
+	schedWake(iDisplayTask, 5000);
+} /* DisplayOnRequest() */
+
+static void LowPowerButtons(void)
+{
+int i = ButtonPress();
+
+	if (i == 3) { // both buttons pressed, return to menu
+		schedExit();
+	} else if (i && !bDisplayOn) { // one button pressed, show the current data
+		DisplayOnRequest();
 	}
+} /* LowPowerButtons() */
+
+void RunLowPower(void)
+{
+    I2CSetSpeed(50000);
+    // start in low power mode (available on SCD40 & SCD41); the rate
+    // then follows the CO2 level
+    adaptInit(ADAPT_NORMAL);
+    scd41_start(adaptPowerMode());
+
+	bDisplayOn = 1;
+	schedInit(SCHED_STANDBY);
+	alertInit();
+	schedAddThread(LowPowerThread, &ptMode, 0);
+	schedOnSignal(LowPowerButtons);
+	iDisplayTask = schedAdd(DisplayOff, 0, 5000);
+	schedRun();
+	I2CWake(50000);
+	scd41_stop(); // stop collecting samples
 } /* RunLowPower() */
 
+#ifdef USE_STEALTH
+static int iStealthLevel, iStealthTask;
+
+static void StealthSample(void)
+{
+int iShift = batteryPolicy()->u8IntervalShift;
+
+	I2CWake(50000);
+	if (scd41_getSample() == SCD_SUCCESS)
+		AddSample(5 << iShift);
+	schedSetPeriod(iStealthTask, 5000 << iShift);
+	// 1 = perfect, 2 = good, 3 = so-so, 4 = not great, 5 = bad, 6 = very bad
+	if (levelGet() >= 0)
+		iStealthLevel = 1 + levelGet();
+} /* StealthSample() */
+
+//
+// Buzz the level every state.iFreq seconds in the chosen encoding
+//
+static PT_THREAD(StealthThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	while (1) {
+		PT_SLEEP(pt, state.iFreq * 1000);
+		hapticReport(iStealthLevel, _iCO2); // plays while we sleep
+	}
+	PT_END(pt);
+} /* StealthThread() */
+
+static void StealthButtons(void)
+{
+	if (ButtonPress() == 3) // return to menu
+		schedExit();
+} /* StealthButtons() */
+
 void RunStealth(void)
 {
-	int iTick=0, j, iLevel = 1;
-	int iUpdate = state.iFreq * 4; // how many quarter seconds to update vibration result
-  oledFill(0);
+  ClearScreen();
   oledWriteString(22,0,"Stealth", FONT_12x16, 0);
   oledWriteString(0,16,"CO2 measurements will", FONT_6x8, 0);
   oledWriteString(0,24,"be converted to 1-6", FONT_6x8, 0);
   oledWriteString(0,32,"pulses. 1=good, 6=bad", FONT_6x8, 0);
+#ifdef USE_HAPTIC
+  oledWriteString(0,40,"Encoding: ", FONT_6x8, 0);
+  oledWriteString(-1,40,szHaptic[state.iHaptic], FONT_6x8, 0);
+#endif
   oledWriteString(0,56,"press button to start", FONT_6x8, 0);
-  while (GetButtons() != 0) {
-	  Delay_Ms(20); // wait for user to release all buttons
-  }
-  while (j = GetButtons() == 0) {
-	  Delay_Ms(20);
-  }
-  oledFill(0);
+  WaitButton();
+  ClearScreen();
   oledPower(0);
   // start fast CO2 sampling
   I2CSetSpeed(50000);
   scd41_start(SCD_POWERMODE_NORMAL);
 
-  while (1) {
-	  j = GetButtons();
-	  if (j == 3) { // return to menu
-		  oledFill(0);
-		  scd41_stop();
-		  return;
-	  }
-	  Delay_Ms(250);
-	  if ((iTick % 20) == 19) { // get new sample every 5 seconds
-		  scd41_getSample();
-		  iLevel = 1 + (_iCO2/500); // 0-499 = perfect, 500-999 = good, 1000-1499=so-so, 1500-1999=not great, 2000-2499=bad, 2500+ = very bad
-		  if (iLevel < 1) iLevel = 1;
-		  else if (iLevel > 6) iLevel = 6;
-	  }
-	  if ((iTick % iUpdate) == (iUpdate-1)) { // time to buzz
-		  for (j=0; j<iLevel; j++) {
-			  Vibrate(100);
-			  Delay_Ms(395);
-//			  BlinkLED(LED_GREEN, 5);
-			  iTick += 2; // we delayed it 500ms
-		  }
-	  }
-	  iTick++;
-  } // while (1)
+  iStealthLevel = 1;
+  hapticInit(state.iHaptic);
+  schedInit(SCHED_STANDBY);
+  alertInit();
+  iStealthTask = schedAdd(StealthSample, 5000, 5000); // get new sample every 5 seconds
+  schedAddThread(StealthThread, &ptMode, 0);
+  schedOnSignal(StealthButtons);
+  schedRun();
+  I2CWake(50000);
+  ClearScreen();
+  scd41_stop();
 } /* RunStealth() */
+#endif // USE_STEALTH
 #ifdef FUTURE
 //
 // Wait for user to press a button, show 1 minute of samples
@@ -610,13 +1072,13 @@ void RunOnDemand(void)
 #else
 			Standby82ms(3); // conserve power (1.8mA running, 10uA standby)
 #endif
-			i = GetButtons();
+			i = ButtonPress();
 			if (i == 3) { // both buttons pressed
 				return; // go back to main menu
 			}
 			if (i != 0) { // a button was pressed, display 1 minute of samples
                oledInit(0x3c, 400000);
-			   oledFill(0);
+			   ClearScreen();
 			   oledWriteString(0,0,"Waking up...", FONT_8x8, 0);
 			   I2CSetSpeed(50000);
 		       scd41_start(SCD_POWERMODE_NORMAL);
@@ -631,7 +1093,7 @@ void RunOnDemand(void)
 					   scd41_getSample();
 					   ShowCurrent(); // display the current conditions on the OLED
 				   }
-				   i = GetButtons();
+				   i = ButtonPress();
 				   if (i == 3) {
 					   scd41_stop();
 					   return; // go to main menu
@@ -645,11 +1107,35 @@ void RunOnDemand(void)
 } /* RunOnDemand() */
 #endif // FUTURE
 
+#ifdef USE_CALIBRATE
+static int iCalSecs, bCalCancel;
+
+static PT_THREAD(CalibrateThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	// allow 3 minutes of normal collection
+	for (iCalSecs=210; iCalSecs>=0; iCalSecs--) {
+		I2CWake(400000);
+		ShowTime(iCalSecs);
+		PT_SLEEP(pt, 1000);
+	}
+	schedExit();
+	PT_END(pt);
+} /* CalibrateThread() */
+
+static void CalibrateButtons(void)
+{
+	if (ButtonPress() == 3) { // user quit
+		bCalCancel = 1;
+		schedExit();
+	}
+} /* CalibrateButtons() */
+
 void RunCalibrate(void)
 {
 	int i, j;
 
-	oledFill(0);
+	ClearScreen();
 	oledWriteString(10,0,"Calibrate", FONT_12x16, 0);
     oledWriteString(0,16,"Place device in a", FONT_6x8, 0);
     oledWriteString(0,24,"free air environment.", FONT_6x8, 0);
@@ -657,28 +1143,24 @@ void RunCalibrate(void)
     oledWriteString(0,40,"to start. When timer", FONT_6x8, 0);
     oledWriteString(0,48,"finishes, result will", FONT_6x8, 0);
     oledWriteString(0,56,"show success or fail", FONT_6x8, 0);
-    while (GetButtons()) {
-    	Delay_Ms(20); // wait for user to release button(s)
-    }
-	while ((j = GetButtons()) == 0) {
-		Delay_Ms(20);
-	}
+	j = WaitButton();
 	if (j == 3) { // both buttons, exit
 		return;
 	}
-	oledFill(0);
+	ClearScreen();
 	oledWriteString(0,0,"Calibration running", FONT_6x8, 0);
    I2CSetSpeed(50000);
    scd41_start(SCD_POWERMODE_NORMAL);
-   // allow 3 minutes of normal collection
-   for (i=210; i>=0; i--) {
-	  ShowTime(i);
-	  j = GetButtons();
-	  if (j == 3) { // user quit
-		  scd41_stop();
-		  return;
-	  }
-	  Delay_Ms(1000);
+   bCalCancel = 0;
+   schedInit(SCHED_STANDBY);
+   alertInit();
+   schedAddThread(CalibrateThread, &ptMode, 0);
+   schedOnSignal(CalibrateButtons);
+   schedRun();
+   I2CWake(50000);
+   if (bCalCancel) {
+	  scd41_stop();
+	  return;
    }
    oledClearLine(24);
    oledClearLine(32);
@@ -691,16 +1173,98 @@ void RunCalibrate(void)
    else
 	   oledWriteString(0,32, "Failed", FONT_12x16, 0);
    oledWriteString(0,56, "Press button to exit", FONT_6x8, 0);
-   while (GetButtons() == 0) {
-	   Delay_Ms(20);
-   }
+   WaitButton();
 } /* RunCalibrate() */
+#endif // USE_CALIBRATE
+
+static void ContinuousSample(void)
+{
+int i;
+const BATTPOLICY *pPolicy;
+
+    I2CWake(50000); // SCD40 can't handle 400k
+	i = scd41_getSample();
+	iSample++;
+	if (iSample > 3 && i == SCD_SUCCESS) AddSample(5 << batteryPolicy()->u8IntervalShift); // add it to collected stats
+	if (iSample == 16 && state.iMode != MODE_CONTINUOUS ) { // after 1 minute, turn off the display
+		oledPower(0); // turn off display
+	}
+	pPolicy = batteryPolicy();
+	if (!pPolicy->bDisplay) { // battery is nearly empty; only show it on request
+		if (bDisplayOn && !schedActive(iDisplayTask)) {
+			oledPower(0);
+			bDisplayOn = 0;
+		}
+		return;
+	}
+	schedStop(iDisplayTask); // on for good again
+	if (!bDisplayOn) {
+		oledPower(1);
+		bDisplayOn = 1;
+	}
+	oledContrast(pPolicy->u8Contrast);
+	ShowCurrent(); // display the current conditions on the OLED
+} /* ContinuousSample() */
+
+static PT_THREAD(MonitorThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	while (1) {
+		// the first one allows time for the first sample to capture
+		PT_SLEEP(pt, 5000 << batteryPolicy()->u8IntervalShift);
+		ContinuousSample();
+	}
+	PT_END(pt);
+} /* MonitorThread() */
+
+#ifdef USE_TIMER
+static int iTimerTask;
+#endif
+
+static void ContinuousButtons(void)
+{
+int j = ButtonPress();
+
+	if (j == 3) { // both buttons pressed
+		schedExit();
+	} else if (j != 0 && !bDisplayOn) { // kept off for the battery; show the current data
+		DisplayOnRequest();
+#ifdef USE_TIMER
+	} else if (j == 2) { // button 1 starts or cancels a timer shown over the CO2 display
+		if (schedActive(iTimerTask)) {
+			schedStop(iTimerTask);
+			oledWriteString(98, 48, "     ", FONT_6x8, 0);
+		} else {
+			PT_INIT(&ptTimer);
+			schedWake(iTimerTask, 0);
+		}
+#endif
+#ifdef USE_HISTORY
+	} else if (j != 0) { // button 0 shows the collected stats
+		ShowGraph();
+		ShowCurrent();
+#endif
+	}
+} /* ContinuousButtons() */
 
 int main(void)
 {
 
     Delay_Init();
+#ifdef PROFILE
+    profileReset();
+#endif
+    historyInit();
+#ifdef USE_EXPOSURE
+    exposureInit();
+#endif
+#ifdef USE_FLASHLOG
+    flashlogInit(); // find the end of the sample log
+#endif
+    buttonsInit();
+    batteryInit(); // low voltage warning
     ReadFlash(); // get the user settings from FLASH
+    levelInit(state.iThresholds, state.iHyst);
 //    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
 //    Option_Byte_CFG(); // allow PD7 to be used as GPIO
 //    Delay_Ms(5000); //100); // give time for power to settle
@@ -708,74 +1272,61 @@ int main(void)
 //    printf("SystemClk:%d\r\n",SystemCoreClock);
     pinMode(MOTOR_PIN, OUTPUT);
     digitalWrite(MOTOR_PIN, 0);
-    state.iAlert = ALERT_LED;
-    ShowAlert(); // blink LEDs
+    // hold the motor and LEDs off in standby instead of letting them float
+    StandbyPinMode(MOTOR_PIN, OUTPUT);
+    StandbyPinMode(LED_RED, OUTPUT);
+    StandbyPinMode(LED_GREEN, OUTPUT);
+    alertPlay(ALERT_EVENT_STARTUP, ALERT_LED); // blink LEDs
+    alertWait();
 menu_top:
+#ifdef USE_FLASHLOG
+   flashlogFlush(); // every mode returns here; keep what it logged
+#endif
    RunMenu();
    // Display the chosen mode
-	oledFill(0);
+	ClearScreen();
 	oledWriteString(0,0,szMode[state.iMode], FONT_8x8, 0);
     oledWriteString(0,8,"Starting...", FONT_8x8, 0);
+#ifdef USE_TIMER
    if (state.iMode == MODE_TIMER) {
 	   RunTimer();
 	   goto menu_top;
-   } else if (state.iMode == MODE_CALIBRATE) {
+   }
+#endif
+#ifdef USE_CALIBRATE
+   if (state.iMode == MODE_CALIBRATE) {
 	   RunCalibrate();
 	   goto menu_top;
-   } else if (state.iMode == MODE_LOW_POWER) {
+   }
+#endif
+#ifdef USE_STEALTH
+   if (state.iMode == MODE_STEALTH) {
+	   RunStealth();
+	   goto menu_top;
+   }
+#endif
+   if (state.iMode == MODE_LOW_POWER) {
 	   RunLowPower();
 	   goto menu_top;
 //   } else if (state.iMode == MODE_ON_DEMAND) {
 //	   RunOnDemand();
 //	   goto menu_top;
-   } else if (state.iMode == MODE_STEALTH) {
-	   RunStealth();
-	   goto menu_top;
    } else { // continuous mode
 	   I2CSetSpeed(50000);
 	   scd41_start(SCD_POWERMODE_NORMAL);
-#ifdef DEBUG_MODE
-	   Delay_Ms(5000); // allow time for first sample to capture
-#else
-	   Standby82ms(59);
-#endif
-    while(1) {
-    	int i, j;
-        I2CInit(50000); // SCD40 can't handle 400k
-    	//I2CSetSpeed(50000); // SCD40 can't handle 400k
-    	scd41_getSample();
-    	iSample++;
-#ifdef FUTURE
-    	if (iSample > 3) AddSample(iSample); // add it to collected stats
-#endif // FUTURE
-    	if (iSample == 16 && state.iMode != MODE_CONTINUOUS ) { // after 1 minute, turn off the display
-    		oledPower(0); // turn off display
-    	}
-    	ShowCurrent(); // display the current conditions on the OLED
-		for (i=0; i<61; i+= 3) { // 5 seconds total
-#ifdef DEBUG_MODE
-			Delay_Ms(3*82); // use a power wasting delay to allow SWDIO to work
-#else
-			Standby82ms(3); // conserve power (1.8mA running, 10uA standby)
+	   bDisplayOn = 1;
+	   schedInit(SCHED_STANDBY);
+	   alertInit();
+	   schedAddThread(MonitorThread, &ptMode, 0);
+#ifdef USE_TIMER
+	   bTimerOverlay = 1;
+	   iTimerTask = schedAddThread(TimerThread, &ptTimer, -1);
 #endif
-			j = GetButtons();
-			if (j == 3) { // both buttons pressed
- 			    scd41_stop(); // stop periodic measurement
-				goto menu_top;
-			}
-//				if (iMode == 0) {
-					// OLED is off, turn it back on
-//					I2CInit(100000);
-//					oledPower(1);
-//					iMode = 1;
-//					while (digitalRead(BUTTON0_PIN) == 0) {}; // wait for button to release
-//					iSample = 4; // reset sample counter to reset display timeout (does not affect sample collection)
-//				} else {
-//					ShowGraph(); // show collected stats
-//					goto get_sample; // enough time has passed, get the next sample
-//				}
-//			}
-		} // for i
-    } // while (1)
+	   schedOnSignal(ContinuousButtons);
+	   iDisplayTask = schedAdd(DisplayOff, 0, -1);
+	   schedRun();
+	   I2CWake(50000);
+	   scd41_stop(); // stop periodic measurement
+	   goto menu_top;
    } // not timer mode
 } /* main() */
@@ -21,6 +21,8 @@
 #include <string.h>
 #include "oled.h"
 #include "Arduino.h"
+#include "profile.h"
+#include "power.h"
 
 static int cursor_x, cursor_y;
 static uint8_t oledAddr;
@@ -183,6 +185,7 @@ void oledInit(uint8_t u8Addr, int iSpeed)
 	   I2CInit(iSpeed);
 	   oledAddr = u8Addr;
 	   I2CWrite(oledAddr, (uint8_t *)oled64_initbuf, sizeof(oled64_initbuf));
+	   powerOn(POWER_OLED); // the init sequence turns the display on
 } /* oledInit() */
 
 void oledSetPosition(int x, int y)
@@ -272,6 +275,11 @@ void oledPower(int bOn)
 	ucTemp[0] = 0; // CMD
 	ucTemp[1] = 0xae | (bOn != 0); // power on/off (LSB)
 	I2CWrite(oledAddr, ucTemp, 2);
+	if (bOn) {
+		powerOn(POWER_OLED);
+	} else {
+		powerOff(POWER_OLED);
+	}
 } /* oledPower() */
 
 int oledGetCursorX(void)
@@ -534,6 +542,7 @@ uint8_t *s, *d, bits, ucFill=0, ucMask, uc;
 GFXfont font;
 GFXglyph glyph, *pGlyph;
 
+   PROFILE_BEGIN(PROF_WRITESTRING);
    u8Cache[0] = 0x40; // start of data
     if (x == -1)
         x = cursor_x;
@@ -600,4 +609,57 @@ GFXglyph glyph, *pGlyph;
    } // while drawing characters
    cursor_x = x;
    cursor_y = y;
+   PROFILE_END(PROF_WRITESTRING);
 } /* oledWriteStringCustom() */
+
+//
+// Draw a min/max envelope graph of iCount points across the full width
+// of the display in the rows y to y+cy-1 (y and cy multiples of 8)
+// There's no back buffer, so each 8-row page is rasterized into u8Cache
+// by walking the data source again from the start. That keeps RAM use
+// constant no matter how many points there are (e.g. reading history
+// in place from FLASH). When there are more than 128 points, the ones
+// which land in the same column are merged into a single min/max bar.
+//
+void oledDrawGraph(int y, int cy, int iCount, int iLow, int iHigh, GRAPHREAD *pfnRead)
+{
+int iPage, i, x, iErr, iMin, iMax, iColMin, iColMax, iTop, iBot, iScale;
+uint8_t u8Mask;
+
+	if (iCount <= 0)
+		return;
+	if (iHigh <= iLow) iHigh = iLow + 1;
+	iScale = ((cy - 1) << 16) / (iHigh - iLow); // 16.16 pixels per unit
+	u8Cache[0] = 0x40; // start of data
+	for (iPage = y; iPage < y + cy; iPage += 8) {
+		memset(&u8Cache[1], 0, OLED_WIDTH);
+		(*pfnRead)(1, NULL, NULL); // rewind
+		x = iErr = 0;
+		iColMin = 0x7fffffff; iColMax = -0x7fffffff;
+		for (i=0; i<iCount && (*pfnRead)(0, &iMin, &iMax); i++) {
+			if (iMin < iColMin) iColMin = iMin;
+			if (iMax > iColMax) iColMax = iMax;
+			iErr += OLED_WIDTH; // step through the columns without dividing
+			if (iErr < iCount)
+				continue; // more points for this column
+			// convert to rows; larger values are higher on the display
+			if (iColMax > iHigh) iColMax = iHigh;
+			if (iColMin < iLow) iColMin = iLow;
+			iTop = y + cy - 1 - (((iColMax - iLow) * iScale) >> 16);
+			iBot = y + cy - 1 - (((iColMin - iLow) * iScale) >> 16);
+			if (iTop < iPage) iTop = iPage;
+			if (iBot > iPage + 7) iBot = iPage + 7;
+			u8Mask = 0;
+			if (iTop <= iBot) // bits iTop through iBot of this page
+				u8Mask = (uint8_t)((0xff << (iTop & 7)) & (0xff >> (7 - (iBot & 7))));
+			do { // one or more columns for this point
+				u8Cache[1+x] = u8Mask;
+				x++;
+				iErr -= iCount;
+			} while (iErr >= iCount);
+			iColMin = 0x7fffffff; iColMax = -0x7fffffff;
+		} // for each point
+		oledSetPosition(0, iPage);
+		I2CWrite(oledAddr, u8Cache, OLED_WIDTH + 1);
+	} // for each page
+} /* oledDrawGraph() */
@@ -57,6 +57,11 @@ typedef struct {
 } GFXfont;
 #endif // _ADAFRUIT_GFX_H
 
+// Graph data source for oledDrawGraph. Called with bRewind set to start
+// over from the oldest point, then repeatedly for each point in order.
+// Returns 0 when there are no more points.
+typedef int (GRAPHREAD)(int bRewind, int *pMin, int *pMax);
+
 // public methods
 void oledInit(uint8_t u8Addr, int iSpeed);
 void oledSetPosition(int x, int y);
@@ -69,4 +74,5 @@ void oledClearLine(int y);
 int oledGetCursorX(void);
 int oledGetCursorY(void);
 void oledPower(int bOn);
+void oledDrawGraph(int y, int cy, int iCount, int iLow, int iHigh, GRAPHREAD *pfnRead);
 #endif /* USER_OLED_H_ */
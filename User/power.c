@@ -0,0 +1,109 @@
+//
+// Power state accounting
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "power.h"
+
+#ifdef USE_POWER
+const char *szPowerState[POWER_COUNT] = {"CPU", "Stby", "I2C", "OLED", "Mot", "LED", "SCD", "SCLP", "C24", "C48"};
+static const uint32_t u32Current[POWER_COUNT] = {CURRENT_CPU_UA, CURRENT_STANDBY_UA,
+	CURRENT_I2C_UA, CURRENT_OLED_UA, CURRENT_MOTOR_UA, CURRENT_LED_UA,
+	CURRENT_SCD_PERIODIC_UA, CURRENT_SCD_LOWPOWER_UA, CURRENT_CPU24_UA, CURRENT_CPU48_UA};
+// Time in us (8MHz SysTick ticks); it's only turned into ms when
+// the power screen shows it, the library divide is too slow to run at
+// every switch. Tick_Micros() when it was turned on; the display and
+// the sensor stay on for hours, longer than micros() takes to wrap
+static uint64_t u64Us[POWER_COUNT];
+static uint64_t u64Start[POWER_COUNT];
+static uint16_t u16On; // states which are on
+
+void powerAdd(int iState, uint32_t u32Us)
+{
+	u64Us[iState] += u32Us;
+} /* powerAdd() */
+
+void powerOn(int iState)
+{
+	if (u16On & (1 << iState))
+		return;
+	u16On |= (1 << iState);
+	u64Start[iState] = Tick_Micros();
+} /* powerOn() */
+
+void powerOff(int iState)
+{
+	if (!(u16On & (1 << iState)))
+		return;
+	u16On &= ~(1 << iState);
+	u64Us[iState] += Tick_Micros() - u64Start[iState];
+} /* powerOff() */
+
+//
+// Total time in a state (ms), including the time it's been on for now
+//
+uint32_t powerTime(int iState)
+{
+uint64_t u64 = u64Us[iState];
+
+	if (iState == POWER_CPU) // everything that wasn't standby
+		u64 = Tick_Micros() - u64Us[POWER_STANDBY];
+	else if (u16On & (1 << iState))
+		u64 += Tick_Micros() - u64Start[iState];
+	return (uint32_t)(u64 / 1000);
+} /* powerTime() */
+
+//
+// Charge used in a state (uAh)
+//
+uint32_t powerCharge(int iState)
+{
+	return (uint32_t)(((uint64_t)powerTime(iState) * u32Current[iState]) / 3600000);
+} /* powerCharge() */
+
+//
+// Average current since power up (uA)
+//
+uint32_t powerAverage(void)
+{
+uint64_t u64 = 0;
+uint32_t u32Elapsed = millis();
+int i;
+
+	if (u32Elapsed == 0)
+		return 0;
+	for (i=0; i<POWER_COUNT; i++)
+		u64 += (uint64_t)powerTime(i) * u32Current[i];
+	return (uint32_t)(u64 / u32Elapsed);
+} /* powerAverage() */
+
+//
+// Projected battery life at the average current so far (hours)
+//
+uint32_t powerLifeHours(void)
+{
+uint32_t u32 = powerAverage();
+
+	if (u32 == 0)
+		return 0;
+	return (BATTERY_MAH * 1000UL) / u32;
+} /* powerLifeHours() */
+#endif // USE_POWER
@@ -0,0 +1,82 @@
+//
+// Power state accounting
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_POWER_H_
+#define USER_POWER_H_
+
+#include "config.h"
+
+// Time is accumulated for each power state as the drivers switch things
+// on and off. The states aren't exclusive (e.g. the OLED is on while the
+// CPU is in standby); CPU active is the time not spent in standby and
+// I2C busy is a part of it.
+enum
+{
+	POWER_CPU=0,
+	POWER_STANDBY,
+	POWER_I2C,
+	POWER_OLED,
+	POWER_MOTOR,
+	POWER_LED,
+	POWER_SCD_PERIODIC,
+	POWER_SCD_LOWPOWER,
+	POWER_CPU24, // time boosted to 24MHz
+	POWER_CPU48, // and 48MHz
+	POWER_COUNT
+};
+
+// Average supply current of each state in uA (3.3V)
+// Adjust these to match measurements of the actual board
+#define CURRENT_CPU_UA 1800 // 8MHz HSI running
+#define CURRENT_STANDBY_UA 10
+#define CURRENT_I2C_UA 400 // pull-ups + peripheral
+#define CURRENT_OLED_UA 8000 // SSD1306 with typical text
+#define CURRENT_MOTOR_UA 60000
+#define CURRENT_LED_UA 5000
+#define CURRENT_SCD_PERIODIC_UA 15000 // SCD41 datasheet average
+#define CURRENT_SCD_LOWPOWER_UA 3200
+// Extra current over 8MHz while the core is boosted
+#define CURRENT_CPU24_UA 1500
+#define CURRENT_CPU48_UA 3300
+// Battery capacity used for the projected runtime
+// (host/sim_sched: a day of an office averages 23mA in continuous mode,
+// 96% of it the SCD41 and the OLED, 5.4mA in low power mode and 15mA
+// in stealth mode; 6, 27 and 9 hours)
+#define BATTERY_MAH 150
+
+#ifdef USE_POWER
+extern const char *szPowerState[];
+
+void powerOn(int iState);
+void powerOff(int iState);
+void powerAdd(int iState, uint32_t u32Us);
+uint32_t powerTime(int iState);
+uint32_t powerCharge(int iState);
+uint32_t powerAverage(void);
+uint32_t powerLifeHours(void);
+#else
+// the drivers' calls compile to nothing
+#define powerOn(s)
+#define powerOff(s)
+#define powerAdd(s, us)
+#endif // USE_POWER
+
+#endif /* USER_POWER_H_ */
@@ -0,0 +1,53 @@
+//
+// Lightweight zone profiler
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "profile.h"
+
+#ifdef PROFILE
+const char *szProfZone[PROF_COUNT] = {"ShowCur", "StrCust", "i2str", "GetSamp", "Wake", "Stats"};
+static PROFZONE zones[PROF_COUNT];
+
+void profileReset(void)
+{
+int i;
+
+	memset(zones, 0, sizeof(zones));
+	for (i=0; i<PROF_COUNT; i++)
+		zones[i].u32Min = 0xffffffff;
+} /* profileReset() */
+
+void profileAdd(int iZone, uint32_t u32Ticks)
+{
+PROFZONE *pZone = &zones[iZone];
+
+	u32Ticks /= (SystemCoreClock / 8000000); // SysTick runs at HCLK/8
+	pZone->u32Count++;
+	pZone->u32Total += u32Ticks;
+	if (u32Ticks < pZone->u32Min) pZone->u32Min = u32Ticks;
+	if (u32Ticks > pZone->u32Max) pZone->u32Max = u32Ticks;
+} /* profileAdd() */
+
+const PROFZONE *profileGet(int iZone)
+{
+	return &zones[iZone];
+} /* profileGet() */
+#endif // PROFILE
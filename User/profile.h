@@ -0,0 +1,67 @@
+//
+// Lightweight zone profiler
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_PROFILE_H_
+#define USER_PROFILE_H_
+
+// Uncomment to collect timing for the zones below; with it commented
+// out the macros are empty and the table isn't compiled in.
+//#define PROFILE
+
+// Profiled zones
+enum
+{
+	PROF_SHOWCURRENT=0,
+	PROF_WRITESTRING,
+	PROF_I2STR,
+	PROF_GETSAMPLE,
+	PROF_WAKE, // standby wake to ready
+	PROF_STATS, // statsAdd()
+	PROF_COUNT
+};
+
+#ifdef PROFILE
+#include <ch32v00x.h>
+
+// Time is measured in free-running SysTick ticks (HCLK/8), so a zone
+// costs two counter reads and a call to profileAdd(), which keeps it
+// in us so zones timed at different core clocks can be compared. A
+// zone must not span a clockSet() call.
+typedef struct tagProfZone
+{
+	uint32_t u32Count;
+	uint32_t u32Total;
+	uint32_t u32Min, u32Max;
+} PROFZONE;
+
+#define PROFILE_BEGIN(z) uint32_t u32Prof_##z = SysTick->CNT
+#define PROFILE_END(z) profileAdd(z, SysTick->CNT - u32Prof_##z)
+
+extern const char *szProfZone[];
+void profileReset(void);
+void profileAdd(int iZone, uint32_t u32Ticks);
+const PROFZONE *profileGet(int iZone);
+#else
+#define PROFILE_BEGIN(z)
+#define PROFILE_END(z)
+#endif // PROFILE
+
+#endif /* USER_PROFILE_H_ */
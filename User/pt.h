@@ -0,0 +1,67 @@
+//
+// Stackless protothreads
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Based on the idea of Adam Dunkels' protothreads
+//
+
+#ifndef USER_PT_H_
+#define USER_PT_H_
+
+// A protothread is a function which returns whenever it has to wait and
+// continues from the same spot the next time it's called. All of the
+// threads share the one C stack, so a thread costs just its PT (4 bytes)
+// instead of a stack of its own, which we can't afford with 2K of RAM.
+// The saved position is the source line of the wait (a switch case),
+// so switching to a thread is a call plus a jump through the switch:
+// ~14 cycles more than a plain task in the compiled MonitorThread (a
+// load and a compare per wait in it). The scheduler's pass around it
+// is in sched.h.
+// Local variables are NOT preserved across a wait; use statics.
+// A switch statement can't be used across a wait in a thread.
+
+typedef struct tagPT
+{
+	uint16_t u16LC; // where to continue (line number, 0 = start)
+	int8_t i8Task; // scheduler task running it
+} PT;
+
+// thread return values
+enum
+{
+	PT_WAITING=0,
+	PT_YIELDED,
+	PT_EXITED,
+	PT_ENDED
+};
+
+#define PT_THREAD(name_args) int name_args
+#define PT_INIT(pt) (pt)->u16LC = 0
+#define PT_BEGIN(pt) switch ((pt)->u16LC) { case 0:
+#define PT_END(pt) } (pt)->u16LC = 0; return PT_ENDED
+// Return now and continue here on the next call
+#define PT_YIELD(pt) do { (pt)->u16LC = __LINE__; return PT_YIELDED; case __LINE__: ; } while (0)
+// Return until the condition is true when called again; the scheduler
+// calls the thread on every pass until then (no standby meanwhile)
+#define PT_WAIT_UNTIL(pt, c) do { (pt)->u16LC = __LINE__; case __LINE__: if (!(c)) return PT_WAITING; } while (0)
+#define PT_EXIT(pt) do { (pt)->u16LC = 0; return PT_EXITED; } while (0)
+
+typedef int (PTFN)(PT *pt);
+
+#endif /* USER_PT_H_ */
@@ -0,0 +1,526 @@
+//
+// Hardware PWM for the LEDs and the vibration motor
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "power.h"
+#include "pwm.h"
+
+#ifdef USE_PWM
+typedef struct tagPwmChannel
+{
+	uint8_t u8Pin;
+	uint8_t u8Timer; // index into timers[]
+	uint8_t u8CC; // compare channel (0-3)
+	uint8_t u8Power; // power state for the accounting
+} PWMCHANNEL;
+
+typedef struct tagPwmTimer
+{
+	TIM_TypeDef *pTIM;
+	DMA_Channel_TypeDef *pDMA; // the one the update event requests
+	uint32_t u32DMAFlag; // its transfer complete flag
+	IRQn_Type iDMAIRQ, iUpdateIRQ;
+	uint16_t u16DefaultMs; // step for pwmWrite() when nothing is ramping
+} PWMTIMER;
+
+static const PWMCHANNEL channels[PWM_CHANNELS] = {
+	{LED_GREEN, 0, 2, POWER_LED},
+	{LED_RED, 0, 3, POWER_LED},
+	{MOTOR_PIN, 1, 0, POWER_MOTOR}
+};
+static const PWMTIMER timers[PWM_TIMERS] = {
+	{TIM1, DMA1_Channel5, DMA1_FLAG_TC5, DMA1_Channel5_IRQn, TIM1_UP_IRQn, PWM_LED_STEP_MS},
+	{TIM2, DMA1_Channel2, DMA1_FLAG_TC2, DMA1_Channel2_IRQn, TIM2_IRQn, PWM_MOTOR_STEP_MS}
+};
+static uint8_t u8Levels[PWM_CHANNELS]; // set by pwmWrite()
+static uint8_t u8Running; // timers which are set up (bit mask)
+static volatile uint8_t u8Ramping; // channels with a ramp playing (bit mask)
+static volatile uint8_t u8RampChannel[PWM_TIMERS]; // the one on each timer + 1 (0 = none)
+static uint16_t u16StepMs[PWM_TIMERS];
+
+void TIM1_UP_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void TIM2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void DMA1_Channel5_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void DMA1_Channel2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+static int pwmFind(uint8_t u8Pin)
+{
+int i;
+
+	for (i=0; i<PWM_CHANNELS; i++) {
+		if (channels[i].u8Pin == u8Pin)
+			return i;
+	}
+	return -1;
+} /* pwmFind() */
+
+static volatile uint32_t *pwmCompare(int iChannel)
+{
+	return &timers[channels[iChannel].u8Timer].pTIM->CH1CVR + channels[iChannel].u8CC;
+} /* pwmCompare() */
+
+//
+// Set the prescaler (and the TIM1 repetition count) so that one step
+// lasts u16StepMs at the current HCLK
+//
+static void pwmTiming(int iTimer)
+{
+TIM_TypeDef *pTIM = timers[iTimer].pTIM;
+uint32_t u32Ms = u16StepMs[iTimer], u32Reps = 1, u32Div;
+
+	if (iTimer == 0) { // LEDs need a carrier; repeat it for long steps
+		u32Reps = (u32Ms + PWM_LED_MAX_PERIOD_MS - 1) / PWM_LED_MAX_PERIOD_MS;
+		if (u32Reps > 256) u32Reps = 256;
+		pTIM->RPTCR = (uint16_t)(u32Reps - 1);
+	}
+	u32Div = ((SystemCoreClock / 1000) * u32Ms) / (PWM_TOP * u32Reps);
+	if (u32Div == 0) u32Div = 1;
+	if (u32Div > 65536) u32Div = 65536;
+	pTIM->PSC = (uint16_t)(u32Div - 1);
+} /* pwmTiming() */
+
+//
+// Connect the timer to its pins and start it counting
+//
+static void pwmStartTimer(int iTimer)
+{
+const PWMTIMER *pTimer = &timers[iTimer];
+TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure = {0};
+TIM_OCInitTypeDef TIM_OCInitStructure = {0};
+GPIO_InitTypeDef GPIO_InitStructure = {0};
+int i;
+
+	if (u8Running & (1 << iTimer))
+		return;
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+	if (iTimer == 0) {
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, ENABLE);
+	} else {
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+		GPIO_PinRemapConfig(GPIO_PartialRemap1_TIM2, ENABLE); // CH1 -> PC5
+	}
+	TIM_TimeBaseStructure.TIM_Period = PWM_TOP - 1; // so that 255 is always on
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(pTimer->pTIM, &TIM_TimeBaseStructure);
+	TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
+	TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
+	TIM_OCInitStructure.TIM_OCPolarity = TIM_OCPolarity_High;
+	TIM_OCInitStructure.TIM_Pulse = 0;
+	// no compare preload, so a new level applies to the step it's written in
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_2MHz;
+	for (i=0; i<PWM_CHANNELS; i++) {
+		if (channels[i].u8Timer != iTimer) continue;
+		switch (channels[i].u8CC) {
+		case 0: TIM_OC1Init(pTimer->pTIM, &TIM_OCInitStructure); break;
+		case 1: TIM_OC2Init(pTimer->pTIM, &TIM_OCInitStructure); break;
+		case 2: TIM_OC3Init(pTimer->pTIM, &TIM_OCInitStructure); break;
+		case 3: TIM_OC4Init(pTimer->pTIM, &TIM_OCInitStructure); break;
+		}
+		GPIO_InitStructure.GPIO_Pin |= GPIO_Pin_0 << (channels[i].u8Pin & 0xf);
+	}
+	GPIO_Init(GPIOC, &GPIO_InitStructure); // all of them are on port C
+	TIM_CtrlPWMOutputs(pTimer->pTIM, ENABLE); // TIM1 needs MOE
+	pwmTiming(iTimer);
+	TIM_GenerateEvent(pTimer->pTIM, TIM_EventSource_Update); // load PSC and RPTCR
+	TIM_ClearFlag(pTimer->pTIM, TIM_FLAG_Update);
+	NVIC_EnableIRQ(pTimer->iDMAIRQ);
+	NVIC_EnableIRQ(pTimer->iUpdateIRQ);
+	TIM_Cmd(pTimer->pTIM, ENABLE);
+	u8Running |= (1 << iTimer);
+} /* pwmStartTimer() */
+
+//
+// Stop the timer and give the pins back to the GPIO, driven low
+//
+static void pwmStopTimer(int iTimer)
+{
+const PWMTIMER *pTimer = &timers[iTimer];
+int i;
+
+	TIM_Cmd(pTimer->pTIM, DISABLE);
+	DMA_Cmd(pTimer->pDMA, DISABLE);
+	for (i=0; i<PWM_CHANNELS; i++) {
+		if (channels[i].u8Timer != iTimer) continue;
+		pinMode(channels[i].u8Pin, OUTPUT);
+		digitalWrite(channels[i].u8Pin, 0);
+	}
+	if (iTimer == 0) {
+		RCC_APB2PeriphResetCmd(RCC_APB2Periph_TIM1, ENABLE);
+		RCC_APB2PeriphResetCmd(RCC_APB2Periph_TIM1, DISABLE);
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, DISABLE);
+	} else {
+		GPIO_PinRemapConfig(GPIO_PartialRemap1_TIM2, DISABLE);
+		RCC_APB1PeriphResetCmd(RCC_APB1Periph_TIM2, ENABLE);
+		RCC_APB1PeriphResetCmd(RCC_APB1Periph_TIM2, DISABLE);
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, DISABLE);
+	}
+	u8Running &= ~(1 << iTimer);
+	if (u8Running == 0)
+		RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, DISABLE);
+} /* pwmStopTimer() */
+
+//
+// Turn the output off at the end of a ramp
+// (called from the interrupt handlers)
+//
+static void pwmRampDone(int iTimer)
+{
+int iChannel = u8RampChannel[iTimer] - 1;
+
+	timers[iTimer].pTIM->DMAINTENR &= ~(TIM_UIE | TIM_UDE);
+	if (iChannel >= 0) {
+		*pwmCompare(iChannel) = 0;
+		u8Ramping &= ~(1 << iChannel);
+		u8RampChannel[iTimer] = 0;
+	}
+} /* pwmRampDone() */
+
+//
+// The last level has been written; it plays until the next update
+//
+static void pwmDMADone(int iTimer)
+{
+const PWMTIMER *pTimer = &timers[iTimer];
+
+	DMA_ClearFlag(pTimer->u32DMAFlag);
+	DMA_Cmd(pTimer->pDMA, DISABLE);
+	TIM_ClearFlag(pTimer->pTIM, TIM_FLAG_Update);
+	pTimer->pTIM->DMAINTENR = (pTimer->pTIM->DMAINTENR & ~TIM_UDE) | TIM_UIE;
+} /* pwmDMADone() */
+
+void DMA1_Channel5_IRQHandler(void)
+{
+	pwmDMADone(0);
+} /* DMA1_Channel5_IRQHandler() */
+
+void DMA1_Channel2_IRQHandler(void)
+{
+	pwmDMADone(1);
+} /* DMA1_Channel2_IRQHandler() */
+
+void TIM1_UP_IRQHandler(void)
+{
+	TIM_ClearFlag(TIM1, TIM_FLAG_Update);
+	pwmRampDone(0);
+} /* TIM1_UP_IRQHandler() */
+
+void TIM2_IRQHandler(void)
+{
+	TIM_ClearFlag(TIM2, TIM_FLAG_Update);
+	pwmRampDone(1);
+} /* TIM2_IRQHandler() */
+
+//
+// Stop a ramp early; the output goes off
+//
+void pwmCancel(uint8_t u8Pin)
+{
+int iChannel = pwmFind(u8Pin);
+int iTimer;
+
+	if (iChannel < 0 || !(u8Ramping & (1 << iChannel)))
+		return;
+	iTimer = channels[iChannel].u8Timer;
+	__disable_irq();
+	DMA_Cmd(timers[iTimer].pDMA, DISABLE);
+	DMA_ClearFlag(timers[iTimer].u32DMAFlag);
+	pwmRampDone(iTimer);
+	__enable_irq();
+	pwmRelease();
+} /* pwmCancel() */
+
+//
+// Set a steady level (0 = off)
+//
+void pwmWrite(uint8_t u8Pin, uint8_t u8Level)
+{
+int i, iChannel = pwmFind(u8Pin);
+int iTimer;
+
+	if (iChannel < 0)
+		return;
+	pwmCancel(u8Pin);
+	iTimer = channels[iChannel].u8Timer;
+	u8Levels[iChannel] = u8Level;
+	if (u8Level) {
+		if (!(u8Running & (1 << iTimer)))
+			u16StepMs[iTimer] = timers[iTimer].u16DefaultMs;
+		pwmStartTimer(iTimer);
+		*pwmCompare(iChannel) = u8Level;
+		powerOn(channels[iChannel].u8Power);
+	} else {
+		if (u8Running & (1 << iTimer))
+			*pwmCompare(iChannel) = 0;
+		for (i=0; i<PWM_CHANNELS; i++) {
+			if (u8Levels[i] && channels[i].u8Power == channels[iChannel].u8Power)
+				break;
+		}
+		if (i == PWM_CHANNELS) // the last one using that power state
+			powerOff(channels[iChannel].u8Power);
+		pwmRelease();
+	}
+} /* pwmWrite() */
+
+//
+// Play iCount levels, iStepMs each, then turn the output off
+// It doesn't wait; each timer has one DMA request, so a ramp replaces
+// the one playing on the other LED. The table must stay valid until
+// it's done.
+//
+void pwmRamp(uint8_t u8Pin, const uint8_t *pLevels, int iCount, int iStepMs)
+{
+int i, iChannel = pwmFind(u8Pin);
+int iTimer;
+const PWMTIMER *pTimer;
+uint32_t u32Sum = 0;
+
+	if (iChannel < 0 || iCount <= 0)
+		return;
+	iTimer = channels[iChannel].u8Timer;
+	pTimer = &timers[iTimer];
+	if (u8RampChannel[iTimer]) // stop the one on this timer
+		pwmCancel(channels[u8RampChannel[iTimer] - 1].u8Pin);
+	if (u8Levels[iChannel])
+		pwmWrite(u8Pin, 0);
+	if (iStepMs < 1) iStepMs = 1;
+	u16StepMs[iTimer] = (uint16_t)iStepMs;
+	if (u8Running & (1 << iTimer))
+		pwmTiming(iTimer);
+	else
+		pwmStartTimer(iTimer);
+	// the level is taken to scale the current
+	for (i=0; i<iCount; i++)
+		u32Sum += pLevels[i];
+	powerAdd(channels[iChannel].u8Power, (uint32_t)(((uint64_t)u32Sum * iStepMs * 1000) / PWM_TOP));
+
+	__disable_irq();
+	// restart the step so that the first level gets all of it
+	TIM_GenerateEvent(pTimer->pTIM, TIM_EventSource_Update);
+	TIM_ClearFlag(pTimer->pTIM, TIM_FLAG_Update);
+	*pwmCompare(iChannel) = pLevels[0];
+	u8RampChannel[iTimer] = (uint8_t)(iChannel + 1);
+	u8Ramping |= (1 << iChannel);
+	if (iCount == 1) { // nothing to transfer; just end it
+		pTimer->pTIM->DMAINTENR |= TIM_UIE;
+	} else {
+		pTimer->pDMA->CFGR = 0;
+		pTimer->pDMA->PADDR = (uint32_t)pwmCompare(iChannel);
+		pTimer->pDMA->MADDR = (uint32_t)&pLevels[1];
+		pTimer->pDMA->CNTR = (uint32_t)(iCount - 1);
+		DMA_ClearFlag(pTimer->u32DMAFlag);
+		// bytes out to the 16-bit register, one per update
+		pTimer->pDMA->CFGR = DMA_DIR_PeripheralDST | DMA_MemoryInc_Enable |
+			DMA_PeripheralDataSize_HalfWord | DMA_MemoryDataSize_Byte |
+			DMA_Priority_Low | DMA_IT_TC | DMA_CFGR1_EN;
+		pTimer->pTIM->DMAINTENR |= TIM_UDE;
+	}
+	__enable_irq();
+} /* pwmRamp() */
+
+//
+// Returns non-zero while a ramp plays on the pin (PWM_ANY = any pin)
+//
+int pwmBusy(uint8_t u8Pin)
+{
+int iChannel;
+
+	if (u8Pin == PWM_ANY)
+		return (u8Ramping != 0);
+	iChannel = pwmFind(u8Pin);
+	return (iChannel >= 0 && (u8Ramping & (1 << iChannel)));
+} /* pwmBusy() */
+
+//
+// Sleep until the ramp on the pin is done
+//
+void pwmWait(uint8_t u8Pin)
+{
+	while (pwmBusy(u8Pin)) {
+		__disable_irq(); // so that the end can't slip in before the WFI
+		if (pwmBusy(u8Pin))
+			__WFI(); // the pending interrupt still wakes it
+		__enable_irq();
+	}
+	pwmRelease();
+} /* pwmWait() */
+
+//
+// Stop the timers which have nothing left to do
+//
+void pwmRelease(void)
+{
+int i, iTimer;
+
+	for (iTimer=0; iTimer<PWM_TIMERS; iTimer++) {
+		if (!(u8Running & (1 << iTimer)))
+			continue;
+		for (i=0; i<PWM_CHANNELS; i++) {
+			if (channels[i].u8Timer == iTimer && (u8Levels[i] || (u8Ramping & (1 << i))))
+				break;
+		}
+		if (i == PWM_CHANNELS)
+			pwmStopTimer(iTimer);
+	}
+} /* pwmRelease() */
+
+//
+// Returns non-zero if a timer is still running (standby would stop it)
+//
+int pwmActive(void)
+{
+	pwmRelease();
+	return (u8Running != 0);
+} /* pwmActive() */
+
+//
+// Keep the step times after a core clock change
+//
+void pwmRetune(void)
+{
+int iTimer;
+
+	for (iTimer=0; iTimer<PWM_TIMERS; iTimer++) {
+		if (u8Running & (1 << iTimer))
+			pwmTiming(iTimer);
+	}
+} /* pwmRetune() */
+#else
+//
+// Without the timers the outputs are simply on or off; a ramp turns
+// its output on (if any of the levels is) and it goes off at the first
+// call here after the ramp's time is up. The scheduler doesn't use
+// standby while one is on, so the alert task gets to end it on time.
+//
+static uint8_t u8On; // channels which are on (bit mask)
+static uint8_t u8Ramping; // the ones with a ramp playing
+static uint32_t u32End[PWM_CHANNELS]; // millis() when each ramp is done
+
+static const uint8_t u8ChannelPins[PWM_CHANNELS] = {LED_GREEN, LED_RED, MOTOR_PIN};
+#ifdef USE_POWER
+static const uint8_t u8ChannelPower[PWM_CHANNELS] = {POWER_LED, POWER_LED, POWER_MOTOR};
+#endif
+
+static int pwmFind(uint8_t u8Pin)
+{
+int i;
+
+	for (i=0; i<PWM_CHANNELS; i++) {
+		if (u8ChannelPins[i] == u8Pin)
+			return i;
+	}
+	return -1;
+} /* pwmFind() */
+
+static void pwmSet(int iChannel, int bOn)
+{
+#ifdef USE_POWER
+int i;
+#endif
+
+	pinMode(u8ChannelPins[iChannel], OUTPUT);
+	digitalWrite(u8ChannelPins[iChannel], (uint8_t)bOn);
+	if (bOn)
+		u8On |= (1 << iChannel);
+	else
+		u8On &= ~(1 << iChannel);
+	u8Ramping &= ~(1 << iChannel);
+#ifdef USE_POWER
+	// the LEDs share a power state; it ends with the last one on
+	for (i=0; i<PWM_CHANNELS; i++) {
+		if ((u8On & (1 << i)) && u8ChannelPower[i] == u8ChannelPower[iChannel])
+			break;
+	}
+	if (bOn)
+		powerOn(u8ChannelPower[iChannel]);
+	else if (i == PWM_CHANNELS)
+		powerOff(u8ChannelPower[iChannel]);
+#endif
+} /* pwmSet() */
+
+//
+// Turn off the ramps whose time is up
+//
+void pwmRelease(void)
+{
+uint32_t u32Now = millis();
+int i;
+
+	for (i=0; i<PWM_CHANNELS; i++) {
+		if ((u8Ramping & (1 << i)) && (int32_t)(u32Now - u32End[i]) >= 0)
+			pwmSet(i, 0);
+	}
+} /* pwmRelease() */
+
+void pwmCancel(uint8_t u8Pin)
+{
+int iChannel = pwmFind(u8Pin);
+
+	if (iChannel >= 0 && (u8Ramping & (1 << iChannel)))
+		pwmSet(iChannel, 0);
+} /* pwmCancel() */
+
+void pwmWrite(uint8_t u8Pin, uint8_t u8Level)
+{
+int iChannel = pwmFind(u8Pin);
+
+	if (iChannel >= 0)
+		pwmSet(iChannel, (u8Level != 0));
+} /* pwmWrite() */
+
+void pwmRamp(uint8_t u8Pin, const uint8_t *pLevels, int iCount, int iStepMs)
+{
+int i, bOn = 0, iChannel = pwmFind(u8Pin);
+
+	if (iChannel < 0 || iCount <= 0)
+		return;
+	for (i=0; i<iCount; i++)
+		bOn |= (pLevels[i] != 0);
+	if (iStepMs < 1) iStepMs = 1;
+	pwmSet(iChannel, bOn);
+	u32End[iChannel] = millis() + (uint32_t)iCount * iStepMs;
+	u8Ramping |= (1 << iChannel);
+} /* pwmRamp() */
+
+int pwmBusy(uint8_t u8Pin)
+{
+int iChannel;
+
+	pwmRelease();
+	if (u8Pin == PWM_ANY)
+		return (u8Ramping != 0);
+	iChannel = pwmFind(u8Pin);
+	return (iChannel >= 0 && (u8Ramping & (1 << iChannel)));
+} /* pwmBusy() */
+
+void pwmWait(uint8_t u8Pin)
+{
+	while (pwmBusy(u8Pin)) {};
+} /* pwmWait() */
+
+int pwmActive(void)
+{
+	pwmRelease();
+	return (u8On != 0);
+} /* pwmActive() */
+#endif // USE_PWM
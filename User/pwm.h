@@ -0,0 +1,65 @@
+//
+// Hardware PWM for the LEDs and the vibration motor
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_PWM_H_
+#define USER_PWM_H_
+
+#include "config.h"
+
+// The LEDs and the motor happen to sit on timer outputs:
+// PC3 = TIM1 CH3 (green LED), PC4 = TIM1 CH4 (red LED) and
+// PC5 = TIM2 CH1 (motor, partial remap 1). A ramp is a table of levels,
+// one per step; the timer's update event requests a DMA transfer of the
+// next level into the compare register, so the CPU can sleep (WFI)
+// through the whole effect. The last step ends with an interrupt which
+// turns the output off. Standby stops the timers, so the scheduler
+// doesn't use it while an output is on.
+#define LED_GREEN 0xc3
+#define LED_RED 0xc4
+#define MOTOR_PIN 0xc5
+#define PWM_CHANNELS 3
+#define PWM_TIMERS 2
+// Levels are 0-255; 255 is fully on
+#define PWM_TOP 255
+// The LED carrier runs at 250Hz-1KHz and the TIM1 repetition counter
+// makes each step a whole number of carrier periods (steps up to ~1s)
+#define PWM_LED_MAX_PERIOD_MS 4
+#define PWM_LED_STEP_MS 1 // carrier for pwmWrite()
+// The motor is too slow to need a carrier; each step is one period with
+// the level setting the on time (steps up to ~350ms at 48MHz)
+#define PWM_MOTOR_STEP_MS 20
+// pwmBusy() on any pin
+#define PWM_ANY 0
+
+void pwmWrite(uint8_t u8Pin, uint8_t u8Level);
+void pwmRamp(uint8_t u8Pin, const uint8_t *pLevels, int iCount, int iStepMs);
+void pwmCancel(uint8_t u8Pin);
+int pwmBusy(uint8_t u8Pin);
+void pwmWait(uint8_t u8Pin);
+int pwmActive(void);
+void pwmRelease(void);
+#ifdef USE_PWM
+void pwmRetune(void);
+#else
+#define pwmRetune() // no timers to retune
+#endif
+
+#endif /* USER_PWM_H_ */
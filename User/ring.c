@@ -0,0 +1,81 @@
+//
+// Lock-free single producer, single consumer event ring
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "ring.h"
+
+//
+// Set up an empty ring using the caller's storage (iSize events,
+// a power of 2 up to 128)
+//
+void ringInit(RING *pRing, EVENT *pEvents, int iSize)
+{
+	pRing->pEvents = pEvents;
+	pRing->u8Mask = (uint8_t)(iSize - 1);
+	pRing->u8Head = pRing->u8Tail = 0;
+} /* ringInit() */
+
+//
+// Producer side; returns 0 if the ring is full (the event is dropped)
+//
+int ringPut(RING *pRing, uint8_t u8Type, uint8_t u8Code, uint16_t u16Value)
+{
+uint8_t u8Head = pRing->u8Head;
+EVENT *pEvent;
+
+	if (((u8Head - pRing->u8Tail) & 0xff) > pRing->u8Mask) // full
+		return 0;
+	pEvent = &pRing->pEvents[u8Head & pRing->u8Mask];
+	pEvent->u8Type = u8Type;
+	pEvent->u8Code = u8Code;
+	pEvent->u16Value = u16Value;
+	RING_BARRIER(); // the event must be written before it's published
+	pRing->u8Head = u8Head + 1;
+	return 1;
+} /* ringPut() */
+
+//
+// Consumer side; returns 0 if the ring is empty
+//
+int ringGet(RING *pRing, EVENT *pEvent)
+{
+uint8_t u8Tail = pRing->u8Tail;
+
+	if (u8Tail == pRing->u8Head)
+		return 0;
+	RING_BARRIER(); // don't read the event before seeing the new head
+	*pEvent = pRing->pEvents[u8Tail & pRing->u8Mask];
+	RING_BARRIER(); // finish reading it before giving the slot back
+	pRing->u8Tail = u8Tail + 1;
+	return 1;
+} /* ringGet() */
+
+int ringCount(RING *pRing)
+{
+	return (uint8_t)(pRing->u8Head - pRing->u8Tail);
+} /* ringCount() */
+
+//
+// Consumer side; drop everything queued so far
+//
+void ringFlush(RING *pRing)
+{
+	pRing->u8Tail = pRing->u8Head;
+} /* ringFlush() */
@@ -0,0 +1,66 @@
+//
+// Lock-free single producer, single consumer event ring
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_RING_H_
+#define USER_RING_H_
+
+// One side (usually an interrupt handler) only calls ringPut() and the
+// other side (the main loop) only calls ringGet(). Each index is written
+// by one side only, so neither side needs a critical section.
+// The CH32V003 has a single in-order hart and no data cache; the
+// interrupt sees memory exactly as the main loop left it, so the only
+// ordering needed is to keep the compiler from moving the event copy
+// past the index update.
+#define RING_BARRIER() __asm volatile ("" ::: "memory")
+
+// Event types
+enum
+{
+	EVENT_NONE=0,
+	EVENT_BUTTON, // u8Code = BUTTON_PRESS/RELEASE/LONG, u16Value = button | state<<8
+	EVENT_SENSOR_READY, // u16Value = CO2 ppm
+	EVENT_TIMER, // u8Code = timer number
+	EVENT_I2C_DONE, // u8Code = 0 for success
+	EVENT_COUNT
+};
+
+typedef struct tagEvent
+{
+	uint8_t u8Type;
+	uint8_t u8Code;
+	uint16_t u16Value;
+} EVENT;
+
+typedef struct tagRing
+{
+	EVENT *pEvents;
+	uint8_t u8Mask; // size - 1; the size must be a power of 2
+	volatile uint8_t u8Head; // written by the producer only
+	volatile uint8_t u8Tail; // written by the consumer only
+} RING;
+
+void ringInit(RING *pRing, EVENT *pEvents, int iSize);
+int ringPut(RING *pRing, uint8_t u8Type, uint8_t u8Code, uint16_t u16Value);
+int ringGet(RING *pRing, EVENT *pEvent);
+int ringCount(RING *pRing);
+void ringFlush(RING *pRing);
+
+#endif /* USER_RING_H_ */
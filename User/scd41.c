@@ -19,12 +19,27 @@
 //
 #include <stdint.h>
 #include "scd41.h"
+#include "profile.h"
+#include "power.h"
 
-extern void Delay_Ms(int delay);
+extern void Delay_Ms(uint32_t n);
 extern void I2CWrite(uint8_t addr, uint8_t *pData, int iLen);
 extern void I2CRead(uint8_t addr, uint8_t *pData, int iLen);
 int _iPowerMode, _iTemperature, _iHumidity;
 uint16_t _iCO2;
+static int _bMeasuring; // a single shot was started by scd41_measure()
+
+//
+// Start a single shot measurement; the result is ready 5 seconds later
+// so the caller can sleep instead of waiting in scd41_getSample()
+//
+int scd41_measure(void)
+{
+    scd41_sendCMD(SCD41_CMD_SINGLE_SHOT_MEASUREMENT);
+    _bMeasuring = 1;
+    powerOn(POWER_SCD_PERIODIC); // the shot is one periodic measurement cycle
+    return SCD_SUCCESS;
+} /* scd41_measure() */
 
 int scd41_getSample(void)
 {
@@ -32,17 +47,25 @@ uint8_t ucTemp[16];
 uint16_t u16Status;
 int rc;
 
+    PROFILE_BEGIN(PROF_GETSAMPLE);
     if (_iPowerMode == SCD_POWERMODE_ONESHOT) {
-        scd41_sendCMD(SCD41_CMD_SINGLE_SHOT_MEASUREMENT);
-        Delay_Ms(5000); // wait for measurement to occur
+        if (!_bMeasuring) {
+            scd41_measure();
+            Delay_Ms(5000); // wait for measurement to occur
+        }
+        _bMeasuring = 0;
+        powerOff(POWER_SCD_PERIODIC);
     }
     rc = scd41_readRegister(SCD41_CMD_GET_DATA_READY_STATUS, &u16Status);
 //Serial.print("status = 0x"); Serial.println(u16Status, HEX);
-    if (rc != SCD_SUCCESS)
+    if (rc != SCD_SUCCESS) {
+	    PROFILE_END(PROF_GETSAMPLE);
 	    return rc;
+    }
 
     if ((u16Status & 0x07ff) == 0x0000) { // lower 11 bits == 0 -> data not ready
   //     Serial.println("data not ready!");
+       PROFILE_END(PROF_GETSAMPLE);
        return SCD_NOT_READY;
     }
     scd41_sendCMD(SCD41_CMD_READ_MEASUREMENT);
@@ -54,6 +77,7 @@ int rc;
     _iHumidity = ((uint16_t)ucTemp[6] << 8) | ucTemp[7];
     _iTemperature = -450 + ((_iTemperature) * 1750L / 65536L);
     _iHumidity = (_iHumidity * 1000L) / 65536L;
+    PROFILE_END(PROF_GETSAMPLE);
     return SCD_SUCCESS;
 } /* scd41_getSample() */
 
@@ -67,6 +91,8 @@ int scd41_stop(void)
 {
     if (scd41_sendCMD(SCD41_CMD_STOP_PERIODIC_MEASUREMENT) == SCD_SUCCESS) {
         Delay_Ms(500); // wait for it to execute
+        powerOff(POWER_SCD_PERIODIC);
+        powerOff(POWER_SCD_LOWPOWER);
         return SCD_SUCCESS;
     }
     return SCD_ERROR;
@@ -92,11 +118,15 @@ int scd41_start(int iPowerMode)
      _iPowerMode = iPowerMode;
      scd41_sendCMD2(SCD41_CMD_SET_AUTOMATIC_SELF_CALIBRATION_ENABLED, 1);
      Delay_Ms(5);
-     if (iPowerMode == SCD_POWERMODE_NORMAL)
+     powerOff(POWER_SCD_PERIODIC);
+     powerOff(POWER_SCD_LOWPOWER);
+     if (iPowerMode == SCD_POWERMODE_NORMAL) {
         scd41_sendCMD(SCD41_CMD_START_PERIODIC_MEASUREMENT);
-     else if (iPowerMode == SCD_POWERMODE_LOW)
+        powerOn(POWER_SCD_PERIODIC);
+     } else if (iPowerMode == SCD_POWERMODE_LOW) {
         scd41_sendCMD(SCD41_CMD_START_LP_PERIODIC_MEASUREMENT);
-     else // single shot is essentially "stopped"
+        powerOn(POWER_SCD_LOWPOWER);
+     } else // single shot is essentially "stopped"
         scd41_sendCMD(SCD41_CMD_STOP_PERIODIC_MEASUREMENT);
      Delay_Ms(1);
      return SCD_SUCCESS;
@@ -52,6 +52,7 @@ int scd41_sendCMD2(uint16_t u16Cmd, uint16_t u16Parameter);
 uint8_t scd41_computeCRC8(uint8_t *data, uint8_t len);
 int scd41_start(int iPowerMode);
 int scd41_getSample(void);
+int scd41_measure(void); // SCD41 only
 int scd41_shutdown(void); // SCD41 only
 int scd41_stop(void);
 int scd41_recalibrate(uint16_t u16CO2);
@@ -0,0 +1,272 @@
+//
+// Cooperative tickless task scheduler
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "config.h"
+#include "sched.h"
+#include "lsi.h"
+#include "pwm.h"
+
+static TASK tasks[SCHED_MAX_TASKS];
+static int iTaskCount, bExit, bStandby, bSuspended, bSignalTasks;
+static volatile int bSignaled;
+static uint32_t u32Start, u32StandbyMs;
+
+//
+// Start a new task list
+// bStandby allows the AWU standby (it disconnects the debugger)
+//
+void schedInit(int bAllowStandby)
+{
+	memset(tasks, 0, sizeof(tasks));
+	iTaskCount = 0;
+	bSignalTasks = 0;
+	bSignaled = 0;
+	bStandby = bAllowStandby;
+	bSuspended = 0;
+	u32Start = millis();
+	u32StandbyMs = 0;
+} /* schedInit() */
+
+//
+// Add a task which first runs after iDelay ms and then every iPeriod ms
+// A period of 0 runs it once; a negative delay adds it stopped.
+// Returns the task number or -1 if the table is full
+//
+int schedAdd(TASKFN *pfnTask, int iPeriod, int iDelay)
+{
+TASK *pTask;
+
+	if (iTaskCount == SCHED_MAX_TASKS)
+		return -1;
+	pTask = &tasks[iTaskCount];
+	pTask->pfnTask = pfnTask;
+	pTask->u32Period = (uint32_t)iPeriod;
+	pTask->u32Next = millis() + iDelay;
+	pTask->bActive = (iDelay >= 0);
+	return iTaskCount++;
+} /* schedAdd() */
+
+//
+// Add a protothread which first runs after iDelay ms (negative = stopped)
+// It runs again when it wakes itself with PT_SLEEP() and stops when it
+// ends or exits.
+//
+int schedAddThread(PTFN *pfnThread, PT *pPT, int iDelay)
+{
+int i = schedAdd(NULL, 0, iDelay);
+
+	if (i >= 0) {
+		tasks[i].pfnThread = pfnThread;
+		tasks[i].pPT = pPT;
+		PT_INIT(pPT);
+		pPT->i8Task = (int8_t)i;
+	}
+	return i;
+} /* schedAddThread() */
+
+//
+// Add a task which runs every time schedSignal() is called; it can
+// also be given a deadline with schedWake() like a one-shot task
+//
+int schedOnSignal(TASKFN *pfnTask)
+{
+int i = schedAdd(pfnTask, 0, -1);
+
+	if (i >= 0) {
+		tasks[i].bSignal = 1;
+		bSignalTasks = 1;
+	}
+	return i;
+} /* schedOnSignal() */
+
+//
+// Called from an interrupt handler to run the signal tasks as soon as
+// possible; it ends a busy wait early and the interrupt itself ends
+// standby
+//
+void schedSignal(void)
+{
+	bSignaled = 1;
+} /* schedSignal() */
+
+//
+// (Re)start a task iDelay ms from now
+//
+void schedWake(int iTask, int iDelay)
+{
+	tasks[iTask].u32Next = millis() + iDelay;
+	tasks[iTask].bActive = 1;
+} /* schedWake() */
+
+int schedActive(int iTask)
+{
+	return tasks[iTask].bActive;
+} /* schedActive() */
+
+void schedStop(int iTask)
+{
+	tasks[iTask].bActive = 0;
+} /* schedStop() */
+
+//
+// Change the period; it takes effect after the next run
+//
+void schedSetPeriod(int iTask, int iPeriod)
+{
+	tasks[iTask].u32Period = (uint32_t)iPeriod;
+} /* schedSetPeriod() */
+
+//
+// Called from a task to make schedRun() return
+//
+void schedExit(void)
+{
+	bExit = 1;
+} /* schedExit() */
+
+//
+// Returns non-zero once after the CPU was in standby
+//
+int schedSuspended(void)
+{
+int i = bSuspended;
+
+	bSuspended = 0;
+	return i;
+} /* schedSuspended() */
+
+//
+// Fraction of the time since schedInit() spent in standby (0-1000)
+//
+int schedStandbyPermille(void)
+{
+uint32_t u32Elapsed = millis() - u32Start;
+
+	if (u32Elapsed == 0)
+		return 0;
+	return (int)(((uint64_t)u32StandbyMs * 1000) / u32Elapsed);
+} /* schedStandbyPermille() */
+
+//
+// Wait up to u32Wait ms; most of it is spent in standby and the
+// remainder is spent in a delay on the next pass. Standby would stop
+// the PWM timers, so while a ramp plays the CPU sleeps until the next
+// interrupt instead (the one at the end of the ramp, at the latest).
+//
+static void schedSleep(uint32_t u32Wait)
+{
+uint32_t u32Time = millis();
+
+#ifndef DEBUG_MODE
+	if (bStandby && u32Wait >= SCHED_MIN_STANDBY_MS && !pwmActive()) {
+		lsiUpdate(); // keep the standby timing accurate as the temperature changes
+		u32StandbyMs += StandbyFor(u32Wait); // 1.8mA running, 10uA standby
+		bSuspended = 1;
+	} else
+#endif
+#ifdef USE_PWM
+	if (pwmBusy(PWM_ANY)) {
+		__disable_irq(); // so that the end can't slip in before the WFI
+		if (pwmBusy(PWM_ANY) && !bSignaled)
+			__WFI();
+		__enable_irq();
+	} else
+#endif
+	{
+		while (!bSignaled && (millis() - u32Time) < u32Wait) {};
+	}
+} /* schedSleep() */
+
+static void schedDispatch(TASK *pTask)
+{
+int i;
+
+	if (pTask->pPT == NULL) {
+		(*pTask->pfnTask)();
+		return;
+	}
+	i = (*pTask->pfnThread)(pTask->pPT);
+	if (i >= PT_EXITED) {
+		pTask->bActive = 0; // the thread is done
+	} else if (i == PT_WAITING && !pTask->bActive) {
+		// PT_WAIT_UNTIL(); check the condition again on the next pass
+		pTask->u32Next = millis();
+		pTask->bActive = 1;
+	}
+} /* schedDispatch() */
+
+//
+// Run the tasks until one of them calls schedExit()
+// (or none are left active)
+//
+void schedRun(void)
+{
+int i;
+TASK *pTask;
+uint32_t u32Now, u32Wait, u32Due;
+int bSignal;
+
+	bExit = 0;
+	while (!bExit) {
+		u32Now = millis();
+		bSignal = bSignaled;
+		bSignaled = 0;
+		for (i=0; i<iTaskCount && !bExit; i++) {
+			pTask = &tasks[i];
+			if (!pTask->bActive || (int32_t)(u32Now - pTask->u32Next) < 0) {
+				if (bSignal && pTask->bSignal)
+					schedDispatch(pTask);
+				continue;
+			}
+			if (pTask->u32Period) {
+				pTask->u32Next += pTask->u32Period;
+				if ((int32_t)(u32Now - pTask->u32Next) >= 0) // fell behind, don't try to catch up
+					pTask->u32Next = u32Now + pTask->u32Period;
+			} else {
+				pTask->bActive = 0; // one-shot; it can wake itself again
+			}
+			schedDispatch(pTask);
+		}
+		if (bExit)
+			break;
+		// sleep until the nearest deadline
+		u32Now = millis();
+		u32Wait = 0xffffffff;
+		for (i=0; i<iTaskCount; i++) {
+			pTask = &tasks[i];
+			if (!pTask->bActive) continue;
+			u32Due = pTask->u32Next - u32Now;
+			if ((int32_t)u32Due < 0) u32Due = 0;
+			if (u32Due < u32Wait) u32Wait = u32Due;
+		}
+		if (u32Wait == 0xffffffff) { // nothing due
+			if (!bSignalTasks) // and nothing to wait for
+				break;
+			u32Wait = SCHED_IDLE_MS;
+		}
+		StandbyArm(); // a signal from here on also ends the standby
+		if (u32Wait && !bSignaled)
+			schedSleep(u32Wait);
+	}
+} /* schedRun() */
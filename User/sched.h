@@ -0,0 +1,91 @@
+//
+// Cooperative tickless task scheduler
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USER_SCHED_H_
+#define USER_SCHED_H_
+
+#include "pt.h"
+
+// Each mode registers a few timed tasks (sensor poll, UI refresh, alert
+// step, button scan) and calls schedRun(). After running whatever is due,
+// the scheduler stays in standby until the nearest deadline (StandbyFor
+// picks the AWU prescaler and chains sleeps), then finishes the last
+// fraction of a ms with a busy delay. With nothing due it only wakes
+// for an interrupt. host/sim_sched runs the modes on a simulated board;
+// over its default day of an office (make sim) the CPU is in standby
+// 99.2% of the time in continuous mode, 99.7% in low power mode and
+// 99.1% in stealth mode (where it stays out of standby while the motor
+// pulses). The first hour alone (sim_sched 1, make test) gives 99.1%,
+// 99.8% and 99.3%, before the CO2 has built up.
+// Tasks run to completion; they never block waiting for the next step,
+// they re-arm themselves with schedWake() instead. host/rvsim (make
+// profile) has a pass that runs one task at 228 cycles (28us at 8MHz,
+// two millis() reads included) and 27 more for each task that isn't
+// due. A task takes 20 bytes here and a thread 4 more for its PT; they
+// share the stack, 76 bytes of it under schedRun() before the task's
+// own. Interrupt handlers
+// call schedSignal() to run the signal tasks (e.g. button handling)
+// right away instead of on the next poll.
+#define SCHED_MAX_TASKS 6
+// Shorter waits aren't worth going into standby. host/rvsim (make
+// profile) has StandbyFor(3) awake for ~4000 cycles (0.5ms at 8MHz) to
+// set up the sleep and get back, 1700 of them (0.21ms) from the wake to
+// the return; the Wake profile zone times the restore on the board. At
+// 1.8mA that's what 0.5ms of busy waiting costs, and 2ms leaves room for
+// the HSI start-up, which the model doesn't count.
+#define SCHED_MIN_STANDBY_MS 2
+// How long to sleep when only signal tasks are waiting
+#define SCHED_IDLE_MS 3600000
+
+typedef void (TASKFN)(void);
+
+// A task is either a plain function or a protothread (pPT != NULL)
+typedef struct tagTask
+{
+	union {
+		TASKFN *pfnTask;
+		PTFN *pfnThread;
+	};
+	PT *pPT;
+	uint32_t u32Period; // ms between runs, 0 = run once when woken
+	uint32_t u32Next; // time it's due
+	uint8_t bActive;
+	uint8_t bSignal; // also runs on schedSignal()
+} TASK;
+
+// Let the scheduler run other tasks for ms milliseconds
+#define PT_SLEEP(pt, ms) do { schedWake((pt)->i8Task, ms); PT_YIELD(pt); } while (0)
+
+void schedInit(int bStandby);
+int schedAdd(TASKFN *pfnTask, int iPeriod, int iDelay);
+int schedOnSignal(TASKFN *pfnTask);
+int schedAddThread(PTFN *pfnThread, PT *pPT, int iDelay);
+void schedSignal(void);
+void schedWake(int iTask, int iDelay);
+void schedStop(int iTask);
+int schedActive(int iTask);
+void schedSetPeriod(int iTask, int iPeriod);
+void schedExit(void);
+void schedRun(void);
+int schedSuspended(void);
+int schedStandbyPermille(void);
+
+#endif /* USER_SCHED_H_ */
@@ -0,0 +1,199 @@
+//
+// Fixed point streaming statistics
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <stdint.h>
+#include <string.h>
+#include "stats.h"
+#include "profile.h"
+
+#ifdef USE_STATS
+static WELFORD co2Welford;
+static P2QUANT co2P50, co2P95;
+
+void welfordInit(WELFORD *pW)
+{
+	memset(pW, 0, sizeof(WELFORD));
+} /* welfordInit() */
+
+void welfordAdd(WELFORD *pW, int iVal)
+{
+int32_t i32Delta;
+
+	iVal <<= STATS_FRAC;
+	pW->i32Count++;
+	i32Delta = iVal - pW->i32Mean;
+	// rounded, not toward 0
+	pW->i32Mean += (i32Delta + ((i32Delta < 0) ? -pW->i32Count : pW->i32Count) / 2) / pW->i32Count;
+	pW->i64M2 += ((int64_t)i32Delta * (iVal - pW->i32Mean)) >> STATS_FRAC;
+} /* welfordAdd() */
+
+int welfordMean(WELFORD *pW)
+{
+	return (pW->i32Mean + (1 << (STATS_FRAC-1))) >> STATS_FRAC;
+} /* welfordMean() */
+
+//
+// Return the (sample) variance in whole units squared
+//
+int welfordVariance(WELFORD *pW)
+{
+	if (pW->i32Count < 2)
+		return 0;
+	return (int)((pW->i64M2 / (pW->i32Count - 1)) >> STATS_FRAC);
+} /* welfordVariance() */
+
+//
+// Integer square root (bit by bit, no multiply)
+//
+int isqrt(uint32_t u32)
+{
+uint32_t u32Root = 0, u32Bit = 1UL << 30;
+
+	while (u32Bit > u32)
+		u32Bit >>= 2;
+	while (u32Bit) {
+		if (u32 >= u32Root + u32Bit) {
+			u32 -= u32Root + u32Bit;
+			u32Root = (u32Root >> 1) + u32Bit;
+		} else {
+			u32Root >>= 1;
+		}
+		u32Bit >>= 2;
+	}
+	return (int)u32Root;
+} /* isqrt() */
+
+void p2Init(P2QUANT *pQ, int iPerMille)
+{
+	memset(pQ, 0, sizeof(P2QUANT));
+	pQ->u16P = (uint16_t)((iPerMille * 65535L) / 1000);
+} /* p2Init() */
+
+// desired position increment of marker i, 16-bit fraction
+static int32_t p2Increment(P2QUANT *pQ, int i)
+{
+	switch (i) {
+	case 1: return pQ->u16P >> 1;
+	case 2: return pQ->u16P;
+	case 3: return (65536 + pQ->u16P) >> 1;
+	case 4: return 65536;
+	}
+	return 0;
+} /* p2Increment() */
+
+void p2Add(P2QUANT *pQ, int iVal)
+{
+int i, k, d;
+int32_t *q = pQ->i32Q, *n = pQ->i32N;
+int32_t i32Q, i32Lag;
+int64_t i64T1, i64T2;
+
+	iVal <<= STATS_FRAC;
+	if (pQ->i32Count < 5) { // collect the first 5 in sorted order
+		for (i = pQ->i32Count; i > 0 && q[i-1] > iVal; i--)
+			q[i] = q[i-1];
+		q[i] = iVal;
+		n[pQ->i32Count] = pQ->i32Count;
+		pQ->i32Count++;
+		if (pQ->i32Count == 5) // wanted at 4 * the increment, they're at 1-3
+			for (i=1; i<4; i++)
+				pQ->i32Lag[i-1] = 4 * p2Increment(pQ, i) - (i << 16);
+		return;
+	}
+	// find the cell the new value lands in, extending the ends if needed
+	if (iVal < q[0]) {
+		q[0] = iVal;
+		k = 0;
+	} else if (iVal >= q[4]) {
+		q[4] = iVal;
+		k = 3;
+	} else {
+		for (k=0; k<3 && iVal >= q[k+1]; k++) {};
+	}
+	for (i=k+1; i<5; i++)
+		n[i]++;
+	pQ->i32Count++;
+	// move the middle markers toward their desired positions
+	for (i=1; i<4; i++) {
+		i32Lag = pQ->i32Lag[i-1] + p2Increment(pQ, i) - ((i > k) ? 65536 : 0);
+		if ((i32Lag >= 65536 && n[i+1] - n[i] > 1) || (i32Lag <= -65536 && n[i-1] - n[i] < -1)) {
+			d = (i32Lag > 0) ? 1 : -1;
+			// piecewise parabolic prediction
+			i64T1 = (int64_t)(n[i] - n[i-1] + d) * (q[i+1] - q[i]) / (n[i+1] - n[i]);
+			i64T2 = (int64_t)(n[i+1] - n[i] - d) * (q[i] - q[i-1]) / (n[i] - n[i-1]);
+			i32Q = q[i] + (int32_t)((d * (i64T1 + i64T2)) / (n[i+1] - n[i-1]));
+			if (i32Q <= q[i-1] || i32Q >= q[i+1]) // not monotonic, use linear
+				i32Q = q[i] + d * (q[i+d] - q[i]) / (n[i+d] - n[i]);
+			q[i] = i32Q;
+			n[i] += d;
+			i32Lag -= d * 65536;
+		}
+		pQ->i32Lag[i-1] = i32Lag;
+	}
+} /* p2Add() */
+
+int p2Get(P2QUANT *pQ)
+{
+int i;
+
+	if (pQ->i32Count == 0)
+		return 0;
+	if (pQ->i32Count < 5) { // not enough for the markers; use the nearest one
+		i = (int)(((pQ->i32Count - 1) * (int32_t)pQ->u16P + 32768) >> 16);
+		return pQ->i32Q[i] >> STATS_FRAC;
+	}
+	return (pQ->i32Q[2] + (1 << (STATS_FRAC-1))) >> STATS_FRAC;
+} /* p2Get() */
+
+void statsInit(void)
+{
+	welfordInit(&co2Welford);
+	p2Init(&co2P50, 500);
+	p2Init(&co2P95, 950);
+} /* statsInit() */
+
+void statsAdd(int iCO2)
+{
+	PROFILE_BEGIN(PROF_STATS);
+	welfordAdd(&co2Welford, iCO2);
+	p2Add(&co2P50, iCO2);
+	p2Add(&co2P95, iCO2);
+	PROFILE_END(PROF_STATS);
+} /* statsAdd() */
+
+int statsMean(void)
+{
+	return welfordMean(&co2Welford);
+} /* statsMean() */
+
+int statsStdDev(void)
+{
+	return isqrt((uint32_t)welfordVariance(&co2Welford));
+} /* statsStdDev() */
+
+int statsP50(void)
+{
+	return p2Get(&co2P50);
+} /* statsP50() */
+
+int statsP95(void)
+{
+	return p2Get(&co2P95);
+} /* statsP95() */
+#endif // USE_STATS
@@ -0,0 +1,83 @@
+//
+// Fixed point streaming statistics
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef USER_STATS_H_
+#define USER_STATS_H_
+
+#include "config.h"
+
+// The RV32EC core has no FPU, multiplier or divider, so everything is
+// integer with as few divides as possible. Values are kept with 12
+// fractional bits (Q12) so that the means don't get stuck on whole ppm
+// and the P-square markers can still move by the fraction of a ppm a
+// step they need after days of samples (40000ppm still fits in 31 bits).
+#define STATS_FRAC 12
+
+// Welford mean/variance of every sample since statsInit() (the session).
+// The mean takes a 32-bit divide per sample; the squared differences
+// are summed in Q12, which holds a month of samples 40000ppm from the
+// mean (64-bit M2), and the variance divide only runs for the display.
+typedef struct tagWelford
+{
+	int32_t i32Count;
+	int32_t i32Mean; // Q12
+	int64_t i64M2; // sum of squared differences, Q12
+} WELFORD;
+
+// P-square streaming quantile estimator (Jain & Chlamtac, 1985)
+// 5 markers track the min, p/2, p, (1+p)/2 quantiles and the max. Each
+// middle marker keeps how far it is behind its desired position instead
+// of multiplying it out of the count every sample (60 bytes). The cost
+// is in the 64-bit divides of a marker move. host/rvsim (make profile)
+// has statsAdd() (Welford and both quantiles) at ~4500 cycles on average
+// and 29000 at worst for a random 400-2000ppm stream, 0.6ms and 3.7ms at
+// 8MHz once per sample, with shift and subtract library divides; the
+// Stats profile zone gives it on the board.
+// host/test_stats
+// has it within 2ppm of the floating point algorithm; a week into the
+// simulated rooms it's within 7% of the exact P50/P95, but an office
+// that's empty half the time can have its P50 25% off for days.
+typedef struct tagP2
+{
+	int32_t i32Q[5]; // marker heights, Q12
+	int32_t i32N[5]; // marker positions (0 based)
+	int32_t i32Lag[3]; // desired - actual position of 1-3, 16-bit fraction
+	int32_t i32Count;
+	uint16_t u16P; // quantile, 16-bit fraction (65535 = 1.0)
+} P2QUANT;
+
+void welfordInit(WELFORD *pW);
+void welfordAdd(WELFORD *pW, int iVal);
+int welfordMean(WELFORD *pW);
+int welfordVariance(WELFORD *pW);
+void p2Init(P2QUANT *pQ, int iPerMille);
+void p2Add(P2QUANT *pQ, int iVal);
+int p2Get(P2QUANT *pQ);
+int isqrt(uint32_t u32);
+
+// CO2 statistics collected from the sample stream
+void statsInit(void);
+void statsAdd(int iCO2);
+int statsMean(void);
+int statsStdDev(void);
+int statsP50(void);
+int statsP95(void);
+
+#endif /* USER_STATS_H_ */
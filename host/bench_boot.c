@@ -0,0 +1,131 @@
+//
+// FLASH log boot (head search) benchmark
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "debug.h"
+#include "flashlog.h"
+#include "sim.h"
+#include "trace.h"
+
+// Built once for each log size (LOG_PAGES); writes the log into every
+// state boot can find it in (empty, partly full, wrapped at each page,
+// with the newest page torn by a power loss), checks that
+// flashlogInit() finds the right head and times it. The host time is
+// also given in page checks (CRCs of a page) to scale it to the target.
+#define TARGET_CHECK_US 400 // one page check at 8MHz (~3K cycles)
+#define REPEATS 2000
+
+uint16_t flashlogCRC16(const uint8_t *pData, int iLen);
+
+static TRACE trace;
+static int iErrors;
+
+static double Seconds(void)
+{
+struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+} /* Seconds() */
+
+//
+// Log until iPages pages have been written to FLASH since it was blank
+//
+static void Fill(int iPages)
+{
+int iValues[CODEC_CHANNELS];
+const LOGPAGE *pPage;
+
+	simFlashErase();
+	flashlogInit();
+	while (1) {
+		pPage = flashlogGetPage(0);
+		if (pPage && (int)pPage->u32Seq == iPages - 1)
+			break;
+		if (iPages == 0)
+			break;
+		traceRun(&trace, 160);
+		traceSample(&trace, iValues);
+		flashlogAdd(iValues[0], iValues[1], iValues[2]);
+	}
+} /* Fill() */
+
+//
+// Boot and check that the log continues from the right place
+//
+static double Boot(int iPages, uint32_t u32Newest)
+{
+const LOGPAGE *pPage;
+double d;
+int i;
+
+	d = Seconds();
+	for (i=0; i<REPEATS; i++)
+		flashlogInit();
+	d = (Seconds() - d) / REPEATS;
+	pPage = flashlogGetPage(0);
+	if (flashlogCount() != iPages || (iPages && (pPage == NULL || pPage->u32Seq != u32Newest))) {
+		printf("FAIL: %d pages (newest %u) found as %d (newest %d)\n", iPages, u32Newest,
+			flashlogCount(), pPage ? (int)pPage->u32Seq : -1);
+		iErrors++;
+	}
+	return d;
+} /* Boot() */
+
+int main(void)
+{
+int i, iWritten, iPages;
+double d, dCheck, dMax = 0, dLinear;
+const LOGPAGE *pPage;
+
+	simInit();
+	traceInit(&trace, TRACE_OFFICE, 1);
+	// what a single page check costs here
+	Fill(1);
+	pPage = flashlogGetPage(0);
+	d = Seconds();
+	for (i=0; i<REPEATS*100; i++)
+		iErrors += (flashlogCRC16((const uint8_t *)pPage, sizeof(LOGPAGE)-2) != pPage->u16CRC);
+	dCheck = (Seconds() - d) / (REPEATS*100);
+	// every way the head can sit: 0 .. 2 rounds of pages, intact and torn
+	for (iWritten=0; iWritten<=LOG_PAGES*2; iWritten++) {
+		Fill(iWritten);
+		d = Boot((iWritten < LOG_PAGES) ? iWritten : LOG_PAGES, iWritten - 1);
+		if (d > dMax) dMax = d;
+		if (iWritten < 2)
+			continue;
+		// the newest page was being rewritten when the power went
+		simFlashTear(LOG_START + ((iWritten-1) % LOG_PAGES) * LOG_PAGE_SIZE);
+		iPages = (iWritten <= LOG_PAGES) ? iWritten - 1 : LOG_PAGES - 1;
+		d = Boot(iPages, iWritten - 2);
+		if (d > dMax) dMax = d;
+	}
+	dLinear = dCheck * LOG_PAGES;
+	printf("%4d byte log (%3d pages): boot %.2f us on the host = %.1f page checks = ~%.1f ms at 8MHz; a linear scan takes %d (~%.1f ms)\n",
+		LOG_PAGES * LOG_PAGE_SIZE, LOG_PAGES, dMax * 1e6, dMax / dCheck, dMax / dCheck * TARGET_CHECK_US / 1000,
+		LOG_PAGES, dLinear / dCheck * TARGET_CHECK_US / 1000);
+	if (iErrors)
+		printf("FAILED\n");
+	return (iErrors != 0);
+} /* main() */
@@ -0,0 +1,145 @@
+//
+// Delta codec benchmark
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "debug.h"
+#include "history.h"
+#include "flashlog.h"
+#include "trace.h"
+
+// Encodes a week of each room into log pages the way flashlog.c does
+// (a new page and keyframe whenever one is full), decodes it again and
+// checks every value. Reports how many bytes a sample takes against the
+// 6 of the raw 16-bit values, for the 160 second block averages the log
+// really stores and for the raw 5 second samples, and the host time
+// to encode and decode a sample.
+#define DAYS 7
+#define RATE 5
+#define SAMPLES ((DAYS * 86400) / RATE)
+#define REPEATS 20
+
+static int iRaw[SAMPLES][CODEC_CHANNELS];
+static int iBlock[SAMPLES / HISTORY_BLOCK][CODEC_CHANNELS];
+static int iOut[SAMPLES][CODEC_CHANNELS];
+static uint8_t u8Pages[SAMPLES][LOG_DATA_SIZE]; // at most one page a sample
+static int iPageCount[SAMPLES];
+static int iErrors;
+
+static double Seconds(void)
+{
+struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+} /* Seconds() */
+
+// returns the number of pages used and the nibbles in them
+static int Encode(int (*pValues)[CODEC_CHANNELS], int iCount, int *pNibbles)
+{
+CODEC codec;
+int i, iPage = 0;
+
+	*pNibbles = 0;
+	codecInit(&codec, u8Pages[0], LOG_DATA_SIZE);
+	iPageCount[0] = 0;
+	for (i=0; i<iCount; i++) {
+		if (!codecEncode(&codec, pValues[i])) {
+			*pNibbles += codec.iPos;
+			codecInit(&codec, u8Pages[++iPage], LOG_DATA_SIZE);
+			iPageCount[iPage] = 0;
+			codecEncode(&codec, pValues[i]); // keyframe
+		}
+		iPageCount[iPage]++;
+	}
+	*pNibbles += codec.iPos;
+	return iPage + 1;
+} /* Encode() */
+
+static void Decode(int iPages)
+{
+CODEC codec;
+int i, j, k = 0;
+
+	for (i=0; i<iPages; i++) {
+		codecInit(&codec, u8Pages[i], LOG_DATA_SIZE);
+		for (j=0; j<iPageCount[i]; j++)
+			codecDecode(&codec, iOut[k++]);
+	}
+} /* Decode() */
+
+static void Run(int iKind, const char *szWhat, int (*pValues)[CODEC_CHANNELS], int iCount)
+{
+int i, iPages = 0, iNibbles = 0;
+double dEnc, dDec;
+
+	dEnc = Seconds();
+	for (i=0; i<REPEATS; i++)
+		iPages = Encode(pValues, iCount, &iNibbles);
+	dEnc = (Seconds() - dEnc) / REPEATS / iCount;
+	memset(iOut, 0, sizeof(iOut));
+	dDec = Seconds();
+	for (i=0; i<REPEATS; i++)
+		Decode(iPages);
+	dDec = (Seconds() - dDec) / REPEATS / iCount;
+	if (memcmp(iOut, pValues, iCount * sizeof(iOut[0])) != 0) {
+		printf("FAIL: %s %s doesn't decode as encoded\n", szTraceName[iKind], szWhat);
+		iErrors++;
+	}
+	printf("%-9s %-7s %7d %8.2f %6.2f:1 %9.1f %8.1f %8.1f\n", szTraceName[iKind], szWhat, iCount,
+		iNibbles / 2.0 / iCount, 6.0 * iCount * 2 / iNibbles, (double)iCount / iPages,
+		dEnc * 1e9, dDec * 1e9);
+} /* Run() */
+
+int main(void)
+{
+TRACE trace;
+int iKind, i, j, iBlocks = SAMPLES / HISTORY_BLOCK;
+int32_t i32Sum[CODEC_CHANNELS];
+
+	printf("codec: %d days at %ds, %d byte pages\n", DAYS, RATE, LOG_DATA_SIZE);
+	printf("trace     series    count  bytes/smp  vs raw  smp/page  enc ns  dec ns\n");
+	for (iKind=0; iKind<TRACE_COUNT; iKind++) {
+		traceInit(&trace, iKind, 99 + iKind);
+		for (i=0; i<SAMPLES; i++) {
+			traceRun(&trace, RATE);
+			traceSample(&trace, iRaw[i]);
+		}
+		// the same rounded averages history.c logs
+		for (i=0; i<iBlocks; i++) {
+			memset(i32Sum, 0, sizeof(i32Sum));
+			for (j=0; j<HISTORY_BLOCK; j++) {
+				i32Sum[0] += iRaw[i*HISTORY_BLOCK+j][0];
+				i32Sum[1] += iRaw[i*HISTORY_BLOCK+j][1];
+				i32Sum[2] += iRaw[i*HISTORY_BLOCK+j][2];
+			}
+			for (j=0; j<CODEC_CHANNELS; j++)
+				iBlock[i][j] = (i32Sum[j] + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT;
+		}
+		Run(iKind, "blocks", iBlock, iBlocks);
+		Run(iKind, "raw", iRaw, SAMPLES);
+	}
+	printf("%s\n", iErrors ? "FAILED" : "roundtrip ok");
+	return (iErrors != 0);
+} /* main() */
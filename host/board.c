@@ -0,0 +1,427 @@
+//
+// Simulated board
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <string.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "power.h"
+#include "lsi.h"
+#include "scd41.h"
+#include "sim.h"
+#include "board.h"
+
+static BOARDSENSOR *pfnBoardSensor;
+static uint8_t u8High[4]; // pin levels, ports A-D
+static uint64_t u64HighSince[4][8], u64HighUs[4][8];
+static int iI2CSpeed = 100000;
+static uint32_t u32I2CBytes;
+// the SCD41: what it's doing and what it will answer
+static int iScdInterval; // seconds between periodic measurements, 0 = idle
+static uint64_t u64ScdNext; // when the next measurement is done (0 = none)
+static int bScdReady, iScdValues[3];
+static uint16_t u16ScdCmd;
+static uint32_t u32Measurements;
+static volatile uint8_t bWokenEarly;
+static uint64_t u64StandbyUs;
+static uint32_t u32Standbys;
+// the real clocks: the firmware's time is in HCLK (HSI) microseconds,
+// the AWU ticks are real LSI clocks
+static uint32_t u32LSIHz = LSI_NOMINAL_HZ;
+static int iHSIppm; // how fast the HSI runs
+static uint64_t u64BoardStart;
+static double dStandbyRealUs; // what the sleeps really took
+// TIM1 capturing every 8th LSI edge (see lsi.c)
+static int bTimOn, bLSIRemap;
+static double dTimStart; // firmware us
+static uint32_t u32Capture; // the next capture
+
+//
+// Start over with the pins low, the sensor idle and nothing counted
+//
+void boardInit(BOARDSENSOR *pfnSensor)
+{
+	pfnBoardSensor = pfnSensor;
+	memset(u8High, 0, sizeof(u8High));
+	memset(u64HighUs, 0, sizeof(u64HighUs));
+	u32I2CBytes = 0;
+	iScdInterval = 0;
+	u64ScdNext = 0;
+	bScdReady = 0;
+	u32Measurements = 0;
+	u64StandbyUs = 0;
+	u32Standbys = 0;
+	u32LSIHz = LSI_NOMINAL_HZ;
+	iHSIppm = 0;
+	u64BoardStart = simMicros();
+	dStandbyRealUs = 0;
+	bTimOn = bLSIRemap = 0;
+} /* boardInit() */
+
+//
+// Set the real LSI frequency and the HSI error (parts per million,
+// positive = fast); they can change along the way, like with the
+// temperature
+//
+void boardClocks(uint32_t u32LSI, int iHSI)
+{
+	u32LSIHz = u32LSI;
+	iHSIppm = iHSI;
+} /* boardClocks() */
+
+//
+// The real time since boardInit(): awake, the firmware's time runs
+// with the HSI; in standby, it's whatever the AWU ticks took (us)
+//
+double boardRealUs(void)
+{
+	return (double)(simMicros() - u64BoardStart - u64StandbyUs) / (1.0 + iHSIppm / 1e6) + dStandbyRealUs;
+} /* boardRealUs() */
+
+uint64_t boardStandbyUs(void)
+{
+	return u64StandbyUs;
+} /* boardStandbyUs() */
+
+uint32_t boardStandbys(void)
+{
+	return u32Standbys;
+} /* boardStandbys() */
+
+//
+// Time a pin has been high since boardInit() (us)
+//
+uint64_t boardPinHighUs(uint8_t u8Pin)
+{
+int iPort = (u8Pin >> 4) - 0xa, iBit = u8Pin & 7;
+uint64_t u64 = u64HighUs[iPort][iBit];
+
+	if (u8High[iPort] & (1 << iBit))
+		u64 += simMicros() - u64HighSince[iPort][iBit];
+	return u64;
+} /* boardPinHighUs() */
+
+uint32_t boardI2CBytes(void)
+{
+	return u32I2CBytes;
+} /* boardI2CBytes() */
+
+uint32_t boardMeasurements(void)
+{
+	return u32Measurements;
+} /* boardMeasurements() */
+
+void pinMode(uint8_t u8Pin, int iMode)
+{
+	(void)u8Pin; (void)iMode;
+} /* pinMode() */
+
+// the buttons have pull-ups and nobody presses them
+uint8_t digitalRead(uint8_t u8Pin)
+{
+	(void)u8Pin;
+	return 1;
+} /* digitalRead() */
+
+void digitalWrite(uint8_t u8Pin, uint8_t u8Value)
+{
+int iPort = (u8Pin >> 4) - 0xa, iBit = u8Pin & 7;
+
+	if (u8Value && !(u8High[iPort] & (1 << iBit))) {
+		u8High[iPort] |= (1 << iBit);
+		u64HighSince[iPort][iBit] = simMicros();
+	} else if (!u8Value && (u8High[iPort] & (1 << iBit))) {
+		u8High[iPort] &= ~(1 << iBit);
+		u64HighUs[iPort][iBit] += simMicros() - u64HighSince[iPort][iBit];
+	}
+} /* digitalWrite() */
+
+//
+// Let the SCD41 finish the measurements which are due by now
+//
+static void boardScdUpdate(void)
+{
+	while (u64ScdNext && simMicros() >= u64ScdNext) {
+		(*pfnBoardSensor)(iScdValues);
+		bScdReady = 1;
+		u32Measurements++;
+		u64ScdNext = iScdInterval ? u64ScdNext + iScdInterval * 1000000ULL : 0;
+	}
+} /* boardScdUpdate() */
+
+static void boardScdCommand(uint16_t u16Cmd)
+{
+	boardScdUpdate();
+	u16ScdCmd = u16Cmd;
+	switch (u16Cmd) {
+	case SCD41_CMD_START_PERIODIC_MEASUREMENT:
+	case SCD41_CMD_START_LP_PERIODIC_MEASUREMENT:
+		iScdInterval = (u16Cmd == SCD41_CMD_START_PERIODIC_MEASUREMENT) ? 5 : 30;
+		u64ScdNext = simMicros() + iScdInterval * 1000000ULL;
+		break;
+	case SCD41_CMD_SINGLE_SHOT_MEASUREMENT:
+		iScdInterval = 0;
+		u64ScdNext = simMicros() + 5000000;
+		break;
+	case SCD41_CMD_STOP_PERIODIC_MEASUREMENT:
+	case SCD41_CMD_POWERDOWN:
+		iScdInterval = 0;
+		u64ScdNext = 0;
+		break;
+	}
+} /* boardScdCommand() */
+
+// a 16-bit word and its CRC, the way the SCD41 sends them
+static void boardScdWord(uint8_t *pData, uint16_t u16)
+{
+	pData[0] = (uint8_t)(u16 >> 8);
+	pData[1] = (uint8_t)u16;
+	pData[2] = scd41_computeCRC8(pData, 2);
+} /* boardScdWord() */
+
+static void boardScdRead(uint8_t *pData, int iLen)
+{
+uint8_t u8Out[9];
+
+	boardScdUpdate();
+	memset(u8Out, 0xff, sizeof(u8Out));
+	if (u16ScdCmd == SCD41_CMD_GET_DATA_READY_STATUS) {
+		boardScdWord(u8Out, bScdReady ? 0x8006 : 0x8000);
+	} else if (u16ScdCmd == SCD41_CMD_READ_MEASUREMENT) {
+		// raw values which the driver turns back into the same ones
+		boardScdWord(&u8Out[0], (uint16_t)iScdValues[0]);
+		boardScdWord(&u8Out[3], (uint16_t)(((iScdValues[1] + 450) * 65536L + 1749) / 1750));
+		boardScdWord(&u8Out[6], (uint16_t)((iScdValues[2] * 65536L + 999) / 1000));
+		bScdReady = 0;
+	}
+	memcpy(pData, u8Out, (iLen < 9) ? iLen : 9);
+} /* boardScdRead() */
+
+// a transfer: the address byte, the data and the start and stop
+static void boardI2CTime(int iLen)
+{
+	u32I2CBytes += iLen + 1;
+	simBusy((uint32_t)((((iLen + 1) * BOARD_I2C_BITS + 2) * 1000000ULL) / iI2CSpeed));
+} /* boardI2CTime() */
+
+void I2CInit(int iSpeed)
+{
+	iI2CSpeed = iSpeed;
+} /* I2CInit() */
+
+void I2CSetSpeed(int iSpeed)
+{
+	iI2CSpeed = iSpeed;
+} /* I2CSetSpeed() */
+
+void I2CWrite(uint8_t u8Addr, uint8_t *pData, int iLen)
+{
+	powerOn(POWER_I2C);
+	boardI2CTime(iLen);
+	if (u8Addr == BOARD_SCD_ADDR && iLen >= 2)
+		boardScdCommand(((uint16_t)pData[0] << 8) | pData[1]);
+	powerOff(POWER_I2C);
+} /* I2CWrite() */
+
+void I2CRead(uint8_t u8Addr, uint8_t *pData, int iLen)
+{
+	powerOn(POWER_I2C);
+	boardI2CTime(iLen);
+	if (u8Addr == BOARD_SCD_ADDR)
+		boardScdRead(pData, iLen);
+	else
+		memset(pData, 0, iLen);
+	powerOff(POWER_I2C);
+} /* I2CRead() */
+
+int I2CTest(uint8_t u8Addr)
+{
+	return (u8Addr == BOARD_SCD_ADDR || u8Addr == BOARD_OLED_ADDR);
+} /* I2CTest() */
+
+void StandbyWake(void)
+{
+	bWokenEarly = 1;
+} /* StandbyWake() */
+
+void StandbyArm(void)
+{
+	bWokenEarly = 0;
+} /* StandbyArm() */
+
+void StandbyPinMode(uint8_t u8Pin, int iMode)
+{
+	(void)u8Pin; (void)iMode;
+} /* StandbyPinMode() */
+
+// The AWU prescalers and StandbyFor() below follow Arduino.c, which
+// can't be built here; keep them in step with it
+static const uint16_t u16AWUDiv[] = {128, 256, 512, 1024, 2048, 4096, 10240, 61440};
+#define AWU_PRESCALERS (int)(sizeof(u16AWUDiv) / sizeof(uint16_t))
+#define AWU_10240 6
+#define AWU_MAX_WINDOW 63
+
+static uint32_t u32AWUTickUs = AWU_TICK_US; // one /10240 tick
+
+void StandbySetLSI(uint32_t u32Hz)
+{
+	u32AWUTickUs = (uint32_t)((10240ULL * 1000000) / u32Hz);
+} /* StandbySetLSI() */
+
+static uint32_t AWUTickUs(int iPrescaler)
+{
+	return (u32AWUTickUs * (u16AWUDiv[iPrescaler] >> 7)) / (10240 >> 7);
+} /* AWUTickUs() */
+
+//
+// Standby for u8Window ticks; the clock moves on by the time the
+// firmware thinks it slept, the way Tick_Advance() does on the board,
+// and boardRealUs() by the time it really took
+//
+static uint32_t StandbyTicks(int iPrescaler, uint8_t u8Window)
+{
+uint32_t u32Slept = 0;
+
+	if (!bWokenEarly) {
+		u32Slept = u8Window * AWUTickUs(iPrescaler);
+		u64StandbyUs += u32Slept;
+		dStandbyRealUs += (u8Window * u16AWUDiv[iPrescaler] * 1e6) / u32LSIHz;
+		u32Standbys++;
+	}
+	simBusy(BOARD_WAKE_US);
+	Tick_Advance(u32Slept);
+	powerAdd(POWER_STANDBY, u32Slept);
+	return u32Slept;
+} /* StandbyTicks() */
+
+void Standby82ms(uint8_t iTicks)
+{
+	StandbyArm();
+	StandbyTicks(AWU_10240, iTicks);
+} /* Standby82ms() */
+
+uint32_t StandbyFor(uint32_t u32Ms)
+{
+uint32_t u32SleptMs = 0, u32RemUs = 0, u32LeftUs, u32Ticks;
+int i;
+
+	while (!bWokenEarly && u32SleptMs < u32Ms) {
+		i = AWU_PRESCALERS-1;
+		u32Ticks = AWU_MAX_WINDOW;
+		if (u32Ms - u32SleptMs < (AWU_MAX_WINDOW * AWUTickUs(i)) / 1000) {
+			u32LeftUs = (u32Ms - u32SleptMs) * 1000;
+			for (i=0; i<AWU_PRESCALERS-1; i++) {
+				if (u32LeftUs / AWUTickUs(i) <= AWU_MAX_WINDOW)
+					break;
+			}
+			u32Ticks = u32LeftUs / AWUTickUs(i);
+			if (u32Ticks == 0) // less than the shortest tick left
+				break;
+		}
+		u32RemUs += StandbyTicks(i, (uint8_t)u32Ticks);
+		u32SleptMs += u32RemUs / 1000;
+		u32RemUs %= 1000;
+	}
+	return u32SleptMs;
+} /* StandbyFor() */
+
+// The LSI as TIM1 sees it: the period in firmware (HCLK) microseconds,
+// with the edges lined up from when the timer started
+static double boardCaptureUs(uint32_t u32)
+{
+	return dTimStart + 0.37 * (1e6 / u32LSIHz) + (u32 * 8.0 * 1e6 * (1.0 + iHSIppm / 1e6)) / u32LSIHz;
+} /* boardCaptureUs() */
+
+void RCC_LSICmd(FunctionalState NewState)
+{
+	(void)NewState;
+} /* RCC_LSICmd() */
+
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG)
+{
+	(void)RCC_FLAG;
+	return SET; // the LSI is always ready
+} /* RCC_GetFlagStatus() */
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{
+	(void)RCC_APB2Periph; (void)NewState;
+} /* RCC_APB2PeriphClockCmd() */
+
+void RCC_APB2PeriphResetCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{
+	if (RCC_APB2Periph & RCC_APB2Periph_TIM1)
+		bTimOn = 0;
+	(void)NewState;
+} /* RCC_APB2PeriphResetCmd() */
+
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState)
+{
+	if (GPIO_Remap == GPIO_Remap_LSI_CAL)
+		bLSIRemap = (NewState == ENABLE);
+} /* GPIO_PinRemapConfig() */
+
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+	(void)TIMx; (void)TIM_TimeBaseInitStruct;
+} /* TIM_TimeBaseInit() */
+
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct)
+{
+	(void)TIMx; (void)TIM_ICInitStruct;
+} /* TIM_ICInit() */
+
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState)
+{
+	(void)TIMx;
+	bTimOn = (NewState == ENABLE);
+	if (bTimOn) {
+		dTimStart = (double)simMicros();
+		u32Capture = 0;
+	}
+} /* TIM_Cmd() */
+
+// CC1 is set once the next capture has happened
+FlagStatus TIM_GetFlagStatus(TIM_TypeDef *TIMx, uint16_t TIM_FLAG)
+{
+	(void)TIMx; (void)TIM_FLAG;
+	if (!bTimOn || !bLSIRemap)
+		return RESET;
+	return (simMicros() >= boardCaptureUs(u32Capture)) ? SET : RESET;
+} /* TIM_GetFlagStatus() */
+
+// edges which already came go by without a capture being read
+void TIM_ClearFlag(TIM_TypeDef *TIMx, uint16_t TIM_FLAG)
+{
+	(void)TIMx; (void)TIM_FLAG;
+	while (bTimOn && simMicros() >= boardCaptureUs(u32Capture))
+		u32Capture++;
+} /* TIM_ClearFlag() */
+
+// the counter at the capture, in HCLKs since the timer started
+uint16_t TIM_GetCapture1(TIM_TypeDef *TIMx)
+{
+double dUs = boardCaptureUs(u32Capture) - dTimStart;
+
+	(void)TIMx;
+	u32Capture++;
+	return (uint16_t)(uint64_t)(dUs * (SystemCoreClock / 1e6));
+} /* TIM_GetCapture1() */
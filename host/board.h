@@ -0,0 +1,48 @@
+//
+// Simulated board
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef HOST_BOARD_H_
+#define HOST_BOARD_H_
+
+// What's around the CPU, for the simulators which run the scheduler:
+// Arduino.h on top of the simulated clock, with an I2C bus which takes
+// the time the bytes would (plus the SCD41 answering from a trace and
+// the OLED), pins which remember how long they were high, and standby
+// which sleeps in AWU ticks of the real LSI frequency. TIM1 can capture
+// the LSI edges for lsi.c.
+#define BOARD_WAKE_US 100 // standby exit, HSI start and the register restore
+#define BOARD_I2C_BITS 9 // per byte with the ACK
+#define BOARD_SCD_ADDR 0x62
+#define BOARD_OLED_ADDR 0x3c
+
+// Gives the CO2, temperature*10 and humidity*10 when the SCD41 measures
+typedef void (BOARDSENSOR)(int *pValues);
+
+void boardInit(BOARDSENSOR *pfnSensor);
+uint64_t boardStandbyUs(void);
+uint32_t boardStandbys(void);
+uint64_t boardPinHighUs(uint8_t u8Pin);
+uint32_t boardI2CBytes(void);
+uint32_t boardMeasurements(void);
+void boardClocks(uint32_t u32LSI, int iHSI);
+double boardRealUs(void);
+
+#endif /* HOST_BOARD_H_ */
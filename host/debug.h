@@ -0,0 +1,102 @@
+//
+// Host stand-in for Debug/debug.h
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __DEBUG_H
+#define __DEBUG_H
+
+// The portable modules include debug.h for the peripheral library; on
+// the host it declares just what they use, and the simulators implement
+// it on top of a simulated clock and FLASH
+#include <stdint.h>
+#include <stdio.h>
+
+#define FLASH_BASE 0x08000000UL
+#define FLASH_SIZE 0x4000
+
+void FLASH_Unlock_Fast(void);
+void FLASH_Lock_Fast(void);
+void FLASH_ErasePage_Fast(uint32_t u32Addr);
+void FLASH_BufReset(void);
+void FLASH_BufLoad(uint32_t u32Addr, uint32_t u32Data);
+void FLASH_ProgramPage_Fast(uint32_t u32Addr);
+
+// nothing else runs while the simulation does
+#define __disable_irq()
+#define __enable_irq()
+#define __WFI()
+
+extern uint32_t SystemCoreClock;
+
+void Delay_Init(void);
+void Delay_Us(uint32_t n);
+void Delay_Ms(uint32_t n);
+uint64_t Tick_Micros(void);
+void Tick_Advance(uint32_t n);
+
+// What lsi.c uses to capture the LSI with TIM1 (board.c models the
+// edges from the LSI and HSI frequencies it's given)
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} FunctionalState;
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef struct tagSIMTIM TIM_TypeDef;
+#define TIM1 ((TIM_TypeDef *)0x40012c00)
+
+typedef struct
+{
+	uint16_t TIM_Prescaler;
+	uint16_t TIM_CounterMode;
+	uint16_t TIM_Period;
+	uint16_t TIM_ClockDivision;
+	uint8_t TIM_RepetitionCounter;
+} TIM_TimeBaseInitTypeDef;
+
+typedef struct
+{
+	uint16_t TIM_Channel;
+	uint16_t TIM_ICPolarity;
+	uint16_t TIM_ICSelection;
+	uint16_t TIM_ICPrescaler;
+	uint16_t TIM_ICFilter;
+} TIM_ICInitTypeDef;
+
+#define RCC_APB2Periph_AFIO ((uint32_t)0x00000001)
+#define RCC_APB2Periph_TIM1 ((uint32_t)0x00000800)
+#define RCC_FLAG_LSIRDY ((uint8_t)0x61)
+#define GPIO_Remap_LSI_CAL ((uint32_t)0x00200080)
+#define TIM_CounterMode_Up ((uint16_t)0x0000)
+#define TIM_Channel_1 ((uint16_t)0x0000)
+#define TIM_ICPolarity_Rising ((uint16_t)0x0000)
+#define TIM_ICSelection_DirectTI ((uint16_t)0x0001)
+#define TIM_ICPSC_DIV8 ((uint16_t)0x000C)
+#define TIM_FLAG_CC1 ((uint16_t)0x0002)
+
+void RCC_LSICmd(FunctionalState NewState);
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG);
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void RCC_APB2PeriphResetCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState);
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState);
+FlagStatus TIM_GetFlagStatus(TIM_TypeDef *TIMx, uint16_t TIM_FLAG);
+void TIM_ClearFlag(TIM_TypeDef *TIMx, uint16_t TIM_FLAG);
+uint16_t TIM_GetCapture1(TIM_TypeDef *TIMx);
+
+#endif /* __DEBUG_H */
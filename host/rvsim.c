@@ -0,0 +1,583 @@
+//
+// RV32EC model for timing firmware functions
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <elf.h>
+#include "power.h"
+
+// Runs functions of the firmware ELF (the MounRiver build's
+// obj/Pocket_CO2.elf) instruction by instruction on a model of the
+// CH32V003, for the cycle counts and the charge the profile zones give
+// on the board, without one:
+//
+//   ./rvsim ELF [set SYM VALUE]... [call N FUNC [ARG]... ;]...
+//
+// A value or an argument is a number, &SYMBOL or LOW:HIGH (random).
+// Each call line runs FUNC N times and prints its cycles, the most stack
+// it used, the time at the clocks the RCC registers select (clockSet()
+// works), the I2C bytes and bus time, and the charge at the power.h
+// currents: the CPU at its clock for all of it (it polls the I2C) and
+// the I2C for the bus time. A wfi ends at once, and the cycles from the
+// last one to the return (the wake-up path) are printed too.
+// The timing is a model of the 2-stage QingKe V2A: 1 cycle per
+// instruction, 1 more for a load or a store, 2 more for a taken branch
+// or a jump (3 at 48MHz, with 1 FLASH wait state). The I2C runs at
+// 400kHz with a 1 byte buffer in front of the shift register. SysTick
+// counts at HCLK/8 and the other peripherals read back what was written,
+// with the RCC ready and switch status bits set.
+// with room for test builds linked with every option on
+#define FLASH_SIZE 0x10000
+#define RAM_SIZE 0x5000
+#define PERIPH_SIZE 0x30000
+#define RETURN_ADDR 0xfffffff0
+#define I2C_BYTE_US 22.5 // 9 bits at 400kHz
+#define I2C_START_US 11.25
+#define MAX_INSNS 200000000
+
+// register offsets from 0x40000000 (PERIPH_BASE) and 0xe0000000
+#define I2C1_CTLR1 0x5400
+#define I2C1_DATAR 0x5410
+#define I2C1_STAR1 0x5414
+#define I2C1_STAR2 0x5418
+#define RCC_CTLR 0x21000
+#define RCC_CFGR0 0x21004
+#define RCC_RSTSCKR 0x21024
+#define STK_CNT 0xf008
+
+static uint8_t u8Flash[FLASH_SIZE], u8Ram[RAM_SIZE], u8Periph[PERIPH_SIZE];
+static uint8_t u8Core[0x10000], u8Info[0x1000];
+static uint32_t u32Reg[16], u32PC, u32LowSP;
+static uint64_t u64Cycles, u64Insns, u64Wake; // u64Wake: cycles at the last wfi
+static int iMHz;
+static double dUs, dCharge; // time and CPU charge (uA*us)
+static double dTick; // SysTick count
+// I2C: the time the shift register is done, a byte waiting in DATAR
+static double dShiftEnd, dBusUs;
+static int bHeld;
+static uint32_t u32I2CBytes;
+static Elf32_Sym *pSyms;
+static int iSyms;
+static const char *szStrings;
+
+static uint32_t Bits(uint32_t u32, int iHigh, int iLow)
+{
+	return (u32 >> iLow) & ((1u << (iHigh - iLow + 1)) - 1);
+} /* Bits() */
+
+static int32_t SignExtend(uint32_t u32, int iBits)
+{
+	return (int32_t)(u32 << (32 - iBits)) >> (32 - iBits);
+} /* SignExtend() */
+
+static void Fail(const char *szMsg, uint32_t u32)
+{
+	fprintf(stderr, "rvsim: %s %08x at pc %08x\n", szMsg, u32, u32PC);
+	exit(2);
+} /* Fail() */
+
+static void ClockFromRCC(void)
+{
+uint32_t u32 = *(uint32_t *)&u8Periph[RCC_CFGR0];
+
+	if ((u32 & 3) == 2) // PLL: HSI * 2
+		iMHz = 48;
+	else // HSI with the AHB prescaler (1 or 3)
+		iMHz = ((u32 & 0xf0) == 0x20) ? 8 : 24;
+} /* ClockFromRCC() */
+
+static void I2CUpdate(void)
+{
+	if (bHeld && dUs >= dShiftEnd) { // into the shift register
+		dShiftEnd += I2C_BYTE_US;
+		dBusUs += I2C_BYTE_US;
+		bHeld = 0;
+	}
+} /* I2CUpdate() */
+
+static void I2CSend(double dBitsUs)
+{
+	I2CUpdate();
+	if (dUs >= dShiftEnd) {
+		dShiftEnd = dUs + dBitsUs;
+		dBusUs += dBitsUs;
+	} else {
+		bHeld = 1;
+	}
+} /* I2CSend() */
+
+static uint32_t PeriphRead(uint32_t u32Addr, int iSize)
+{
+uint32_t u32Off = u32Addr - 0x40000000, u32 = 0;
+
+	if (u32Addr >= 0xe0000000) {
+		u32Off = (u32Addr - 0xe0000000) & 0xfffc;
+		if (u32Off == STK_CNT)
+			return (uint32_t)dTick;
+		return *(uint32_t *)&u8Core[u32Off];
+	}
+	if (u32Off >= PERIPH_SIZE)
+		Fail("read", u32Addr);
+	switch (u32Off) {
+	case I2C1_STAR1: // SB, ADDR and RXNE always; TXE and BTF from the bus
+		I2CUpdate();
+		u32 = 0x43;
+		if (!bHeld)
+			u32 |= 0x80;
+		if (!bHeld && dUs >= dShiftEnd)
+			u32 |= 0x04;
+		return u32;
+	case I2C1_STAR2: // MSL, BUSY, TRA
+		return 7;
+	case RCC_CTLR: // HSIRDY, PLLRDY
+		return *(uint32_t *)&u8Periph[u32Off] | 0x02000002;
+	case RCC_RSTSCKR: // LSIRDY
+		return *(uint32_t *)&u8Periph[u32Off] | 2;
+	case RCC_CFGR0: // SWS follows SW
+		u32 = *(uint32_t *)&u8Periph[u32Off];
+		return (u32 & ~0xc) | ((u32 & 3) << 2);
+	}
+	memcpy(&u32, &u8Periph[u32Off], iSize);
+	return u32;
+} /* PeriphRead() */
+
+static void PeriphWrite(uint32_t u32Addr, uint32_t u32, int iSize)
+{
+uint32_t u32Off = u32Addr - 0x40000000;
+
+	if (u32Addr >= 0xe0000000) {
+		u32Off = u32Addr - 0xe0000000;
+		if (u32Off == STK_CNT)
+			dTick = u32;
+		if (u32Off < sizeof(u8Core))
+			memcpy(&u8Core[u32Off], &u32, iSize);
+		return;
+	}
+	if (u32Off >= PERIPH_SIZE)
+		Fail("write", u32Addr);
+	if (u32Off == I2C1_DATAR)
+		I2CSend(I2C_BYTE_US), u32I2CBytes++;
+	else if (u32Off == I2C1_CTLR1 && (u32 & 0x100)) // START
+		I2CSend(I2C_START_US);
+	memcpy(&u8Periph[u32Off], &u32, iSize);
+	if (u32Off == RCC_CFGR0)
+		ClockFromRCC();
+} /* PeriphWrite() */
+
+static uint8_t *Memory(uint32_t u32Addr)
+{
+	if (u32Addr < FLASH_SIZE)
+		return &u8Flash[u32Addr];
+	if (u32Addr - 0x08000000 < FLASH_SIZE) // alias of 0
+		return &u8Flash[u32Addr - 0x08000000];
+	if (u32Addr - 0x1ffff000 < sizeof(u8Info)) // boot/info area
+		return &u8Info[u32Addr - 0x1ffff000];
+	if (u32Addr - 0x20000000 < RAM_SIZE)
+		return &u8Ram[u32Addr - 0x20000000];
+	return NULL;
+} /* Memory() */
+
+static uint32_t Load(uint32_t u32Addr, int iSize)
+{
+uint8_t *p = Memory(u32Addr);
+uint32_t u32 = 0;
+
+	if (!p)
+		return PeriphRead(u32Addr, iSize);
+	memcpy(&u32, p, iSize);
+	return u32;
+} /* Load() */
+
+static void Store(uint32_t u32Addr, uint32_t u32, int iSize)
+{
+uint8_t *p = Memory(u32Addr);
+
+	if (!p) {
+		PeriphWrite(u32Addr, u32, iSize);
+		return;
+	}
+	if (u32Addr < 0x20000000)
+		Fail("write to FLASH", u32Addr);
+	memcpy(p, &u32, iSize);
+} /* Store() */
+
+//
+// 32-bit encodings, to expand the compressed instructions into
+//
+static uint32_t EncodeI(int32_t i32Imm, int iRs1, int iF3, int iRd, int iOp)
+{
+	return ((uint32_t)i32Imm << 20) | (iRs1 << 15) | (iF3 << 12) | (iRd << 7) | iOp;
+} /* EncodeI() */
+
+static uint32_t EncodeS(int32_t i32Imm, int iRs2, int iRs1)
+{
+	return (Bits(i32Imm, 11, 5) << 25) | (iRs2 << 20) | (iRs1 << 15) | (2 << 12) | (Bits(i32Imm, 4, 0) << 7) | 0x23;
+} /* EncodeS() */
+
+static uint32_t EncodeB(int32_t i32Imm, int iRs1, int iF3)
+{
+	return (Bits(i32Imm, 12, 12) << 31) | (Bits(i32Imm, 10, 5) << 25) | (iRs1 << 15) | (iF3 << 12) |
+		(Bits(i32Imm, 4, 1) << 8) | (Bits(i32Imm, 11, 11) << 7) | 0x63;
+} /* EncodeB() */
+
+static uint32_t EncodeJ(int32_t i32Imm, int iRd)
+{
+	return (Bits(i32Imm, 20, 20) << 31) | (Bits(i32Imm, 10, 1) << 21) | (Bits(i32Imm, 11, 11) << 20) |
+		(Bits(i32Imm, 19, 12) << 12) | (iRd << 7) | 0x6f;
+} /* EncodeJ() */
+
+static uint32_t EncodeR(int iF7, int iRs2, int iRs1, int iF3, int iRd)
+{
+	return (iF7 << 25) | (iRs2 << 20) | (iRs1 << 15) | (iF3 << 12) | (iRd << 7) | 0x33;
+} /* EncodeR() */
+
+static uint32_t Expand(uint32_t c)
+{
+int iF3 = c >> 13, iRd = Bits(c, 11, 7), iRs2 = Bits(c, 6, 2);
+int iRdP = 8 + Bits(c, 4, 2), iRs1P = 8 + Bits(c, 9, 7);
+int32_t i32Imm = SignExtend((Bits(c, 12, 12) << 5) | Bits(c, 6, 2), 6);
+
+	switch (((c & 3) << 3) | iF3) {
+	case 0x00: // c.addi4spn
+		return EncodeI((Bits(c, 12, 11) << 4) | (Bits(c, 10, 7) << 6) | (Bits(c, 6, 6) << 2) | (Bits(c, 5, 5) << 3), 2, 0, iRdP, 0x13);
+	case 0x02: // c.lw
+		return EncodeI((Bits(c, 12, 10) << 3) | (Bits(c, 6, 6) << 2) | (Bits(c, 5, 5) << 6), iRs1P, 2, iRdP, 0x03);
+	case 0x06: // c.sw
+		return EncodeS((Bits(c, 12, 10) << 3) | (Bits(c, 6, 6) << 2) | (Bits(c, 5, 5) << 6), iRdP, iRs1P);
+	case 0x08: // c.addi
+		return EncodeI(i32Imm, iRd, 0, iRd, 0x13);
+	case 0x09: // c.jal
+	case 0x0d: // c.j
+		i32Imm = SignExtend((Bits(c, 12, 12) << 11) | (Bits(c, 11, 11) << 4) | (Bits(c, 10, 9) << 8) | (Bits(c, 8, 8) << 10) |
+			(Bits(c, 7, 7) << 6) | (Bits(c, 6, 6) << 7) | (Bits(c, 5, 3) << 1) | (Bits(c, 2, 2) << 5), 12);
+		return EncodeJ(i32Imm, (iF3 == 1) ? 1 : 0);
+	case 0x0a: // c.li
+		return EncodeI(i32Imm, 0, 0, iRd, 0x13);
+	case 0x0b: // c.addi16sp, c.lui
+		if (iRd == 2)
+			return EncodeI(SignExtend((Bits(c, 12, 12) << 9) | (Bits(c, 6, 6) << 4) | (Bits(c, 5, 5) << 6) |
+				(Bits(c, 4, 3) << 7) | (Bits(c, 2, 2) << 5), 10), 2, 0, 2, 0x13);
+		return ((uint32_t)i32Imm << 12) | (iRd << 7) | 0x37;
+	case 0x0c: // c.srli, c.srai, c.andi, c.sub, c.xor, c.or, c.and
+		switch (Bits(c, 11, 10)) {
+		case 0: return EncodeI(i32Imm & 0x1f, iRs1P, 5, iRs1P, 0x13);
+		case 1: return EncodeI((i32Imm & 0x1f) | 0x400, iRs1P, 5, iRs1P, 0x13);
+		case 2: return EncodeI(i32Imm, iRs1P, 7, iRs1P, 0x13);
+		}
+		switch (Bits(c, 6, 5)) {
+		case 0: return EncodeR(0x20, iRdP, iRs1P, 0, iRs1P);
+		case 1: return EncodeR(0, iRdP, iRs1P, 4, iRs1P);
+		case 2: return EncodeR(0, iRdP, iRs1P, 6, iRs1P);
+		}
+		return EncodeR(0, iRdP, iRs1P, 7, iRs1P);
+	case 0x0e: // c.beqz
+	case 0x0f: // c.bnez
+		i32Imm = SignExtend((Bits(c, 12, 12) << 8) | (Bits(c, 11, 10) << 3) | (Bits(c, 6, 5) << 6) |
+			(Bits(c, 4, 3) << 1) | (Bits(c, 2, 2) << 5), 9);
+		return EncodeB(i32Imm, iRs1P, iF3 & 1);
+	case 0x10: // c.slli
+		return EncodeI(i32Imm & 0x1f, iRd, 1, iRd, 0x13);
+	case 0x12: // c.lwsp
+		return EncodeI((Bits(c, 12, 12) << 5) | (Bits(c, 6, 4) << 2) | (Bits(c, 3, 2) << 6), 2, 2, iRd, 0x03);
+	case 0x14: // c.jr, c.mv, c.ebreak, c.jalr, c.add
+		if (!Bits(c, 12, 12))
+			return iRs2 ? EncodeR(0, iRs2, 0, 0, iRd) : EncodeI(0, iRd, 0, 0, 0x67);
+		if (!iRs2)
+			return iRd ? EncodeI(0, iRd, 0, 1, 0x67) : 0x00100073;
+		return EncodeR(0, iRs2, iRd, 0, iRd);
+	case 0x16: // c.swsp
+		return EncodeS((Bits(c, 12, 9) << 2) | (Bits(c, 8, 7) << 6), iRs2, 2);
+	}
+	Fail("instruction", c);
+	return 0;
+} /* Expand() */
+
+static void SetReg(int iReg, uint32_t u32)
+{
+	if (iReg >= 16)
+		Fail("register", iReg);
+	if (iReg)
+		u32Reg[iReg] = u32;
+} /* SetReg() */
+
+static uint32_t GetReg(int iReg)
+{
+	if (iReg >= 16)
+		Fail("register", iReg);
+	return u32Reg[iReg];
+} /* GetReg() */
+
+static void Step(void)
+{
+uint32_t i = Load(u32PC, 2), u32Next, a, b, u32 = 0;
+int iExtra = 0, iTaken = 0, iF3, iRd, iRs1, iRs2;
+int32_t i32Imm;
+
+	if ((i & 3) != 3) {
+		i = Expand(i);
+		u32Next = u32PC + 2;
+	} else {
+		i = Load(u32PC, 4);
+		u32Next = u32PC + 4;
+	}
+	iF3 = Bits(i, 14, 12); iRd = Bits(i, 11, 7); iRs1 = Bits(i, 19, 15); iRs2 = Bits(i, 24, 20);
+	i32Imm = (int32_t)i >> 20;
+	switch (i & 0x7f) {
+	case 0x37: // lui
+		SetReg(iRd, i & 0xfffff000);
+		break;
+	case 0x17: // auipc
+		SetReg(iRd, u32PC + (i & 0xfffff000));
+		break;
+	case 0x6f: // jal
+		i32Imm = SignExtend((Bits(i, 31, 31) << 20) | (Bits(i, 19, 12) << 12) | (Bits(i, 20, 20) << 11) | (Bits(i, 30, 21) << 1), 21);
+		SetReg(iRd, u32Next);
+		u32Next = u32PC + i32Imm;
+		iTaken = 1;
+		break;
+	case 0x67: // jalr
+		a = GetReg(iRs1);
+		SetReg(iRd, u32Next);
+		u32Next = (a + i32Imm) & ~1u;
+		iTaken = 1;
+		break;
+	case 0x63: // branches
+		a = GetReg(iRs1); b = GetReg(iRs2);
+		switch (iF3) {
+		case 0: iTaken = (a == b); break;
+		case 1: iTaken = (a != b); break;
+		case 4: iTaken = ((int32_t)a < (int32_t)b); break;
+		case 5: iTaken = ((int32_t)a >= (int32_t)b); break;
+		case 6: iTaken = (a < b); break;
+		case 7: iTaken = (a >= b); break;
+		default: Fail("instruction", i);
+		}
+		if (iTaken)
+			u32Next = u32PC + SignExtend((Bits(i, 31, 31) << 12) | (Bits(i, 7, 7) << 11) | (Bits(i, 30, 25) << 5) | (Bits(i, 11, 8) << 1), 13);
+		break;
+	case 0x03: // loads
+		a = GetReg(iRs1) + i32Imm;
+		switch (iF3) {
+		case 0: u32 = SignExtend(Load(a, 1), 8); break;
+		case 1: u32 = SignExtend(Load(a, 2), 16); break;
+		case 2: u32 = Load(a, 4); break;
+		case 4: u32 = Load(a, 1); break;
+		case 5: u32 = Load(a, 2); break;
+		default: Fail("instruction", i);
+		}
+		SetReg(iRd, u32);
+		iExtra = 1;
+		break;
+	case 0x23: // stores
+		Store(GetReg(iRs1) + SignExtend((Bits(i, 31, 25) << 5) | iRd, 12), GetReg(iRs2), 1 << iF3);
+		iExtra = 1;
+		break;
+	case 0x13: // immediate ALU
+	case 0x33: // register ALU
+		a = GetReg(iRs1);
+		if (i & 0x20) {
+			if (i & 0x02000000)
+				Fail("instruction (no M extension)", i);
+			b = GetReg(iRs2);
+		} else {
+			b = (iF3 == 1 || iF3 == 5) ? (uint32_t)iRs2 : (uint32_t)i32Imm;
+		}
+		switch (iF3) {
+		case 0: u32 = ((i & 0x20) && (i & 0x40000000)) ? a - b : a + b; break;
+		case 1: u32 = a << (b & 31); break;
+		case 2: u32 = ((int32_t)a < (int32_t)b); break;
+		case 3: u32 = (a < b); break;
+		case 4: u32 = a ^ b; break;
+		case 5: u32 = (i & 0x40000000) ? (uint32_t)((int32_t)a >> (b & 31)) : a >> (b & 31); break;
+		case 6: u32 = a | b; break;
+		case 7: u32 = a & b; break;
+		}
+		SetReg(iRd, u32);
+		break;
+	case 0x0f: // fence
+		break;
+	case 0x73: // csr reads give 0 (interrupts stay off), wfi wakes at once
+		if (iF3)
+			SetReg(iRd, 0);
+		else if (i == 0x10500073)
+			u64Wake = u64Cycles + 1;
+		break;
+	default:
+		Fail("instruction", i);
+	}
+	if (iTaken)
+		iExtra = (iMHz == 48) ? 3 : 2;
+	u64Insns++;
+	u64Cycles += 1 + iExtra;
+	dUs += (1.0 + iExtra) / iMHz;
+	dTick += (1.0 + iExtra) / 8;
+	dCharge += (1.0 + iExtra) / iMHz * ((iMHz == 8) ? CURRENT_CPU_UA :
+		CURRENT_CPU_UA + ((iMHz == 24) ? CURRENT_CPU24_UA : CURRENT_CPU48_UA));
+	u32PC = u32Next;
+} /* Step() */
+
+static uint32_t Symbol(const char *szName)
+{
+int i;
+
+	for (i=0; i<iSyms; i++)
+		if (strcmp(szStrings + pSyms[i].st_name, szName) == 0)
+			return pSyms[i].st_value;
+	fprintf(stderr, "rvsim: no symbol %s\n", szName);
+	exit(2);
+} /* Symbol() */
+
+//
+// Load the segments (.data at its RAM address too, as the startup code
+// would copy it) and find the symbol table
+//
+static void LoadELF(const char *szName)
+{
+FILE *f = fopen(szName, "rb");
+uint8_t *pFile, *p;
+long lSize;
+Elf32_Ehdr *pHdr;
+Elf32_Phdr *pPhdr;
+Elf32_Shdr *pShdr;
+int i;
+
+	if (!f) {
+		perror(szName);
+		exit(2);
+	}
+	fseek(f, 0, SEEK_END);
+	lSize = ftell(f);
+	rewind(f);
+	pFile = malloc(lSize);
+	if (fread(pFile, 1, lSize, f) != (size_t)lSize)
+		exit(2);
+	fclose(f);
+	pHdr = (Elf32_Ehdr *)pFile;
+	pPhdr = (Elf32_Phdr *)(pFile + pHdr->e_phoff);
+	for (i=0; i<pHdr->e_phnum; i++) {
+		if (pPhdr[i].p_type != PT_LOAD || !pPhdr[i].p_filesz)
+			continue;
+		if ((p = Memory(pPhdr[i].p_vaddr)))
+			memcpy(p, pFile + pPhdr[i].p_offset, pPhdr[i].p_filesz);
+		if ((p = Memory(pPhdr[i].p_paddr)))
+			memcpy(p, pFile + pPhdr[i].p_offset, pPhdr[i].p_filesz);
+	}
+	pShdr = (Elf32_Shdr *)(pFile + pHdr->e_shoff);
+	for (i=0; i<pHdr->e_shnum; i++) {
+		if (pShdr[i].sh_type == SHT_SYMTAB) {
+			pSyms = (Elf32_Sym *)(pFile + pShdr[i].sh_offset);
+			iSyms = pShdr[i].sh_size / sizeof(Elf32_Sym);
+			szStrings = (const char *)(pFile + pShdr[pShdr[i].sh_link].sh_offset);
+		}
+	}
+} /* LoadELF() */
+
+static uint32_t Value(const char *sz)
+{
+int iLow, iHigh;
+
+	if (sz[0] == '&')
+		return Symbol(sz + 1);
+	if (sscanf(sz, "%d:%d", &iLow, &iHigh) == 2)
+		return iLow + rand() % (iHigh - iLow + 1);
+	return strtoul(sz, NULL, 0);
+} /* Value() */
+
+//
+// Run a function to its return; a0-a5 hold the arguments
+//
+static uint64_t Call(uint32_t u32Func, int iArgs, char **pArgs)
+{
+uint64_t u64Start = u64Cycles, u64End = u64Insns + MAX_INSNS;
+int i;
+
+	memset(u32Reg, 0, sizeof(u32Reg));
+	u32Reg[1] = RETURN_ADDR;
+	u32Reg[2] = Symbol("_eusrstack");
+	u32Reg[3] = Symbol("__global_pointer$");
+	for (i=0; i<iArgs && i<6; i++)
+		u32Reg[10 + i] = Value(pArgs[i]);
+	u32PC = u32Func;
+	while (u32PC != RETURN_ADDR) {
+		Step();
+		if (u32Reg[2] < u32LowSP)
+			u32LowSP = u32Reg[2];
+		if (u64Insns > u64End)
+			Fail("runaway", u32Func);
+	}
+	return u64Cycles - u64Start;
+} /* Call() */
+
+int main(int argc, char *argv[])
+{
+int i, j, iCount, iArgs;
+uint64_t u64, u64Min, u64Max, u64Total;
+double dStartUs, dStartCharge, dStartBus;
+uint32_t u32Bytes;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s ELF [set SYM VALUE]... [call N FUNC [ARG]... ;]...\n", argv[0]);
+		return 1;
+	}
+	LoadELF(argv[1]);
+	*(uint32_t *)&u8Periph[RCC_CFGR0] = 0x20; // as SystemInit() leaves it, HSI/3
+	ClockFromRCC();
+	for (i=2; i<argc; i++) {
+		if (strcmp(argv[i], "set") == 0 && i + 2 < argc) {
+			Store(Value(argv[i+1]), Value(argv[i+2]), 4);
+			i += 2;
+		} else if (strcmp(argv[i], "call") == 0 && i + 2 < argc) {
+			iCount = atoi(argv[i+1]);
+			for (iArgs = 0; i + 3 + iArgs < argc && strcmp(argv[i + 3 + iArgs], ";"); iArgs++) {};
+			u64Min = ~0ULL; u64Max = u64Total = 0;
+			dStartUs = dUs; dStartCharge = dCharge; dStartBus = dBusUs;
+			u32Bytes = u32I2CBytes;
+			u32LowSP = Symbol("_eusrstack");
+			u64Wake = 0;
+			for (j=0; j<iCount; j++) {
+				u64 = Call(Symbol(argv[i+2]), iArgs, &argv[i+3]);
+				if (u64 < u64Min) u64Min = u64;
+				if (u64 > u64Max) u64Max = u64;
+				u64Total += u64;
+			}
+			if (dUs < dShiftEnd) { // the last byte goes out while it polls
+				dCharge += (dShiftEnd - dUs) * CURRENT_CPU_UA;
+				dUs = dShiftEnd;
+			}
+			printf("%s: %llu/%.0f/%llu cycles (min/avg/max), %u bytes of stack, %.1fus, I2C %u bytes %.1fus, %.3fuC\n",
+				argv[i+2], (unsigned long long)u64Min, (double)u64Total / iCount, (unsigned long long)u64Max,
+				Symbol("_eusrstack") - u32LowSP,
+				(dUs - dStartUs) / iCount, (u32I2CBytes - u32Bytes) / iCount, (dBusUs - dStartBus) / iCount,
+				(dCharge - dStartCharge + (dBusUs - dStartBus) * CURRENT_I2C_UA) / iCount / 1e6);
+			if (u64Wake) // standby or sleep; what it took to get back
+				printf("  %llu cycles from the last wfi to the return\n", (unsigned long long)(u64Cycles - u64Wake));
+			i += 2 + iArgs;
+			if (i + 1 < argc && strcmp(argv[i+1], ";") == 0)
+				i++;
+		} else {
+			fprintf(stderr, "rvsim: unknown command %s\n", argv[i]);
+			return 1;
+		}
+	}
+	return 0;
+} /* main() */
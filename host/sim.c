@@ -0,0 +1,191 @@
+//
+// Simulated clock and FLASH for the host programs
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "sim.h"
+
+uint32_t SystemCoreClock = 8000000;
+
+static uint64_t u64Us; // the simulated time
+static uint8_t *pFlash; // FLASH_SIZE bytes at FLASH_BASE
+static uint32_t u32Erases[SIM_PAGES], u32Programs[SIM_PAGES];
+static uint32_t u32PageBuf[SIM_PAGE_SIZE/4];
+static int bUnlocked;
+
+//
+// Map the FLASH and start the clock at 0
+//
+void simInit(void)
+{
+	if (pFlash == NULL) {
+		pFlash = mmap((void *)FLASH_BASE, FLASH_SIZE, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (pFlash != (uint8_t *)FLASH_BASE) {
+			fprintf(stderr, "can't map the FLASH at 0x%08lx\n", FLASH_BASE);
+			exit(1);
+		}
+		simFlashErase();
+	}
+	u64Us = 0;
+} /* simInit() */
+
+//
+// The code runs for u32Us
+//
+void simBusy(uint32_t u32Us)
+{
+	u64Us += u32Us;
+} /* simBusy() */
+
+uint64_t simMicros(void)
+{
+	return u64Us;
+} /* simMicros() */
+
+uint32_t micros(void)
+{
+	u64Us += SIM_READ_US;
+	return (uint32_t)u64Us;
+} /* micros() */
+
+uint32_t millis(void)
+{
+	u64Us += SIM_READ_US;
+	return (uint32_t)(u64Us / 1000);
+} /* millis() */
+
+void delay(int i)
+{
+	u64Us += (uint64_t)i * 1000;
+} /* delay() */
+
+void Delay_Init(void)
+{
+} /* Delay_Init() */
+
+void Delay_Us(uint32_t n)
+{
+	u64Us += n;
+} /* Delay_Us() */
+
+void Delay_Ms(uint32_t n)
+{
+	u64Us += (uint64_t)n * 1000;
+} /* Delay_Ms() */
+
+uint64_t Tick_Micros(void)
+{
+	return u64Us;
+} /* Tick_Micros() */
+
+void Tick_Advance(uint32_t n)
+{
+	u64Us += n;
+} /* Tick_Advance() */
+
+//
+// Blank FLASH (every page erased) and clear the wear counts
+//
+void simFlashErase(void)
+{
+	memset(pFlash, 0xff, FLASH_SIZE);
+	memset(u32Erases, 0, sizeof(u32Erases));
+	memset(u32Programs, 0, sizeof(u32Programs));
+} /* simFlashErase() */
+
+uint32_t simFlashErases(int iPage)
+{
+	return u32Erases[iPage];
+} /* simFlashErases() */
+
+uint32_t simFlashPrograms(int iPage)
+{
+	return u32Programs[iPage];
+} /* simFlashPrograms() */
+
+static int simFlashPage(uint32_t u32Addr)
+{
+	if (!bUnlocked || u32Addr < FLASH_BASE || u32Addr >= FLASH_BASE + FLASH_SIZE || (u32Addr & (SIM_PAGE_SIZE-1))) {
+		fprintf(stderr, "bad FLASH access at 0x%08x%s\n", u32Addr, bUnlocked ? "" : " (locked)");
+		exit(1);
+	}
+	return (u32Addr - FLASH_BASE) / SIM_PAGE_SIZE;
+} /* simFlashPage() */
+
+void FLASH_Unlock_Fast(void)
+{
+	bUnlocked = 1;
+} /* FLASH_Unlock_Fast() */
+
+void FLASH_Lock_Fast(void)
+{
+	bUnlocked = 0;
+} /* FLASH_Lock_Fast() */
+
+void FLASH_ErasePage_Fast(uint32_t u32Addr)
+{
+int iPage = simFlashPage(u32Addr);
+
+	memset(&pFlash[iPage * SIM_PAGE_SIZE], 0xff, SIM_PAGE_SIZE);
+	u32Erases[iPage]++;
+	u64Us += 3000; // taken to be ~3ms, like the programming
+} /* FLASH_ErasePage_Fast() */
+
+void FLASH_BufReset(void)
+{
+	memset(u32PageBuf, 0xff, sizeof(u32PageBuf));
+} /* FLASH_BufReset() */
+
+void FLASH_BufLoad(uint32_t u32Addr, uint32_t u32Data)
+{
+	u32PageBuf[(u32Addr & (SIM_PAGE_SIZE-1)) >> 2] = u32Data;
+} /* FLASH_BufLoad() */
+
+//
+// Programming can only clear bits; a page which wasn't erased first
+// ends up with the AND of the old and new data, like the real thing
+//
+void FLASH_ProgramPage_Fast(uint32_t u32Addr)
+{
+int i, iPage = simFlashPage(u32Addr);
+uint32_t *d = (uint32_t *)&pFlash[iPage * SIM_PAGE_SIZE];
+
+	for (i=0; i<SIM_PAGE_SIZE/4; i++)
+		d[i] &= u32PageBuf[i];
+	u32Programs[iPage]++;
+	u64Us += 3000; // taken to be ~3ms
+} /* FLASH_ProgramPage_Fast() */
+
+//
+// A power loss while a page was being rewritten: it's erased, but only
+// the first half got programmed
+//
+void simFlashTear(uint32_t u32Addr)
+{
+uint8_t *p = (uint8_t *)(uintptr_t)u32Addr;
+
+	memset(&p[SIM_PAGE_SIZE/2], 0xff, SIM_PAGE_SIZE/2);
+} /* simFlashTear() */
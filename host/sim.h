@@ -0,0 +1,44 @@
+//
+// Simulated clock and FLASH for the host programs
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+// The firmware's time comes from millis()/micros(); here they read a
+// simulated clock which only moves when the code "runs" (simBusy()),
+// waits (Delay_Ms()) or reads the clock. Each read takes SIM_READ_US,
+// about what it costs at 8MHz, which also lets busy-wait loops end.
+#define SIM_READ_US 1
+
+// The CH32V003 FLASH is mapped at its real address, so code which
+// reads it in place (the log) works unchanged
+#define SIM_PAGE_SIZE 64
+#define SIM_PAGES (FLASH_SIZE / SIM_PAGE_SIZE)
+
+void simInit(void);
+void simBusy(uint32_t u32Us);
+uint64_t simMicros(void);
+void simFlashErase(void);
+uint32_t simFlashErases(int iPage);
+uint32_t simFlashPrograms(int iPage);
+void simFlashTear(uint32_t u32Addr);
+
+#endif /* HOST_SIM_H_ */
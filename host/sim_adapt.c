@@ -0,0 +1,148 @@
+//
+// Adaptive sample rate simulator
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "scd41.h"
+#include "adapt.h"
+#include "level.h"
+#include "trace.h"
+
+// Samples a week of each room at a fixed 5 seconds (periodic), a fixed
+// 30 seconds (low power periodic) and at the rate adapt.c picks, and
+// reports the SCD41 charge per day and how long after the room really
+// crossed a level threshold the level (level.c, with its hysteresis)
+// followed. A crossing is missed if the room falls back below the
+// threshold (by the hysteresis) before the level gets there.
+// Every policy reads the same noisy samples: each second of the room
+// is sampled once up front.
+#define DAYS 7
+#define SECONDS (DAYS * 86400)
+// SCD41 datasheet averages at 3.3V (power.h has the first two): the
+// single shot figure is for one every 5 minutes, so each shot is
+// charged that share (which counts the idle time of a 5 minute
+// interval; at 3 minutes that's slightly high)
+#define SCD_PERIODIC_UA 15000
+#define SCD_LOWPOWER_UA 3200
+#define SCD_SHOT_UA 450 // at one per 5 minutes
+#define SCD_SHOT_UAS (SCD_SHOT_UA * 300)
+
+enum
+{
+	POLICY_5S=0,
+	POLICY_30S,
+	POLICY_ADAPT,
+	POLICY_COUNT
+};
+static const char *szPolicy[POLICY_COUNT] = {"fixed 5s", "fixed 30s", "adaptive"};
+
+static int iRoom[SECONDS], iRead[SECONDS]; // the room and the sensor
+static int iThresholds[LEVEL_THRESHOLDS], iHyst;
+
+static void Run(int iKind, int iPolicy)
+{
+int i, t, iNext = 0, iInterval, iRate, iLevel;
+int iPending[LEVEL_THRESHOLDS]; // when the room crossed (-1 = it hasn't)
+int iCrossings = 0, iMissed = 0, iLate = 0, iMax = 0;
+double dSum = 0, dCharge = 0; // uA seconds
+int iSamples = 0, iSecsAt[ADAPT_RATES] = {0};
+
+	levelInit(iThresholds, iHyst);
+	adaptInit(ADAPT_NORMAL);
+	for (i=0; i<LEVEL_THRESHOLDS; i++)
+		iPending[i] = -1;
+	for (t=1; t<SECONDS; t++) {
+		// the room crossing the thresholds
+		for (i=0; i<LEVEL_THRESHOLDS; i++) {
+			if (iRoom[t-1] < iThresholds[i] && iRoom[t] >= iThresholds[i] && iPending[i] < 0) {
+				iPending[i] = t;
+				iCrossings++;
+			} else if (iPending[i] >= 0 && iRoom[t] < iThresholds[i] - iHyst) {
+				iPending[i] = -1;
+				iMissed++;
+			}
+		}
+		if (t >= iNext) { // a sample
+			if (iPolicy == POLICY_5S) {
+				iInterval = 5;
+				dCharge += 5.0 * SCD_PERIODIC_UA;
+			} else if (iPolicy == POLICY_30S) {
+				iInterval = 30;
+				dCharge += 30.0 * SCD_LOWPOWER_UA;
+			} else {
+				iRate = adaptRate();
+				iInterval = adaptInterval();
+				iSecsAt[iRate] += iInterval;
+				if (iRate == ADAPT_FAST)
+					dCharge += (double)iInterval * SCD_PERIODIC_UA;
+				else if (iRate == ADAPT_NORMAL)
+					dCharge += (double)iInterval * SCD_LOWPOWER_UA;
+				else
+					dCharge += SCD_SHOT_UAS;
+				adaptAdd(iRead[t], iInterval);
+			}
+			levelUpdate(iRead[t]);
+			iSamples++;
+			iNext = t + ((iPolicy == POLICY_ADAPT) ? adaptInterval() : iInterval);
+		}
+		iLevel = levelGet();
+		for (i=0; i<LEVEL_THRESHOLDS; i++) {
+			if (iPending[i] >= 0 && iLevel > i) {
+				dSum += t - iPending[i];
+				if (t - iPending[i] > iMax) iMax = t - iPending[i];
+				if (t - iPending[i] > 60) iLate++;
+				iPending[i] = -1;
+			}
+		}
+	}
+	printf("%-9s %-9s %7.2f %8d %5d %8.1f %6d %5d %5d", szTraceName[iKind], szPolicy[iPolicy],
+		dCharge / 3600 / 1000 / DAYS, iSamples / DAYS, iCrossings,
+		(iCrossings > iMissed) ? dSum / (iCrossings - iMissed) : 0.0, iMax, iLate, iMissed);
+	if (iPolicy == POLICY_ADAPT)
+		printf("  %2d/%2d/%2d%%", (int)(100LL * iSecsAt[ADAPT_FAST] / SECONDS),
+			(int)(100LL * iSecsAt[ADAPT_NORMAL] / SECONDS), (int)(100LL * iSecsAt[ADAPT_SLOW] / SECONDS));
+	printf("\n");
+} /* Run() */
+
+int main(void)
+{
+TRACE trace;
+int iKind, iPolicy, t, iValues[3];
+
+	levelDefaults(iThresholds, &iHyst);
+	printf("%d days; SCD41 charge and how long the level takes to follow the room\n", DAYS);
+	printf("trace     policy    mAh/day  smp/day  cross  mean(s)  max(s) >60s  missed  5s/30s/shot\n");
+	for (iKind=0; iKind<TRACE_COUNT; iKind++) {
+		traceInit(&trace, iKind, 77 + iKind);
+		for (t=0; t<SECONDS; t++) {
+			traceRun(&trace, 1);
+			iRoom[t] = traceCO2(&trace);
+			traceSample(&trace, iValues);
+			iRead[t] = iValues[0];
+		}
+		for (iPolicy=0; iPolicy<POLICY_COUNT; iPolicy++)
+			Run(iKind, iPolicy);
+	}
+	return 0;
+} /* main() */
@@ -0,0 +1,135 @@
+//
+// FLASH log wear simulator
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "history.h"
+#include "flashlog.h"
+#include "sim.h"
+#include "trace.h"
+
+// Logs days of samples through history.c (which averages each
+// HISTORY_BLOCK of them into a log block) into the simulated FLASH,
+// counts the page erases and programs, and checks that every block
+// still in the log reads back as it was written, also after a reboot.
+#define ENDURANCE 10000 // erase cycles
+#define EXPECTED (LOG_PAGES * LOG_MAX_SAMPLES + LOG_MAX_SAMPLES)
+
+static int iExpected[EXPECTED][CODEC_CHANNELS]; // the newest blocks
+static int iBlocks, iErrors;
+
+static void Check(int bOK, const char *szWhat)
+{
+	if (!bOK) {
+		printf("FAIL: %s\n", szWhat);
+		iErrors++;
+	}
+} /* Check() */
+
+//
+// Compare the log with what went into it; iInRAM is the number of
+// blocks expected in the page not written yet
+//
+static void CheckLog(int iInRAM)
+{
+int i, iCount = flashlogSampleCount(), iValues[CODEC_CHANNELS], *pExp;
+int iBad = 0;
+
+	Check(iCount >= iInRAM && iCount <= iBlocks, "the log count");
+	for (i=0; i<iCount && i<EXPECTED; i++) {
+		pExp = iExpected[(iBlocks - 1 - i) % EXPECTED];
+		if (!flashlogGetSample(i, iValues) || memcmp(iValues, pExp, sizeof(iValues)) != 0)
+			iBad++;
+	}
+	Check(iBad == 0, "the blocks read back as written");
+} /* CheckLog() */
+
+static void Run(int iKind, int iRate, int iDays)
+{
+TRACE trace;
+int i, iPage, iFirst = (LOG_START - FLASH_BASE) / SIM_PAGE_SIZE, iValues[CODEC_CHANNELS];
+int iSamples = (iDays * 86400) / iRate, iInBlock = 0, iInRAM, iCount;
+int32_t i32Sum[CODEC_CHANNELS] = {0};
+uint32_t u32Min = 0xffffffff, u32Max = 0, u32Writes = 0;
+double dPerDay;
+
+	simInit();
+	simFlashErase();
+	traceInit(&trace, iKind, 1234 + iKind);
+	historyInit();
+	flashlogInit();
+	iBlocks = 0;
+	for (i=0; i<iSamples; i++) {
+		traceRun(&trace, iRate);
+		traceSample(&trace, iValues);
+		historyAddSample(iValues[0], iValues[1], iValues[2], iRate);
+		// the same rounded average history.c logs
+		i32Sum[0] += iValues[0]; i32Sum[1] += iValues[1]; i32Sum[2] += iValues[2];
+		if (++iInBlock == HISTORY_BLOCK) {
+			int *pExp = iExpected[iBlocks % EXPECTED];
+			pExp[0] = (int)(((uint32_t)i32Sum[0] + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT);
+			pExp[1] = (i32Sum[1] + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT;
+			pExp[2] = (i32Sum[2] + (HISTORY_BLOCK/2)) >> HISTORY_BLOCK_SHIFT;
+			memset(i32Sum, 0, sizeof(i32Sum));
+			iInBlock = 0;
+			iBlocks++;
+		}
+	}
+	for (iPage=iFirst; iPage<iFirst+LOG_PAGES; iPage++) {
+		if (simFlashErases(iPage) < u32Min) u32Min = simFlashErases(iPage);
+		if (simFlashErases(iPage) > u32Max) u32Max = simFlashErases(iPage);
+		u32Writes += simFlashPrograms(iPage);
+	}
+	// the page being filled isn't in FLASH yet
+	iCount = iInRAM = flashlogSampleCount();
+	for (i=0; i<flashlogCount(); i++)
+		iInRAM -= flashlogGetPage(i)->u16Count;
+	CheckLog(iInRAM);
+	// leaving the mode (or a critical battery) writes the page in RAM,
+	// so a reboot after it finds every block
+	flashlogFlush();
+	Check(flashlogSampleCount() == iCount || flashlogCount() == LOG_PAGES, "the flush keeps the page in RAM");
+	flashlogInit();
+	i = (int)u32Writes + (iInRAM != 0);
+	Check(flashlogCount() == ((i < LOG_PAGES) ? i : LOG_PAGES), "the reboot finds every page");
+	CheckLog(0);
+	dPerDay = (double)u32Max / iDays;
+	printf("%-9s %3ds %7d %8.1f %10.1f %7u-%-5u %8.2f %8.1f\n", szTraceName[iKind], iRate,
+		iBlocks, u32Writes ? (double)(iBlocks - iInRAM) / u32Writes : 0.0, (double)u32Writes / iDays,
+		u32Min, u32Max, dPerDay, dPerDay ? ENDURANCE / dPerDay / 365 : 0.0);
+} /* Run() */
+
+int main(int argc, char *argv[])
+{
+int iKind, iDays = (argc > 1) ? atoi(argv[1]) : 30;
+
+	if (iDays < 1) iDays = 1;
+	printf("FLASH log: %d pages, up to %d blocks each, %d days\n", LOG_PAGES, LOG_MAX_SAMPLES, iDays);
+	printf("trace     rate  blocks  blk/page  writes/day  erases/page  per day  years@%dK\n", ENDURANCE / 1000);
+	for (iKind=0; iKind<TRACE_COUNT; iKind++)
+		Run(iKind, 5, iDays); // continuous mode, the fastest
+	Run(TRACE_OFFICE, 30, iDays); // low power mode
+	printf("%s\n", iErrors ? "FAILED" : "readback ok");
+	return (iErrors != 0);
+} /* main() */
@@ -0,0 +1,117 @@
+//
+// LSI calibration simulator
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "lsi.h"
+#include "sim.h"
+#include "board.h"
+
+// Runs the scheduler's sleep pattern (StandbyFor() between short
+// wakes, lsiUpdate() before each one) for a day of real time on boards
+// whose LSI is off from LSI_NOMINAL_HZ, whose HSI is off and whose LSI
+// follows the temperature through the day, with and without the
+// calibration. Reports how fast the firmware's clock ran against the
+// real one, and how far apart they got at worst (a swing averages out
+// over the day, but not along the way). Calibrated, it should be off
+// by the HSI error alone (the LSI is measured against it), give or
+// take LSI_MAX_ERR_PPM for the rounding of the tick length and the LSI
+// moving between calibrations.
+#define HOURS 24
+#define SLEEP_MS 4900 // continuous mode: ~5s between samples
+#define AWAKE_US 2000
+#define LSI_MAX_ERR_PPM 1000
+
+typedef struct tagBoardClocks
+{
+	uint32_t u32LSIHz;
+	int iHSIppm;
+	int iSwing; // the LSI's swing through the day (+/- ppm)
+} BOARDCLOCKS;
+
+static const BOARDCLOCKS boards[] = {
+	{LSI_NOMINAL_HZ, 0, 0}, {115000, 0, 0}, {135000, 0, 0},
+	{128000, 10000, 0}, {120000, -10000, 0}, {124878, 3000, 20000},
+	{110000, -5000, 30000}};
+#define BOARDS (int)(sizeof(boards) / sizeof(BOARDCLOCKS))
+
+//
+// Returns how fast the firmware's clock ran (ppm) and how far it was
+// off at worst along the way (seconds)
+//
+static double Run(const BOARDCLOCKS *pBoard, int bCal, int iHours, double *pWorst)
+{
+double dRealUs, dEnd = iHours * 3600e6;
+uint32_t u32Hz;
+
+	simInit();
+	boardInit(NULL);
+	StandbySetLSI(LSI_NOMINAL_HZ);
+	while ((dRealUs = boardRealUs()) < dEnd) {
+		u32Hz = (uint32_t)(pBoard->u32LSIHz * (1.0 + pBoard->iSwing / 1e6 * sin(dRealUs * 2 * M_PI / 86400e6)));
+		boardClocks(u32Hz, pBoard->iHSIppm);
+		if (bCal)
+			lsiUpdate();
+		StandbyArm();
+		StandbyFor(SLEEP_MS);
+		simBusy(AWAKE_US);
+		if (fabs(simMicros() - boardRealUs()) / 1e6 > *pWorst)
+			*pWorst = fabs(simMicros() - boardRealUs()) / 1e6;
+	}
+	return ((double)simMicros() / boardRealUs() - 1.0) * 1e6;
+} /* Run() */
+
+int main(int argc, char *argv[])
+{
+int i, iStatus, iFailed = 0, iHours = (argc > 1) ? atoi(argv[1]) : HOURS;
+double dFree, dCal, dFreeWorst = 0, dCalWorst = 0;
+const BOARDCLOCKS *pBoard;
+
+	if (iHours < 1) iHours = 1;
+	printf("LSI calibration: %d hours, %dms sleeps, the clock's error with and without it\n", iHours, SLEEP_MS);
+	printf("  LSI Hz   HSI ppm  swing ppm  uncalibrated (worst)  calibrated (worst)\n");
+	for (i=0; i<BOARDS; i++) {
+		pBoard = &boards[i];
+		fflush(stdout);
+		// lsi.c keeps its last calibration, so each run gets a process
+		if (fork() == 0) {
+			dFree = Run(pBoard, 0, iHours, &dFreeWorst);
+			dCal = Run(pBoard, 1, iHours, &dCalWorst);
+			printf("%8u %9d %10d %8.0fppm %7.0fs %8.0fppm %6.0fs\n", pBoard->u32LSIHz,
+				pBoard->iHSIppm, pBoard->iSwing, dFree, dFreeWorst, dCal, dCalWorst);
+			if (fabs(dCal - pBoard->iHSIppm) > LSI_MAX_ERR_PPM) {
+				printf("  calibrated clock off by more than the HSI error + %dppm\n", LSI_MAX_ERR_PPM);
+				exit(1);
+			}
+			exit(0);
+		}
+		wait(&iStatus);
+		if (!WIFEXITED(iStatus) || WEXITSTATUS(iStatus))
+			iFailed = 1;
+	}
+	return iFailed;
+} /* main() */
@@ -0,0 +1,362 @@
+//
+// Scheduler and standby simulator
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "debug.h"
+#include "Arduino.h"
+#include "scd41.h"
+#include "oled.h"
+#include "Roboto_Black_40.h"
+#include "co2_emojis.h"
+#include "history.h"
+#include "exposure.h"
+#include "sched.h"
+#include "battery.h"
+#include "adapt.h"
+#include "pwm.h"
+#include "power.h"
+#include "alert.h"
+#include "haptic.h"
+#include "level.h"
+#include "sim.h"
+#include "board.h"
+#include "trace.h"
+
+// Runs the continuous, low power and stealth modes for a day of the
+// office under the real scheduler, SCD41 driver, OLED driver, alerts
+// and haptic reports (with the PWM fallback: outputs on or off). The
+// mode tasks are main.c's, minus the buttons. The time goes where the
+// board spends it: the I2C transfers at their bus speed, the driver's
+// delays, the standby wakes and SAMPLE_CPU_US for the sample
+// processing (which can't be timed here). Reports the part of the time
+// spent in standby as the scheduler counts it and as the board does,
+// then power.c's accounting for each mode: the time in each state, the
+// charge, the average current and the projected battery life. Then
+// stealth mode again in each room for each haptic encoding: how long
+// the motor ran and what it cost.
+#define HOURS 24
+#define SAMPLE_CPU_US 300 // AddSample() at 8MHz: history, stats, exposure, level
+#define STEALTH_FREQ 30 // state.iFreq default (seconds)
+
+enum
+{
+	MODE_CONTINUOUS=0,
+	MODE_LOW_POWER,
+	MODE_STEALTH,
+	MODE_COUNT
+};
+static const char *szMode[MODE_COUNT] = {"continuous", "low power", "stealth"};
+static const char *szHaptic[HAPTIC_COUNT] = {"pulses", "binary", "change", "trend"};
+
+static TRACE trace;
+static int iTraceSecs, iMode, iHaptic;
+static PT ptMode;
+static int iSample, iEmojiShown, bDisplayOn, iDisplayTask, iStealthLevel, iStealthTask;
+static const uint8_t u8FullOn = PWM_TOP;
+
+// the SCD41 measures the room as it is now
+static void Sensor(int *pValues)
+{
+int iNow = (int)(simMicros() / 1000000);
+
+	traceRun(&trace, iNow - iTraceSecs);
+	iTraceSecs = iNow;
+	traceSample(&trace, pValues);
+} /* Sensor() */
+
+static void End(void)
+{
+	schedExit();
+} /* End() */
+
+static int i2str(char *pDest, int iVal)
+{
+	return sprintf(pDest, "%d", iVal);
+} /* i2str() */
+
+static void BlinkLED(uint8_t u8LED, int iDuration)
+{
+	pwmRamp(u8LED, &u8FullOn, 1, iDuration);
+	pwmWait(u8LED);
+} /* BlinkLED() */
+
+static void AddSample(int iSeconds)
+{
+int i;
+
+	simBusy(SAMPLE_CPU_US);
+	historyAddSample(_iCO2, _iTemperature, _iHumidity, iSeconds);
+	exposureAdd(_iCO2, iSeconds);
+	i = exposureNewAlarm();
+	if (i)
+		alertPlay((i & EXPOSURE_STEL) ? ALERT_EVENT_STEL : ALERT_EVENT_TWA, ALERT_VIBRATION);
+	else if (levelUpdate(_iCO2) > 0 && levelGet() >= LEVEL_ALERT && iMode != MODE_STEALTH)
+		alertPlay(ALERT_EVENT_LEVEL, ALERT_VIBRATION);
+} /* AddSample() */
+
+// main.c's, with the 8x8 labels
+static void ShowCurrent(void)
+{
+int i, x;
+char szTemp[32];
+
+	I2CSetSpeed(400000);
+	i = i2str(szTemp, (int)_iCO2);
+	oledWriteStringCustom(&Roboto_Black_40, 0, 32, szTemp, 1);
+	x = oledGetCursorX();
+	if (i < 4) {
+		oledWriteString(x+24, 0, "  ", FONT_12x16, 0);
+		oledWriteString(x, 16, "   ", FONT_12x16, 0);
+		iEmojiShown = -1;
+	}
+	oledWriteString(x, 0, "CO2", FONT_8x8, 0);
+	oledWriteString(x, 8, "ppm", FONT_8x8, 0);
+	oledWriteString(0, 40, "Temp ", FONT_8x8, 0);
+	i2str(szTemp, _iTemperature/10);
+	oledWriteString(-1, 40, szTemp, FONT_8x8, 0);
+	oledWriteString(-1, 40, ".", FONT_8x8, 0);
+	i2str(szTemp, _iTemperature % 10);
+	oledWriteString(-1, 40, szTemp, FONT_8x8, 0);
+	oledWriteString(-1, 40, "C ", FONT_8x8, 0);
+	oledWriteString(0, 56, "Humidity ", FONT_8x8, 0);
+	i2str(szTemp, _iHumidity/10);
+	oledWriteString(-1, 56, szTemp, FONT_8x8, 0);
+	oledWriteString(-1, 56, "% ", FONT_8x8, 0);
+	x = levelGet();
+	if (x < 0) x = levelClassify(_iCO2);
+	x = (x > 0) ? x - 1 : 0;
+	if (x > 4) x = 4;
+	if (x != iEmojiShown) {
+		oledDrawSprite(96, 16, 31, 32, (uint8_t *)&co2_emojis[x * 4], 20, 1);
+		iEmojiShown = x;
+	}
+	x = exposureStatus();
+	oledWriteString(104, 56, (x & EXPOSURE_STEL) ? "STL" : (x & EXPOSURE_TWA) ? "TWA" : "   ", FONT_6x8, (x != 0));
+} /* ShowCurrent() */
+
+static void ContinuousSample(void)
+{
+	I2CSetSpeed(50000);
+	iSample++;
+	if (scd41_getSample() == SCD_SUCCESS && iSample > 3)
+		AddSample(5 << batteryPolicy()->u8IntervalShift);
+	ShowCurrent();
+} /* ContinuousSample() */
+
+static PT_THREAD(MonitorThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	while (1) {
+		PT_SLEEP(pt, 5000 << batteryPolicy()->u8IntervalShift);
+		ContinuousSample();
+	}
+	PT_END(pt);
+} /* MonitorThread() */
+
+static int LowPowerInterval(void)
+{
+	return adaptInterval() << batteryPolicy()->u8IntervalShift;
+} /* LowPowerInterval() */
+
+static void LowPowerSample(void)
+{
+int iPowerMode = adaptPowerMode();
+int iSeconds = LowPowerInterval();
+
+	I2CSetSpeed(50000);
+	if (scd41_getSample() != SCD_SUCCESS)
+		return;
+	AddSample(iSeconds);
+	adaptAdd(_iCO2, iSeconds);
+	if (adaptPowerMode() != iPowerMode) {
+		if (iPowerMode != SCD_POWERMODE_ONESHOT)
+			scd41_stop();
+		scd41_start(adaptPowerMode());
+	}
+} /* LowPowerSample() */
+
+static uint32_t u32LowPowerNext;
+static int32_t i32LowPowerLeft;
+
+static PT_THREAD(LowPowerThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	while (1) {
+		u32LowPowerNext = millis() + LowPowerInterval() * 1000UL;
+		if (adaptPowerMode() == SCD_POWERMODE_ONESHOT)
+			u32LowPowerNext -= 5000;
+		while ((i32LowPowerLeft = (int32_t)(u32LowPowerNext - millis())) > 0) {
+			BlinkLED(LED_GREEN, 2);
+			PT_SLEEP(pt, (i32LowPowerLeft < 2000) ? i32LowPowerLeft : 2000);
+		}
+		if (adaptPowerMode() == SCD_POWERMODE_ONESHOT) {
+			I2CSetSpeed(50000);
+			scd41_measure();
+			PT_SLEEP(pt, 5000);
+		}
+		LowPowerSample();
+	}
+	PT_END(pt);
+} /* LowPowerThread() */
+
+static void LowPowerDisplayOff(void)
+{
+	I2CSetSpeed(400000);
+	oledPower(0);
+	bDisplayOn = 0;
+} /* LowPowerDisplayOff() */
+
+static void StealthSample(void)
+{
+int iShift = batteryPolicy()->u8IntervalShift;
+
+	I2CSetSpeed(50000);
+	if (scd41_getSample() == SCD_SUCCESS)
+		AddSample(5 << iShift);
+	schedSetPeriod(iStealthTask, 5000 << iShift);
+	if (levelGet() >= 0)
+		iStealthLevel = 1 + levelGet();
+} /* StealthSample() */
+
+static PT_THREAD(StealthThread(PT *pt))
+{
+	PT_BEGIN(pt);
+	while (1) {
+		PT_SLEEP(pt, STEALTH_FREQ * 1000);
+		hapticReport(iStealthLevel, _iCO2);
+	}
+	PT_END(pt);
+} /* StealthThread() */
+
+//
+// Set up a mode the way main.c does and run it for iHours
+//
+static void RunMode(int iNewMode, int iEncoding, int iRoom, int iHours)
+{
+int iThresholds[LEVEL_THRESHOLDS], iHyst;
+
+	iMode = iNewMode;
+	iHaptic = iEncoding;
+	simInit();
+	simFlashErase();
+	boardInit(Sensor);
+	traceInit(&trace, iRoom, 42);
+	iTraceSecs = 0;
+	historyInit();
+	exposureInit();
+	levelDefaults(iThresholds, &iHyst);
+	levelInit(iThresholds, iHyst);
+	oledInit(BOARD_OLED_ADDR, 400000);
+	iSample = 0;
+	iEmojiShown = -1;
+	bDisplayOn = 1;
+	I2CSetSpeed(50000);
+	schedInit(1);
+	alertInit();
+	if (iMode == MODE_CONTINUOUS) {
+		scd41_start(SCD_POWERMODE_NORMAL);
+		schedAddThread(MonitorThread, &ptMode, 0);
+	} else if (iMode == MODE_LOW_POWER) {
+		adaptInit(ADAPT_NORMAL);
+		scd41_start(adaptPowerMode());
+		schedAddThread(LowPowerThread, &ptMode, 0);
+		iDisplayTask = schedAdd(LowPowerDisplayOff, 0, 5000);
+	} else {
+		oledPower(0);
+		scd41_start(SCD_POWERMODE_NORMAL);
+		iStealthLevel = 1;
+		hapticInit(iHaptic);
+		iStealthTask = schedAdd(StealthSample, 5000, 5000);
+		schedAddThread(StealthThread, &ptMode, 0);
+	}
+	schedAdd(End, 0, iHours * 3600000);
+	schedRun();
+} /* RunMode() */
+
+//
+// power.c's figures for the mode just run
+//
+static void ReportPower(void)
+{
+int i;
+uint32_t u32Elapsed = millis();
+
+	printf("  %u uA average, %u hours on %d mAh\n", powerAverage(), powerLifeHours(), BATTERY_MAH);
+	for (i=0; i<POWER_COUNT; i++) {
+		if (powerTime(i) == 0)
+			continue;
+		printf("  %-5s %8.1fs %6.2f%% %6u uAh\n", szPowerState[i], powerTime(i) / 1000.0,
+			100.0 * powerTime(i) / u32Elapsed, powerCharge(i));
+	}
+} /* ReportPower() */
+
+static void Report(const char *szName, int iHours)
+{
+uint64_t u64Elapsed = simMicros();
+uint64_t u64Awake = u64Elapsed - boardStandbyUs();
+
+	printf("%-10s %7d.%d%% %9.1f%% %9.1f %10.2f %9.1f\n", szName,
+		schedStandbyPermille() / 10, schedStandbyPermille() % 10,
+		100.0 * boardStandbyUs() / u64Elapsed, boardStandbys() / (iHours * 60.0),
+		u64Awake / 1000.0 / boardMeasurements(), u64Awake / 1000.0 / (iHours * 60.0));
+} /* Report() */
+
+int main(int argc, char *argv[])
+{
+int i, iRoom, iHours = (argc > 1) ? atoi(argv[1]) : HOURS;
+
+	if (iHours < 1) iHours = 1;
+	printf("scheduler: %d hours of the %s, %dus a sample processed, %dus a wake\n",
+		iHours, szTraceName[TRACE_OFFICE], SAMPLE_CPU_US, BOARD_WAKE_US);
+	printf("mode       standby (sched) (board)  sleeps/min  awake ms/meas  ms/min\n");
+	// power.c counts from power up, so each mode gets a process of its own
+	for (i=0; i<MODE_COUNT; i++) {
+		fflush(stdout);
+		if (fork() == 0) {
+			RunMode(i, HAPTIC_PULSES, TRACE_OFFICE, iHours);
+			Report(szMode[i], iHours);
+			ReportPower();
+			exit(0);
+		}
+		wait(NULL);
+	}
+	printf("\nhaptic: stealth mode, a report every %ds\n", STEALTH_FREQ);
+	printf("room      encoding  motor ms/h  motor uAh/h  average uA  hours\n");
+	for (iRoom=0; iRoom<TRACE_COUNT; iRoom++) {
+		for (i=0; i<HAPTIC_COUNT; i++) {
+			fflush(stdout);
+			if (fork() == 0) {
+				RunMode(MODE_STEALTH, i, iRoom, iHours);
+				printf("%-9s %-8s %11.0f %12.0f %11u %6u\n", szTraceName[iRoom], szHaptic[i],
+					boardPinHighUs(MOTOR_PIN) / 1000.0 / iHours, (double)powerCharge(POWER_MOTOR) / iHours,
+					powerAverage(), powerLifeHours());
+				exit(0);
+			}
+			wait(NULL);
+		}
+	}
+	return 0;
+} /* main() */
@@ -0,0 +1,201 @@
+//
+// Event ring tests and benchmark
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "ring.h"
+
+// The ring relies on the target's single in-order hart, where only
+// the compiler can reorder the accesses (RING_BARRIER). x86 doesn't
+// reorder stores with stores or loads with loads either, so there the
+// two threads see the same as the ISR and the main loop; other hosts
+// would need real fences and skip the threaded tests.
+#if defined(__x86_64__) || defined(__i386__)
+#define THREADS_OK 1
+#else
+#define THREADS_OK 0
+#endif
+
+#define STRESS_EVENTS 5000000
+// Spins on a full/empty ring before giving the other thread the CPU
+// (with one core it can't run until this one gives way)
+#define SPINS 64
+#define BENCH_EVENTS 100000000
+
+static RING ring;
+static EVENT events[128];
+static int iErrors;
+
+static double Seconds(void)
+{
+struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+} /* Seconds() */
+
+static void Check(int bOK, const char *szWhat)
+{
+	if (!bOK) {
+		printf("FAIL: %s\n", szWhat);
+		iErrors++;
+	}
+} /* Check() */
+
+//
+// Fill, drain and wrap rings of every size on one thread
+//
+static void TestSingle(void)
+{
+int iSize, i, j;
+EVENT ev;
+
+	for (iSize=1; iSize<=128; iSize<<=1) {
+		ringInit(&ring, events, iSize);
+		Check(!ringGet(&ring, &ev), "get from an empty ring");
+		// 300 rounds take the 8-bit indices around more than once
+		for (j=0; j<300; j++) {
+			for (i=0; i<iSize; i++)
+				Check(ringPut(&ring, EVENT_BUTTON, (uint8_t)i, (uint16_t)(j * 1000 + i)), "put into a ring with room");
+			Check(!ringPut(&ring, EVENT_TIMER, 0, 0), "put into a full ring");
+			Check(ringCount(&ring) == iSize, "count of a full ring");
+			for (i=0; i<iSize; i++) {
+				Check(ringGet(&ring, &ev), "get from a ring with events");
+				Check(ev.u8Type == EVENT_BUTTON && ev.u8Code == (uint8_t)i && ev.u16Value == (uint16_t)(j * 1000 + i), "events come out in order");
+			}
+			Check(ringCount(&ring) == 0, "count of a drained ring");
+		}
+		ringPut(&ring, EVENT_SENSOR_READY, 0, 400);
+		ringFlush(&ring);
+		Check(!ringGet(&ring, &ev) && ringCount(&ring) == 0, "flush empties the ring");
+	}
+	printf("single thread: %s\n", iErrors ? "FAILED" : "ok");
+} /* TestSingle() */
+
+static int iStressEvents;
+static uint32_t u32FullSpins;
+
+// The "ISR": every event carries a 24-bit sequence number and its type
+// cycles through all of them
+static void *Producer(void *p)
+{
+int i;
+uint32_t u32Spins = 0;
+
+	(void)p;
+	for (i=0; i<iStressEvents; i++) {
+		while (!ringPut(&ring, (uint8_t)(1 + (i % (EVENT_COUNT-1))), (uint8_t)(i >> 16), (uint16_t)i)) {
+			if ((++u32Spins % SPINS) == 0) // full; the main loop is behind
+				sched_yield();
+		}
+	}
+	u32FullSpins = u32Spins;
+	return NULL;
+} /* Producer() */
+
+//
+// The "main loop" checks that nothing is lost, repeated or reordered
+//
+static int Consume(void)
+{
+int i = 0, iBad = 0, iSpins = 0;
+uint32_t u32Seq;
+EVENT ev;
+
+	while (i < iStressEvents) {
+		if (!ringGet(&ring, &ev)) {
+			if ((++iSpins % SPINS) == 0)
+				sched_yield();
+			continue;
+		}
+		u32Seq = ((uint32_t)ev.u8Code << 16) | ev.u16Value;
+		if (u32Seq != ((uint32_t)i & 0xffffff) || ev.u8Type != 1 + (i % (EVENT_COUNT-1)))
+			iBad++;
+		i++;
+	}
+	return iBad;
+} /* Consume() */
+
+static double RunThreads(int iSize, int iEvents, int *pBad)
+{
+pthread_t thread;
+double d;
+
+	ringInit(&ring, events, iSize);
+	iStressEvents = iEvents;
+	d = Seconds();
+	pthread_create(&thread, NULL, Producer, NULL);
+	*pBad = Consume();
+	pthread_join(thread, NULL);
+	return Seconds() - d;
+} /* RunThreads() */
+
+static void TestThreads(void)
+{
+int iSize, iBad;
+
+	for (iSize=2; iSize<=128; iSize<<=3) {
+		RunThreads(iSize, STRESS_EVENTS, &iBad);
+		printf("two threads, %3d events: %d events, %d bad, producer found it full %u times\n",
+			iSize, STRESS_EVENTS, iBad, u32FullSpins);
+		Check(iBad == 0, "events cross threads intact");
+	}
+} /* TestThreads() */
+
+static void Bench(void)
+{
+int i, iBad;
+double d;
+EVENT ev;
+volatile uint32_t u32Sum = 0;
+
+	ringInit(&ring, events, 32);
+	d = Seconds();
+	for (i=0; i<BENCH_EVENTS; i++) {
+		ringPut(&ring, EVENT_TIMER, 0, (uint16_t)i);
+		ringGet(&ring, &ev);
+		u32Sum += ev.u16Value;
+	}
+	d = Seconds() - d;
+	printf("put+get, one thread: %.1f M events/s (%.1f ns each)\n", BENCH_EVENTS / d * 1e-6, d * 1e9 / BENCH_EVENTS);
+	if (THREADS_OK) {
+		d = RunThreads(32, BENCH_EVENTS / 4, &iBad);
+		printf("two threads, 32 events: %.1f M events/s\n", BENCH_EVENTS / 4 / d * 1e-6);
+	}
+} /* Bench() */
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+		Bench();
+		return 0;
+	}
+	TestSingle();
+	if (THREADS_OK)
+		TestThreads();
+	else
+		printf("two threads: skipped (needs x86 memory ordering)\n");
+	return (iErrors != 0);
+} /* main() */
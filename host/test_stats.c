@@ -0,0 +1,211 @@
+//
+// CO2 statistics tests
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stats.h"
+#include "trace.h"
+
+// Runs the integer statistics over a week of each simulated room and
+// compares them with double precision references:
+// - Welford against the exact mean and sample variance of everything
+//   seen, in floating point, checked after every sample
+// - P-square P50/P95 against the same algorithm in floating point and
+//   the exact quantiles of everything seen, checked every hour. The
+//   error against the exact ones is only checked at the end: a room
+//   that's empty half the time and full the other half puts its median
+//   between the two, where five markers can be far off for days.
+// The cycles per statsAdd() on the RV32EC are in host/rvsim (make
+// profile) and the Stats profile zone on the board.
+#define DAYS 7
+#define RATE 5
+#define SAMPLES ((DAYS * 86400) / RATE)
+#define CHECK_EVERY (3600 / RATE)
+#define MAX_MEAN_ERR 1 // ppm
+#define MAX_SD_ERR 1.5 // ppm (isqrt() rounds down)
+#define MAX_P2_REF_ERR 2 // ppm
+#define MAX_P2_ERR 8 // % of the exact quantile after DAYS
+#define WARMUP (86400 / RATE)
+
+static int iValues[SAMPLES];
+static int iSorted[SAMPLES];
+static int iErrors;
+
+static void Check(int bOK, const char *szTrace, const char *szWhat)
+{
+	if (!bOK) {
+		printf("FAIL: %s %s\n", szTrace, szWhat);
+		iErrors++;
+	}
+} /* Check() */
+
+static int Compare(const void *p1, const void *p2)
+{
+	return *(const int *)p1 - *(const int *)p2;
+} /* Compare() */
+
+// the exact quantile of the first iCount values (nearest rank)
+static int Quantile(int iCount, int iPerMille)
+{
+	memcpy(iSorted, iValues, iCount * sizeof(int));
+	qsort(iSorted, iCount, sizeof(int), Compare);
+	return iSorted[((iCount - 1) * iPerMille + 500) / 1000];
+} /* Quantile() */
+
+static void TestWelford(int iKind)
+{
+WELFORD w;
+double dSum = 0, dSquares = 0, dMean, dVar, dMeanErr = 0, dSDErr = 0;
+int i;
+
+	welfordInit(&w);
+	for (i=0; i<SAMPLES; i++) {
+		welfordAdd(&w, iValues[i]);
+		// the sums are exact in a double (the squares add up to < 2^53)
+		dSum += iValues[i];
+		dSquares += (double)iValues[i] * iValues[i];
+		dMean = dSum / (i + 1);
+		dVar = (i > 0) ? (dSquares - dSum * dMean) / i : 0;
+		if (fabs(welfordMean(&w) - dMean) > dMeanErr)
+			dMeanErr = fabs(welfordMean(&w) - dMean);
+		if (fabs(isqrt(welfordVariance(&w)) - sqrt(dVar)) > dSDErr)
+			dSDErr = fabs(isqrt(welfordVariance(&w)) - sqrt(dVar));
+	}
+	printf("%-9s mean max error %.2f ppm, std dev %.2f ppm\n", szTraceName[iKind], dMeanErr, dSDErr);
+	Check(dMeanErr <= MAX_MEAN_ERR, szTraceName[iKind], "Welford mean");
+	Check(dSDErr <= MAX_SD_ERR, szTraceName[iKind], "Welford std dev");
+} /* TestWelford() */
+
+//
+// P-square in floating point, as published, for the integer one to follow
+//
+typedef struct tagP2Ref
+{
+	double dQ[5], dN[5], dWant[5], dInc[5];
+	int iCount;
+} P2REF;
+
+static void RefInit(P2REF *pR, double dP)
+{
+int i;
+
+	memset(pR, 0, sizeof(P2REF));
+	pR->dInc[1] = dP / 2; pR->dInc[2] = dP; pR->dInc[3] = (1 + dP) / 2; pR->dInc[4] = 1;
+	for (i=0; i<5; i++) {
+		pR->dN[i] = i;
+		pR->dWant[i] = 4 * pR->dInc[i];
+	}
+} /* RefInit() */
+
+static void RefAdd(P2REF *pR, double dVal)
+{
+int i, k;
+double d, dQ, *q = pR->dQ, *n = pR->dN;
+
+	if (pR->iCount < 5) {
+		for (i = pR->iCount; i > 0 && q[i-1] > dVal; i--)
+			q[i] = q[i-1];
+		q[i] = dVal;
+		pR->iCount++;
+		return;
+	}
+	if (dVal < q[0]) {
+		q[0] = dVal;
+		k = 0;
+	} else if (dVal >= q[4]) {
+		q[4] = dVal;
+		k = 3;
+	} else {
+		for (k=0; k<3 && dVal >= q[k+1]; k++) {};
+	}
+	for (i=k+1; i<5; i++)
+		n[i]++;
+	for (i=0; i<5; i++)
+		pR->dWant[i] += pR->dInc[i];
+	pR->iCount++;
+	for (i=1; i<4; i++) {
+		d = pR->dWant[i] - n[i];
+		if ((d >= 1 && n[i+1] - n[i] > 1) || (d <= -1 && n[i-1] - n[i] < -1)) {
+			d = (d > 0) ? 1 : -1;
+			dQ = q[i] + d / (n[i+1] - n[i-1]) * ((n[i] - n[i-1] + d) * (q[i+1] - q[i]) / (n[i+1] - n[i]) +
+				(n[i+1] - n[i] - d) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+			if (dQ <= q[i-1] || dQ >= q[i+1])
+				dQ = q[i] + d * (q[i+(int)d] - q[i]) / (n[i+(int)d] - n[i]);
+			q[i] = dQ;
+			n[i] += d;
+		}
+	}
+} /* RefAdd() */
+
+static void TestP2(int iKind, int iPerMille)
+{
+P2QUANT q;
+P2REF ref;
+double d, dRefErr = 0, dErr = 0;
+int i, iExact = 0;
+char szWhat[32];
+
+	p2Init(&q, iPerMille);
+	RefInit(&ref, iPerMille / 1000.0);
+	for (i=0; i<SAMPLES; i++) {
+		p2Add(&q, iValues[i]);
+		RefAdd(&ref, iValues[i]);
+		if ((i + 1) % CHECK_EVERY)
+			continue;
+		d = fabs(p2Get(&q) - ref.dQ[2]);
+		if (d > dRefErr) dRefErr = d;
+		if (i < WARMUP)
+			continue;
+		iExact = Quantile(i + 1, iPerMille);
+		d = 100.0 * abs(p2Get(&q) - iExact) / iExact;
+		if (d > dErr) dErr = d;
+	}
+	printf("%-9s P%-2d %5d (exact %5d), max error %.2f ppm from float P-square, %.1f%% from exact after a day\n",
+		szTraceName[iKind], iPerMille / 10, p2Get(&q), iExact, dRefErr, dErr);
+	sprintf(szWhat, "P%d follows P-square", iPerMille / 10);
+	Check(dRefErr <= MAX_P2_REF_ERR, szTraceName[iKind], szWhat);
+	sprintf(szWhat, "P%d", iPerMille / 10);
+	Check(100.0 * abs(p2Get(&q) - iExact) / iExact <= MAX_P2_ERR, szTraceName[iKind], szWhat);
+} /* TestP2() */
+
+int main(void)
+{
+TRACE trace;
+int iKind, i, iValue[3];
+
+	printf("stats: %d days at %ds\n", DAYS, RATE);
+	for (iKind=0; iKind<TRACE_COUNT; iKind++) {
+		traceInit(&trace, iKind, 7 + iKind);
+		for (i=0; i<SAMPLES; i++) {
+			traceRun(&trace, RATE);
+			traceSample(&trace, iValue);
+			iValues[i] = iValue[0];
+		}
+		TestWelford(iKind);
+		TestP2(iKind, 500);
+		TestP2(iKind, 950);
+	}
+	printf("%s\n", iErrors ? "FAILED" : "stats ok");
+	return (iErrors != 0);
+} /* main() */
@@ -0,0 +1,147 @@
+//
+// Synthetic CO2 / temperature / humidity traces
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdint.h>
+#include <math.h>
+#include "trace.h"
+
+const char *szTraceName[TRACE_COUNT] = {"office", "bedroom", "classroom"};
+
+static uint32_t Random(TRACE *pTrace)
+{
+	pTrace->u32Seed = pTrace->u32Seed * 1664525 + 1013904223; // LCG
+	return pTrace->u32Seed >> 8;
+} /* Random() */
+
+// 0.0 - 1.0
+static double Uniform(TRACE *pTrace)
+{
+	return Random(pTrace) / 16777216.0;
+} /* Uniform() */
+
+// roughly normal, 1 sigma
+static double Gauss(TRACE *pTrace)
+{
+double d = 0;
+int i;
+
+	for (i=0; i<12; i++)
+		d += Uniform(pTrace);
+	return d - 6.0;
+} /* Gauss() */
+
+//
+// People in the room at a time of the week
+//
+static int People(TRACE *pTrace)
+{
+int iDay = (pTrace->u32Seconds / 86400) % 7;
+int iMin = (pTrace->u32Seconds % 86400) / 60;
+int iHour = iMin / 60;
+
+	switch (pTrace->iKind) {
+	case TRACE_OFFICE:
+		if (iDay >= 5 || iHour < 9 || iHour >= 17)
+			return 0;
+		if (iHour == 12) // lunch
+			return 1;
+		if ((iHour == 10 || iHour == 15) && (iMin % 60) < 45) // meetings
+			return 9;
+		return 4;
+	case TRACE_BEDROOM:
+		return (iMin >= 23*60 || iMin < 7*60) ? 2 : 0;
+	case TRACE_CLASSROOM:
+		if (iDay >= 5 || iHour < 8 || iHour >= 15)
+			return 0;
+		if ((iMin % 60) >= 50 || iHour == 12) // breaks and lunch
+			return 1;
+		return 25;
+	}
+	return 0;
+} /* People() */
+
+void traceInit(TRACE *pTrace, int iKind, uint32_t u32Seed)
+{
+	pTrace->iKind = iKind;
+	pTrace->u32Seed = u32Seed;
+	pTrace->u32Seconds = 0;
+	pTrace->dCO2 = TRACE_OUTDOOR_PPM + 50;
+	pTrace->dTemp = 20.0;
+	pTrace->dHumid = 45.0;
+	pTrace->iWindowLeft = 0;
+	switch (iKind) {
+	case TRACE_OFFICE:
+		pTrace->dVolume = 40; pTrace->dACH = 2.0;
+		break;
+	case TRACE_BEDROOM:
+		pTrace->dVolume = 30; pTrace->dACH = 0.3;
+		break;
+	default:
+		pTrace->dVolume = 180; pTrace->dACH = 1.5;
+		break;
+	}
+} /* traceInit() */
+
+//
+// Move the room on by iSeconds
+//
+void traceRun(TRACE *pTrace, int iSeconds)
+{
+int iPeople;
+double dACH, dHour;
+
+	while (iSeconds-- > 0) {
+		iPeople = People(pTrace);
+		// now and then someone opens a window for a while
+		if (pTrace->iWindowLeft == 0 && iPeople && Uniform(pTrace) < 1.0/7200)
+			pTrace->iWindowLeft = 300 + (int)(Uniform(pTrace) * 900);
+		dACH = pTrace->dACH;
+		if (pTrace->iWindowLeft) {
+			pTrace->iWindowLeft--;
+			dACH += 6.0;
+		}
+		pTrace->dCO2 += (iPeople * TRACE_PERSON_LS * 1e3) / pTrace->dVolume // ppm/s
+			- (pTrace->dCO2 - TRACE_OUTDOOR_PPM) * dACH / 3600;
+		dHour = (pTrace->u32Seconds % 86400) / 3600.0;
+		pTrace->dTemp += ((20.5 + 1.5 * sin((dHour - 9) * M_PI / 12) + iPeople * 0.1) - pTrace->dTemp) / 1800;
+		pTrace->dHumid += ((45 + iPeople * 0.8 - dACH * 1.5) - pTrace->dHumid) / 1800;
+		pTrace->u32Seconds++;
+	}
+} /* traceRun() */
+
+//
+// The CO2 in the room (no sensor noise)
+//
+int traceCO2(TRACE *pTrace)
+{
+	return (int)(pTrace->dCO2 + 0.5);
+} /* traceCO2() */
+
+//
+// What the sensor reads: CO2 (ppm), temperature (C x 10) and
+// humidity (% x 10)
+//
+void traceSample(TRACE *pTrace, int *pValues)
+{
+	pValues[0] = (int)(pTrace->dCO2 + Gauss(pTrace) * TRACE_NOISE_PPM + 0.5);
+	pValues[1] = (int)(pTrace->dTemp * 10 + Gauss(pTrace) + 0.5);
+	pValues[2] = (int)(pTrace->dHumid * 10 + Gauss(pTrace) * 2 + 0.5);
+} /* traceSample() */
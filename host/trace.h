@@ -0,0 +1,60 @@
+//
+// Synthetic CO2 / temperature / humidity traces
+// written by Larry Bank
+// bitbank@pobox.com
+// Copyright (c) 2023 BitBank Software, Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef HOST_TRACE_H_
+#define HOST_TRACE_H_
+
+// There are no recorded traces in the repo, so the simulators run on
+// rooms modelled second by second: people breathe out CO2
+// (TRACE_PERSON_LS each), ventilation pulls the air back toward the
+// outdoor level, and the sensor adds noise. Each scenario follows its
+// own daily occupancy and opens windows now and then. The same seed
+// gives the same trace.
+#define TRACE_OUTDOOR_PPM 420
+#define TRACE_PERSON_LS 0.005 // litres of CO2 per second (sitting adult)
+#define TRACE_NOISE_PPM 8 // SCD41 repeatability (1 sigma)
+
+enum
+{
+	TRACE_OFFICE=0, // 4 people in 40m3, 9-17 on weekdays, meetings
+	TRACE_BEDROOM, // 2 people in 30m3 at night, door closed
+	TRACE_CLASSROOM, // 25 people in 180m3, lessons and breaks
+	TRACE_COUNT
+};
+
+typedef struct tagTrace
+{
+	int iKind;
+	uint32_t u32Seed;
+	uint32_t u32Seconds; // since midnight of day 0
+	double dCO2, dTemp, dHumid; // the room
+	double dVolume, dACH; // m3 and air changes per hour (closed)
+	int iWindowLeft; // seconds the window stays open
+} TRACE;
+
+extern const char *szTraceName[TRACE_COUNT];
+
+void traceInit(TRACE *pTrace, int iKind, uint32_t u32Seed);
+void traceRun(TRACE *pTrace, int iSeconds);
+int traceCO2(TRACE *pTrace);
+void traceSample(TRACE *pTrace, int *pValues);
+
+#endif /* HOST_TRACE_H_ */